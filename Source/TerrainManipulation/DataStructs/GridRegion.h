@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * An inclusive box of grid indices, used to describe which part of a grid has been modified
+ */
+struct TERRAINMANIPULATION_API FGridRegion
+{
+	// The lowest indices inside the region
+	FIntVector3 minIndex = FIntVector3(MAX_int32);
+
+	// The highest indices inside the region
+	FIntVector3 maxIndex = FIntVector3(MIN_int32);
+
+	FGridRegion() = default;
+	FGridRegion(FIntVector3 minIndex, FIntVector3 maxIndex) : minIndex(minIndex), maxIndex(maxIndex)
+	{
+	}
+
+	bool IsEmpty() const
+	{
+		return minIndex.X > maxIndex.X || minIndex.Y > maxIndex.Y || minIndex.Z > maxIndex.Z;
+	}
+
+	/// <summary>
+	/// Grow the region to include the given indices
+	/// </summary>
+	void Include(FIntVector3 indices)
+	{
+		minIndex = FIntVector3(FMath::Min(minIndex.X, indices.X), FMath::Min(minIndex.Y, indices.Y), FMath::Min(minIndex.Z, indices.Z));
+		maxIndex = FIntVector3(FMath::Max(maxIndex.X, indices.X), FMath::Max(maxIndex.Y, indices.Y), FMath::Max(maxIndex.Z, indices.Z));
+	}
+
+	/// <summary>
+	/// Grow the region to include the whole of another region
+	/// </summary>
+	void Include(const FGridRegion& other)
+	{
+		if (other.IsEmpty()) return;
+		Include(other.minIndex);
+		Include(other.maxIndex);
+	}
+
+	/// <summary>
+	/// Get a copy of the region grown by the same amount in every direction
+	/// </summary>
+	FGridRegion Expanded(int32 amount) const
+	{
+		if (IsEmpty()) return *this;
+		return FGridRegion(minIndex - FIntVector3(amount), maxIndex + FIntVector3(amount));
+	}
+
+	/// <summary>
+	/// Get the part of the region that lies inside the given bounds
+	/// </summary>
+	/// <param name="lowerBound">The lowest valid indices (inclusive)</param>
+	/// <param name="upperBound">The highest valid indices (inclusive)</param>
+	FGridRegion Clamped(FIntVector3 lowerBound, FIntVector3 upperBound) const
+	{
+		return FGridRegion(
+			FIntVector3(FMath::Max(minIndex.X, lowerBound.X), FMath::Max(minIndex.Y, lowerBound.Y), FMath::Max(minIndex.Z, lowerBound.Z)),
+			FIntVector3(FMath::Min(maxIndex.X, upperBound.X), FMath::Min(maxIndex.Y, upperBound.Y), FMath::Min(maxIndex.Z, upperBound.Z)));
+	}
+
+	bool Contains(FIntVector3 indices) const
+	{
+		return indices.X >= minIndex.X && indices.X <= maxIndex.X
+			&& indices.Y >= minIndex.Y && indices.Y <= maxIndex.Y
+			&& indices.Z >= minIndex.Z && indices.Z <= maxIndex.Z;
+	}
+
+	bool Intersects(const FGridRegion& other) const
+	{
+		return !Clamped(other.minIndex, other.maxIndex).IsEmpty();
+	}
+
+	/// <summary>
+	/// Get the number of indices covered along each axis
+	/// </summary>
+	FIntVector3 GetSize() const
+	{
+		if (IsEmpty()) return FIntVector3(0);
+		return maxIndex - minIndex + FIntVector3(1);
+	}
+
+	/// <summary>
+	/// Get the total number of indices covered by the region
+	/// </summary>
+	int64 Num() const
+	{
+		FIntVector3 size = GetSize();
+		return (int64)size.X * size.Y * size.Z;
+	}
+};
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "QuantizedTerrainMesh.h"
+
+using namespace UE::Geometry;
+
+void FQuantizedTerrainMesh::Encode(const FDynamicMesh3& mesh, const FVector3f& boxOrigin, const FVector3f& boxExtent)
+{
+	Reset();
+	if (mesh.TriangleCount() == 0)
+	{
+		return;
+	}
+
+	// The vertices are renumbered in the order the triangles first use them, so that a soup needs no indices
+	TArray<int32> vertexRemap;
+	vertexRemap.Init(IndexConstants::InvalidID, mesh.MaxVertexID());
+	TArray<int32> sourceVertices;
+	sourceVertices.Reserve(mesh.VertexCount());
+	TArray<FVector3f> accumulatedNormals;
+	accumulatedNormals.Reserve(mesh.VertexCount());
+	indices.Reserve(mesh.TriangleCount() * 3);
+
+	for (int32 tid : mesh.TriangleIndicesItr())
+	{
+		FVector3d triangleNormal, triangleCentroid;
+		double triangleArea = 0;
+		mesh.GetTriInfo(tid, triangleNormal, triangleArea, triangleCentroid);
+
+		FIndex3i triangle = mesh.GetTriangle(tid);
+		for (int32 corner = 0; corner < 3; corner++)
+		{
+			int32 vid = triangle[corner];
+			if (vertexRemap[vid] == IndexConstants::InvalidID)
+			{
+				vertexRemap[vid] = sourceVertices.Add(vid);
+				accumulatedNormals.Add(FVector3f::ZeroVector);
+			}
+			accumulatedNormals[vertexRemap[vid]] += FVector3f(triangleNormal * triangleArea);
+			indices.Add((uint32)vertexRemap[vid]);
+		}
+	}
+	triangleCount = mesh.TriangleCount();
+
+	// The box is fixed rather than fitted to the mesh, as the bounds of neighbouring meshes differ and would round their shared vertices apart
+	origin = boxOrigin;
+	step = boxExtent / 65535.0f;
+	FVector3f inverseStep = FVector3f(
+		step.X > 0 ? 1.0f / step.X : 0,
+		step.Y > 0 ? 1.0f / step.Y : 0,
+		step.Z > 0 ? 1.0f / step.Z : 0);
+
+	vertices.SetNumUninitialized(sourceVertices.Num(), EAllowShrinking::No);
+	for (int32 i = 0; i < sourceVertices.Num(); i++)
+	{
+		FVector3f offset = (FVector3f(mesh.GetVertex(sourceVertices[i])) - origin) * inverseStep;
+		FQuantizedTerrainVertex& vertex = vertices[i];
+		vertex.position[0] = (uint16)FMath::Clamp(FMath::RoundToInt32(offset.X), 0, 65535);
+		vertex.position[1] = (uint16)FMath::Clamp(FMath::RoundToInt32(offset.Y), 0, 65535);
+		vertex.position[2] = (uint16)FMath::Clamp(FMath::RoundToInt32(offset.Z), 0, 65535);
+		EncodeNormal(accumulatedNormals[i].GetSafeNormal(UE_SMALL_NUMBER, FVector3f::UnitZ()), vertex.normal);
+	}
+
+	if (vertices.Num() == indices.Num())
+	{
+		// Every corner has a vertex of its own, so the indices are just 0, 1, 2, ...
+		indices.Reset();
+	}
+}
+
+void FQuantizedTerrainMesh::Decode(FDynamicMesh3& outMesh) const
+{
+	outMesh.Clear();
+	outMesh.EnableTriangleGroups();
+	outMesh.EnableVertexNormals(FVector3f::UnitZ());
+	if (IsEmpty())
+	{
+		return;
+	}
+
+	for (const FQuantizedTerrainVertex& vertex : vertices)
+	{
+		FVector3f position = origin + FVector3f(vertex.position[0], vertex.position[1], vertex.position[2]) * step;
+		int32 vid = outMesh.AppendVertex(FVector3d(position));
+		outMesh.SetVertexNormal(vid, DecodeNormal(vertex.normal));
+	}
+
+	// Vertices were appended to an empty mesh, so their IDs match their indices
+	bool bSoup = indices.Num() == 0;
+	for (int32 t = 0; t < triangleCount; t++)
+	{
+		FIndex3i triangle = bSoup
+			? FIndex3i(t * 3, t * 3 + 1, t * 3 + 2)
+			: FIndex3i((int32)indices[t * 3], (int32)indices[t * 3 + 1], (int32)indices[t * 3 + 2]);
+		outMesh.AppendTriangle(triangle, 0);
+	}
+}
+
+void FQuantizedTerrainMesh::Reset()
+{
+	vertices.Reset();
+	indices.Reset();
+	triangleCount = 0;
+}
+
+SIZE_T FQuantizedTerrainMesh::GetAllocatedSize() const
+{
+	return vertices.GetAllocatedSize() + indices.GetAllocatedSize();
+}
+
+void FQuantizedTerrainMesh::EncodeNormal(const FVector3f& normal, int8 outEncoded[2])
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper half along the diagonals
+	float length = FMath::Abs(normal.X) + FMath::Abs(normal.Y) + FMath::Abs(normal.Z);
+	FVector2f folded = FVector2f(normal.X, normal.Y) / FMath::Max(length, UE_SMALL_NUMBER);
+	if (normal.Z < 0)
+	{
+		folded = FVector2f(
+			(1 - FMath::Abs(folded.Y)) * (folded.X >= 0 ? 1 : -1),
+			(1 - FMath::Abs(folded.X)) * (folded.Y >= 0 ? 1 : -1));
+	}
+	outEncoded[0] = (int8)FMath::Clamp(FMath::RoundToInt32(folded.X * 127), -127, 127);
+	outEncoded[1] = (int8)FMath::Clamp(FMath::RoundToInt32(folded.Y * 127), -127, 127);
+}
+
+FVector3f FQuantizedTerrainMesh::DecodeNormal(const int8 encoded[2])
+{
+	FVector3f normal(encoded[0] / 127.0f, encoded[1] / 127.0f, 0);
+	normal.Z = 1 - FMath::Abs(normal.X) - FMath::Abs(normal.Y);
+	if (normal.Z < 0)
+	{
+		float unfoldedX = (1 - FMath::Abs(normal.Y)) * (normal.X >= 0 ? 1 : -1);
+		float unfoldedY = (1 - FMath::Abs(normal.X)) * (normal.Y >= 0 ? 1 : -1);
+		normal.X = unfoldedX;
+		normal.Y = unfoldedY;
+	}
+	return normal.GetSafeNormal(UE_SMALL_NUMBER, FVector3f::UnitZ());
+}
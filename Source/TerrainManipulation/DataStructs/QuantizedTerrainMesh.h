@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DynamicMesh/DynamicMesh3.h"
+
+/**
+ * A vertex of a quantized mesh, a third of the size of the position and normal of an FDynamicMesh3 vertex
+ */
+struct TERRAINMANIPULATION_API FQuantizedTerrainVertex
+{
+	// The position within the quantization box, in steps of 1/65535 of the box along each axis
+	uint16 position[3];
+
+	// The unit normal folded onto an octahedron and flattened into two signed values
+	int8 normal[2];
+};
+
+static_assert(sizeof(FQuantizedTerrainVertex) == 8, "FQuantizedTerrainVertex is expected to be tightly packed");
+
+/**
+ * A compact, render only copy of a mesh, used to hand chunk meshes from the worker that generated them to the game thread that displays them.
+ * Positions are stored relative to a box given by the caller as 3x16 bit values and normals are oct-encoded into 2x8 bits.
+ * Meshes quantized against boxes of the same size that share a face put the vertices on that face on the same lattice, so neighbouring chunks decode without cracks.
+ * Triangle soups are stored without indices, as every vertex of a soup belongs to the triangle at the same position. Triangle groups are not kept
+ */
+class TERRAINMANIPULATION_API FQuantizedTerrainMesh
+{
+public:
+	/// <summary>
+	/// Replace the contents with a quantized copy of a mesh, with each vertex normal the area weighted average of the triangles using it
+	/// </summary>
+	/// <param name="mesh">The mesh to copy</param>
+	/// <param name="boxOrigin">The minimum corner of the box positions are quantized within</param>
+	/// <param name="boxExtent">The size of the box along each axis. Positions outside the box are clamped onto it</param>
+	void Encode(const UE::Geometry::FDynamicMesh3& mesh, const FVector3f& boxOrigin, const FVector3f& boxExtent);
+
+	/// <summary>
+	/// Rebuild an FDynamicMesh3 with vertex normals from the quantized copy
+	/// </summary>
+	/// <param name="outMesh">Receives the mesh, replacing anything it held</param>
+	void Decode(UE::Geometry::FDynamicMesh3& outMesh) const;
+
+	/// <summary>
+	/// Discard the contents while keeping the storage
+	/// </summary>
+	void Reset();
+
+	bool IsEmpty() const
+	{
+		return triangleCount == 0;
+	}
+
+	int32 GetTriangleCount() const
+	{
+		return triangleCount;
+	}
+
+	/// <summary>
+	/// Get the number of bytes allocated for the vertices and indices
+	/// </summary>
+	SIZE_T GetAllocatedSize() const;
+
+	/// <summary>
+	/// Fold a unit vector onto an octahedron and flatten it into two signed 8 bit values
+	/// </summary>
+	static void EncodeNormal(const FVector3f& normal, int8 outEncoded[2]);
+
+	/// <summary>
+	/// Unfold a normal encoded by EncodeNormal
+	/// </summary>
+	static FVector3f DecodeNormal(const int8 encoded[2]);
+
+private:
+	// The position of a vertex quantized to (0,0,0)
+	FVector3f origin = FVector3f::ZeroVector;
+
+	// The distance along each axis between neighbouring quantized positions
+	FVector3f step = FVector3f::ZeroVector;
+
+	TArray<FQuantizedTerrainVertex> vertices;
+
+	// Three per triangle, or empty for a triangle soup
+	TArray<uint32> indices;
+
+	int32 triangleCount = 0;
+};
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SignMask3D.h"
+
+void FSignMask3D::Initialise(int32 sizeX, int32 sizeY, int32 sizeZ)
+{
+	this->sizeX = sizeX;
+	this->sizeY = sizeY;
+	this->sizeZ = sizeZ;
+	blockCountX = FMath::DivideAndRoundUp(sizeX, 4);
+	blockCountY = FMath::DivideAndRoundUp(sizeY, 4);
+	blockCountZ = FMath::DivideAndRoundUp(sizeZ, 4);
+	words.SetNumZeroed(blockCountX * blockCountY * blockCountZ, EAllowShrinking::No);
+}
+
+void FSignMask3D::Empty()
+{
+	words.Empty();
+}
+
+void FSignMask3D::Reset()
+{
+	words.Reset();
+}
+
+bool FSignMask3D::CanBlockContainSurface(int32 blockX, int32 blockY, int32 blockZ) const
+{
+	bool bAnyAbove = false;
+	bool bAnyBelow = false;
+	for (int32 k = blockZ; k <= FMath::Min(blockZ + 1, blockCountZ - 1); k++)
+	{
+		for (int32 j = blockY; j <= FMath::Min(blockY + 1, blockCountY - 1); j++)
+		{
+			for (int32 i = blockX; i <= FMath::Min(blockX + 1, blockCountX - 1); i++)
+			{
+				uint64 validBits = GetBlockValidBits(i, j, k);
+				uint64 word = words[GetBlockIndex(i, j, k)] & validBits;
+				bAnyAbove |= word != 0;
+				bAnyBelow |= word != validBits;
+				if (bAnyAbove && bAnyBelow) return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool FSignMask3D::DoesRegionStraddle(FIntVector3 regionMin, FIntVector3 regionMax) const
+{
+	regionMin = FIntVector3(FMath::Max(regionMin.X, 0), FMath::Max(regionMin.Y, 0), FMath::Max(regionMin.Z, 0));
+	regionMax = FIntVector3(FMath::Min(regionMax.X, sizeX - 1), FMath::Min(regionMax.Y, sizeY - 1), FMath::Min(regionMax.Z, sizeZ - 1));
+	if (regionMin.X > regionMax.X || regionMin.Y > regionMax.Y || regionMin.Z > regionMax.Z) return false;
+
+	bool bAnyAbove = false;
+	bool bAnyBelow = false;
+	for (int32 k = regionMin.Z >> 2; k <= regionMax.Z >> 2; k++)
+	{
+		for (int32 j = regionMin.Y >> 2; j <= regionMax.Y >> 2; j++)
+		{
+			for (int32 i = regionMin.X >> 2; i <= regionMax.X >> 2; i++)
+			{
+				// The part of the block inside the box, built a row of X bits at a time like the valid bits of a boundary block
+				int32 lowX = FMath::Max(regionMin.X - i * 4, 0), highX = FMath::Min(regionMax.X - i * 4, 3);
+				int32 lowY = FMath::Max(regionMin.Y - j * 4, 0), highY = FMath::Min(regionMax.Y - j * 4, 3);
+				int32 lowZ = FMath::Max(regionMin.Z - k * 4, 0), highZ = FMath::Min(regionMax.Z - k * 4, 3);
+				uint64 regionBits = ~(uint64)0;
+				if (lowX > 0 || highX < 3 || lowY > 0 || highY < 3 || lowZ > 0 || highZ < 3)
+				{
+					uint64 rowBits = ((1ull << (highX - lowX + 1)) - 1) << lowX;
+					regionBits = 0;
+					for (int32 z = lowZ; z <= highZ; z++)
+					{
+						for (int32 y = lowY; y <= highY; y++)
+						{
+							regionBits |= rowBits << GetBitIndex(0, y, z);
+						}
+					}
+				}
+
+				uint64 word = words[GetBlockIndex(i, j, k)] & regionBits;
+				bAnyAbove |= word != 0;
+				bAnyBelow |= word != regionBits;
+				if (bAnyAbove && bAnyBelow) return true;
+			}
+		}
+	}
+	return false;
+}
+
+uint64 FSignMask3D::GetBlockValidBits(int32 blockX, int32 blockY, int32 blockZ) const
+{
+	int32 validX = FMath::Min(sizeX - blockX * 4, 4);
+	int32 validY = FMath::Min(sizeY - blockY * 4, 4);
+	int32 validZ = FMath::Min(sizeZ - blockZ * 4, 4);
+	if (validX == 4 && validY == 4 && validZ == 4) return ~(uint64)0;
+
+	// Each row of 4 bits along X is repeated for every valid Y and Z
+	uint64 rowBits = (1ull << validX) - 1;
+	uint64 validBits = 0;
+	for (int32 z = 0; z < validZ; z++)
+	{
+		for (int32 y = 0; y < validY; y++)
+		{
+			validBits |= rowBits << GetBitIndex(0, y, z);
+		}
+	}
+	return validBits;
+}
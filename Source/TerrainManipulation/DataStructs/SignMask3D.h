@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * One bit per element of a 3D grid, packed as one 64 bit word per 4x4x4 block of elements.
+ * Used to record which side of the isovalue each grid point lies without keeping the values themselves.
+ */
+class TERRAINMANIPULATION_API FSignMask3D
+{
+public:
+	FSignMask3D() = default;
+
+	/// <summary>
+	/// Allocate the mask for a grid of the given size with all bits cleared
+	/// </summary>
+	void Initialise(int32 sizeX, int32 sizeY, int32 sizeZ);
+
+	/// <summary>
+	/// Release the storage of the mask
+	/// </summary>
+	void Empty();
+
+	/// <summary>
+	/// Clear the mask while keeping its storage, so that initialising it again at the same size or smaller does not allocate
+	/// </summary>
+	void Reset();
+
+	bool IsEmpty() const
+	{
+		return words.Num() == 0;
+	}
+
+	bool GetBit(int32 x, int32 y, int32 z) const
+	{
+		return (words[GetBlockIndex(x >> 2, y >> 2, z >> 2)] >> GetBitIndex(x, y, z)) & 1;
+	}
+
+	void SetBit(int32 x, int32 y, int32 z, bool bValue)
+	{
+		uint64& word = words[GetBlockIndex(x >> 2, y >> 2, z >> 2)];
+		uint64 bit = 1ull << GetBitIndex(x, y, z);
+		word = bValue ? (word | bit) : (word & ~bit);
+	}
+
+	/// <summary>
+	/// Gather the bits of the 8 corners of the cell with minimal corner (x,y,z), ordered as defined by Paul Bourke.
+	/// This is identical to the cube index computed from the corner values when the mask was built against the isovalue.
+	/// </summary>
+	/// <returns>The 8 bit cube index of the cell</returns>
+	uint8 GetCellIndex(int32 x, int32 y, int32 z) const
+	{
+		uint8 cubeIndex = 0;
+		cubeIndex |= GetBit(x, y, z) << 0;
+		cubeIndex |= GetBit(x + 1, y, z) << 1;
+		cubeIndex |= GetBit(x + 1, y + 1, z) << 2;
+		cubeIndex |= GetBit(x, y + 1, z) << 3;
+		cubeIndex |= GetBit(x, y, z + 1) << 4;
+		cubeIndex |= GetBit(x + 1, y, z + 1) << 5;
+		cubeIndex |= GetBit(x + 1, y + 1, z + 1) << 6;
+		cubeIndex |= GetBit(x, y + 1, z + 1) << 7;
+		return cubeIndex;
+	}
+
+	/// <summary>
+	/// Conservatively test whether any cell whose minimal corner lies in the given 4x4x4 block straddles the threshold.
+	/// Those cells reach one element into the neighbouring blocks, so the block and its 7 forward neighbours must all be uniform and agree for the test to fail.
+	/// </summary>
+	/// <param name="blockX">The block index along X, equal to the element index divided by 4</param>
+	/// <param name="blockY">The block index along Y, equal to the element index divided by 4</param>
+	/// <param name="blockZ">The block index along Z, equal to the element index divided by 4</param>
+	/// <returns>False only if every cell starting in the block lies entirely on one side of the threshold</returns>
+	bool CanBlockContainSurface(int32 blockX, int32 blockY, int32 blockZ) const;
+
+	/// <summary>
+	/// Test whether a box of elements holds both set and cleared bits, a whole 4x4x4 block at a time
+	/// </summary>
+	/// <param name="regionMin">The lowest coordinate of the box (inclusive), clamped to the grid</param>
+	/// <param name="regionMax">The highest coordinate of the box (inclusive), clamped to the grid</param>
+	/// <returns>True if the box has elements on both sides of the threshold</returns>
+	bool DoesRegionStraddle(FIntVector3 regionMin, FIntVector3 regionMax) const;
+
+	/// <summary>
+	/// Count the set bits within a 4x4x4 block
+	/// </summary>
+	int32 CountBitsInBlock(int32 blockX, int32 blockY, int32 blockZ) const
+	{
+		return FMath::CountBits(words[GetBlockIndex(blockX, blockY, blockZ)]);
+	}
+
+	int32 GetBlockCount(int32 coordinateAxis) const
+	{
+		return coordinateAxis == 0 ? blockCountX : (coordinateAxis == 1 ? blockCountY : blockCountZ);
+	}
+
+private:
+	int32 GetBlockIndex(int32 blockX, int32 blockY, int32 blockZ) const
+	{
+		return blockX + (blockY * blockCountX) + (blockZ * blockCountX * blockCountY);
+	}
+
+	static int32 GetBitIndex(int32 x, int32 y, int32 z)
+	{
+		return (x & 3) | ((y & 3) << 2) | ((z & 3) << 4);
+	}
+
+	/// <summary>
+	/// Get the bits of a block that correspond to real elements, as blocks on the far boundary may overhang the grid
+	/// </summary>
+	uint64 GetBlockValidBits(int32 blockX, int32 blockY, int32 blockZ) const;
+
+	TArray<uint64> words;
+	int32 sizeX = 0, sizeY = 0, sizeZ = 0;
+	int32 blockCountX = 0, blockCountY = 0, blockCountZ = 0;
+};
@@ -3,6 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "SignMask3D.h"
+#include "Async/ParallelFor.h"
 
 /**
  *
@@ -30,7 +32,16 @@ public:
 		sizeY = other.sizeY;
 		sizeZ = other.sizeZ;
 		data = other.data;
+		mipLevels = other.mipLevels;
+		bMipChainDirty = other.bMipChainDirty;
+		mipDirtyMin = other.mipDirtyMin;
+		mipDirtyMax = other.mipDirtyMax;
+		signMask = other.signMask;
+		signMaskThreshold = other.signMaskThreshold;
 	}
+	TArray3D<T>(TArray3D<T>&& other) = default;
+	TArray3D<T>& operator=(const TArray3D<T>& other) = default;
+	TArray3D<T>& operator=(TArray3D<T>&& other) = default;
 	~TArray3D<T>() = default;
 
 	/// <summary>
@@ -77,7 +88,9 @@ public:
 	/// <param name="value">The value to be set</param>
 	void SetElement(int32 x, int32 y, int32 z, T value) 
 	{
-		SetElement(GetArrayIndex(x, y, z), value);
+		data[GetArrayIndex(x, y, z)] = value;
+		if (mipLevels.Num() > 0) MarkMipChainDirty(x, y, z);
+		if (!signMask.IsEmpty()) signMask.SetBit(x, y, z, value > signMaskThreshold);
 	}
 	/// <summary>
 	/// Set the value of the element at the specified (x,y,z) coordinates
@@ -86,7 +99,7 @@ public:
 	/// <param name="value">The value to be set</param>
 	void SetElement(FIntVector3 indices, T value) 
 	{
-		SetElement(GetArrayIndex(indices.X, indices.Y, indices.Z), value);
+		SetElement(indices.X, indices.Y, indices.Z, value);
 	}
 	/// <summary>
 	/// Set the value of the element at the specified array index
@@ -96,6 +109,12 @@ public:
 	void SetElement(int32 arrayIndex, T value) 
 	{
 		data[arrayIndex] = value;
+		if (mipLevels.Num() > 0 || !signMask.IsEmpty())
+		{
+			FIntVector3 indices = GetGridReference(arrayIndex);
+			if (mipLevels.Num() > 0) MarkMipChainDirty(indices.X, indices.Y, indices.Z);
+			if (!signMask.IsEmpty()) signMask.SetBit(indices.X, indices.Y, indices.Z, value > signMaskThreshold);
+		}
 	}
 
 	/// <summary>
@@ -146,6 +165,21 @@ public:
 		}
 	}
 
+	/// <summary>
+	/// Change the size of the array while keeping its storage whenever the new size fits, so that an array reused for snapshots of the same size never reallocates.
+	/// The values are left unspecified, and the mip chain and sign mask are dropped as they no longer describe the values
+	/// </summary>
+	void SetSizeUninitialized(int32 newSizeX, int32 newSizeY, int32 newSizeZ)
+	{
+		sizeX = newSizeX;
+		sizeY = newSizeY;
+		sizeZ = newSizeZ;
+		data.SetNumUninitialized(sizeX * sizeY * sizeZ, EAllowShrinking::No);
+		mipLevels.Empty();
+		bMipChainDirty = false;
+		signMask.Reset();
+	}
+
 	bool IsValidIndex(int32 x, int32 y, int32 z) const 
 	{
 		if (x < 0 || x >= sizeX) return false;
@@ -155,8 +189,415 @@ public:
 		return true;
 	}
 
+	/// <summary>
+	/// Get a pointer to the first element of a row along X, which is contiguous in memory.
+	/// Writes through this pointer bypass the mip chain and sign mask, so MarkRegionModified must be called afterwards
+	/// </summary>
+	/// <param name="y">Coordinate 1 of the row</param>
+	/// <param name="z">Coordinate 2 of the row</param>
+	T* GetRowData(int32 y, int32 z)
+	{
+		return &data[GetArrayIndex(0, y, z)];
+	}
+	/// <summary>
+	/// Get a pointer to the first element of a row along X, which is contiguous in memory
+	/// </summary>
+	/// <param name="y">Coordinate 1 of the row</param>
+	/// <param name="z">Coordinate 2 of the row</param>
+	const T* GetRowData(int32 y, int32 z) const
+	{
+		return &data[GetArrayIndex(0, y, z)];
+	}
+
+	/// <summary>
+	/// Bring the mip chain and sign mask up to date after a box of elements has been written through GetRowData
+	/// </summary>
+	/// <param name="regionMin">The lowest modified coordinate (inclusive)</param>
+	/// <param name="regionMax">The highest modified coordinate (inclusive)</param>
+	void MarkRegionModified(FIntVector3 regionMin, FIntVector3 regionMax)
+	{
+		if (mipLevels.Num() > 0)
+		{
+			MarkMipChainDirty(regionMin.X, regionMin.Y, regionMin.Z);
+			MarkMipChainDirty(regionMax.X, regionMax.Y, regionMax.Z);
+		}
+		if (!signMask.IsEmpty())
+		{
+			// Each 4x4x4 block of the mask is one word, so slabs of whole blocks along Z can be updated without sharing words
+			int32 firstSlab = regionMin.Z >> 2;
+			int32 slabCount = (regionMax.Z >> 2) - firstSlab + 1;
+			int64 pointCount = (int64)(regionMax.X - regionMin.X + 1) * (regionMax.Y - regionMin.Y + 1) * (regionMax.Z - regionMin.Z + 1);
+			ParallelFor(slabCount, [&](int32 slab)
+				{
+					int32 slabMinZ = FMath::Max((firstSlab + slab) * 4, regionMin.Z);
+					int32 slabMaxZ = FMath::Min((firstSlab + slab) * 4 + 3, regionMax.Z);
+					for (int32 z = slabMinZ; z <= slabMaxZ; z++)
+					{
+						for (int32 y = regionMin.Y; y <= regionMax.Y; y++)
+						{
+							const T* row = GetRowData(y, z);
+							for (int32 x = regionMin.X; x <= regionMax.X; x++)
+							{
+								signMask.SetBit(x, y, z, row[x] > signMaskThreshold);
+							}
+						}
+					}
+				}, pointCount < ParallelSignMaskThreshold);
+		}
+	}
+
+	/// <summary>
+	/// Copy a box of elements into another array, starting from regionMin
+	/// </summary>
+	/// <param name="out">The array to fill, whose size determines the size of the box</param>
+	/// <param name="regionMin">The coordinate of this array that maps onto (0,0,0) of the output</param>
+	void CopyRegionTo(TArray3D<T>& out, FIntVector3 regionMin) const
+	{
+		for (int32 z = 0; z < out.sizeZ; z++)
+		{
+			for (int32 y = 0; y < out.sizeY; y++)
+			{
+				// Rows are contiguous along X in both arrays
+				const T* sourceRow = &data[GetArrayIndex(regionMin.X, regionMin.Y + y, regionMin.Z + z)];
+				T* destinationRow = &out.data[out.GetArrayIndex(0, y, z)];
+				FMemory::Memcpy(destinationRow, sourceRow, out.sizeX * sizeof(T));
+			}
+		}
+	}
+
+	/// <summary>
+	/// Overwrite a box of elements with the contents of another array, starting from regionMin
+	/// </summary>
+	/// <param name="source">The array to copy from, whose size determines the size of the box</param>
+	/// <param name="regionMin">The coordinate of this array that (0,0,0) of the source maps onto</param>
+	void WriteRegionFrom(const TArray3D<T>& source, FIntVector3 regionMin)
+	{
+		for (int32 z = 0; z < source.sizeZ; z++)
+		{
+			for (int32 y = 0; y < source.sizeY; y++)
+			{
+				FMemory::Memcpy(GetRowData(regionMin.Y + y, regionMin.Z + z) + regionMin.X, source.GetRowData(y, z), source.sizeX * sizeof(T));
+			}
+		}
+		MarkRegionModified(regionMin, regionMin + FIntVector3(source.sizeX - 1, source.sizeY - 1, source.sizeZ - 1));
+	}
+
+	/// <summary>
+	/// Build a chain of 2x downsampled levels storing the min, max and average of each 2x2x2 block of the level below.
+	/// Level 0 is the full resolution data, so levelCount coarse levels are created on top of it.
+	/// </summary>
+	/// <param name="levelCount">The number of coarse levels to maintain</param>
+	void EnableMipChain(int32 levelCount)
+	{
+		mipLevels.Empty(levelCount);
+
+		int32 levelSizeX = sizeX, levelSizeY = sizeY, levelSizeZ = sizeZ;
+		for (int32 level = 0; level < levelCount; level++)
+		{
+			// Stop once the level has collapsed to a single element, as further levels hold no new information
+			if (levelSizeX == 1 && levelSizeY == 1 && levelSizeZ == 1) break;
+
+			levelSizeX = (levelSizeX + 1) / 2;
+			levelSizeY = (levelSizeY + 1) / 2;
+			levelSizeZ = (levelSizeZ + 1) / 2;
+
+			FMipLevel& mipLevel = mipLevels.AddDefaulted_GetRef();
+			mipLevel.sizeX = levelSizeX;
+			mipLevel.sizeY = levelSizeY;
+			mipLevel.sizeZ = levelSizeZ;
+			mipLevel.minValues.SetNumUninitialized(levelSizeX * levelSizeY * levelSizeZ);
+			mipLevel.maxValues.SetNumUninitialized(levelSizeX * levelSizeY * levelSizeZ);
+			mipLevel.averageValues.SetNumUninitialized(levelSizeX * levelSizeY * levelSizeZ);
+		}
+
+		// Build the whole chain once, after which only edited regions are recalculated
+		bMipChainDirty = true;
+		mipDirtyMin = FIntVector3(0, 0, 0);
+		mipDirtyMax = FIntVector3(sizeX - 1, sizeY - 1, sizeZ - 1);
+		UpdateMipChain();
+	}
+
+	/// <summary>
+	/// Release the mip chain so that writes no longer track modified regions
+	/// </summary>
+	void DisableMipChain()
+	{
+		mipLevels.Empty();
+		bMipChainDirty = false;
+	}
+
+	bool HasMipChain() const
+	{
+		return mipLevels.Num() > 0;
+	}
+
+	/// <summary>
+	/// Get the number of coarse levels above the full resolution data
+	/// </summary>
+	int32 GetMipLevelCount() const
+	{
+		return mipLevels.Num();
+	}
+
+	/// <summary>
+	/// Get the size of a mip level along each axis
+	/// </summary>
+	/// <param name="level">The mip level, where 0 is the full resolution data</param>
+	/// <returns>The number of elements along each axis of the level</returns>
+	FIntVector3 GetMipLevelSize(int32 level) const
+	{
+		if (level == 0) return FIntVector3(sizeX, sizeY, sizeZ);
+		const FMipLevel& mipLevel = mipLevels[level - 1];
+		return FIntVector3(mipLevel.sizeX, mipLevel.sizeY, mipLevel.sizeZ);
+	}
+
+	/// <summary>
+	/// Get the minimum of all full resolution elements covered by this element of a mip level
+	/// </summary>
+	/// <param name="level">The mip level, where 0 is the full resolution data</param>
+	/// <returns>The minimum value in the covered block</returns>
+	T GetMipMin(int32 level, int32 x, int32 y, int32 z) const
+	{
+		if (level == 0) return GetElement(x, y, z);
+		const FMipLevel& mipLevel = mipLevels[level - 1];
+		return mipLevel.minValues[mipLevel.GetIndex(x, y, z)];
+	}
+
+	/// <summary>
+	/// Get the maximum of all full resolution elements covered by this element of a mip level
+	/// </summary>
+	/// <param name="level">The mip level, where 0 is the full resolution data</param>
+	/// <returns>The maximum value in the covered block</returns>
+	T GetMipMax(int32 level, int32 x, int32 y, int32 z) const
+	{
+		if (level == 0) return GetElement(x, y, z);
+		const FMipLevel& mipLevel = mipLevels[level - 1];
+		return mipLevel.maxValues[mipLevel.GetIndex(x, y, z)];
+	}
+
+	/// <summary>
+	/// Get the average of all full resolution elements covered by this element of a mip level
+	/// </summary>
+	/// <param name="level">The mip level, where 0 is the full resolution data</param>
+	/// <returns>The average value in the covered block</returns>
+	T GetMipAverage(int32 level, int32 x, int32 y, int32 z) const
+	{
+		if (level == 0) return GetElement(x, y, z);
+		const FMipLevel& mipLevel = mipLevels[level - 1];
+		return mipLevel.averageValues[mipLevel.GetIndex(x, y, z)];
+	}
+
+	/// <summary>
+	/// Copy the averages of a mip level into another array, reusing the storage of that array where it is large enough.
+	/// A copy of level 0 also carries the sign mask, which still matches the values
+	/// </summary>
+	/// <param name="level">The mip level, where 0 is the full resolution data</param>
+	/// <param name="out">The array to overwrite, which is resized to the level</param>
+	void CopyMipLevelAveragesTo(int32 level, TArray3D<T>& out) const
+	{
+		if (level == 0)
+		{
+			out.SetSizeUninitialized(sizeX, sizeY, sizeZ);
+			FMemory::Memcpy(out.data.GetData(), data.GetData(), data.Num() * sizeof(T));
+			if (!signMask.IsEmpty())
+			{
+				out.signMask = signMask;
+				out.signMaskThreshold = signMaskThreshold;
+			}
+			return;
+		}
+
+		const FMipLevel& mipLevel = mipLevels[level - 1];
+		out.SetSizeUninitialized(mipLevel.sizeX, mipLevel.sizeY, mipLevel.sizeZ);
+		FMemory::Memcpy(out.data.GetData(), mipLevel.averageValues.GetData(), mipLevel.averageValues.Num() * sizeof(T));
+	}
+
+	/// <summary>
+	/// Conservatively find the range of values within a region of the full resolution data using the coarsest suitable mip level
+	/// </summary>
+	/// <param name="regionMin">The lowest full resolution coordinate of the region (inclusive)</param>
+	/// <param name="regionMax">The highest full resolution coordinate of the region (inclusive)</param>
+	/// <param name="outMin">A value less than or equal to every element in the region</param>
+	/// <param name="outMax">A value greater than or equal to every element in the region</param>
+	/// <returns>False if the region lies entirely outside the array, in which case the outputs are left untouched</returns>
+	bool GetValueRangeInRegion(FIntVector3 regionMin, FIntVector3 regionMax, T& outMin, T& outMax) const
+	{
+		regionMin = FIntVector3(FMath::Max(regionMin.X, 0), FMath::Max(regionMin.Y, 0), FMath::Max(regionMin.Z, 0));
+		regionMax = FIntVector3(FMath::Min(regionMax.X, sizeX - 1), FMath::Min(regionMax.Y, sizeY - 1), FMath::Min(regionMax.Z, sizeZ - 1));
+		if (regionMin.X > regionMax.X || regionMin.Y > regionMax.Y || regionMin.Z > regionMax.Z)
+		{
+			return false;
+		}
+
+		// Choose the level at which the region spans only a handful of elements per axis
+		int32 largestExtent = FMath::Max3(regionMax.X - regionMin.X, regionMax.Y - regionMin.Y, regionMax.Z - regionMin.Z) + 1;
+		int32 level = FMath::Min((int32)FMath::FloorLog2((uint32)largestExtent), mipLevels.Num());
+
+		outMin = GetMipMin(level, regionMin.X >> level, regionMin.Y >> level, regionMin.Z >> level);
+		outMax = GetMipMax(level, regionMin.X >> level, regionMin.Y >> level, regionMin.Z >> level);
+		for (int32 z = regionMin.Z >> level; z <= regionMax.Z >> level; z++)
+		{
+			for (int32 y = regionMin.Y >> level; y <= regionMax.Y >> level; y++)
+			{
+				for (int32 x = regionMin.X >> level; x <= regionMax.X >> level; x++)
+				{
+					outMin = FMath::Min(outMin, GetMipMin(level, x, y, z));
+					outMax = FMath::Max(outMax, GetMipMax(level, x, y, z));
+				}
+			}
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Recalculate the mip chain for the region that has been modified since the last update
+	/// </summary>
+	void UpdateMipChain()
+	{
+		if (!bMipChainDirty || mipLevels.Num() == 0) return;
+
+		FIntVector3 levelDirtyMin = mipDirtyMin;
+		FIntVector3 levelDirtyMax = mipDirtyMax;
+		for (int32 level = 1; level <= mipLevels.Num(); level++)
+		{
+			// Each parent covers a 2x2x2 block of the level below, so the dirty region halves with every level
+			levelDirtyMin = FIntVector3(levelDirtyMin.X / 2, levelDirtyMin.Y / 2, levelDirtyMin.Z / 2);
+			levelDirtyMax = FIntVector3(levelDirtyMax.X / 2, levelDirtyMax.Y / 2, levelDirtyMax.Z / 2);
+
+			FIntVector3 childSize = GetMipLevelSize(level - 1);
+			FMipLevel& mipLevel = mipLevels[level - 1];
+			for (int32 z = levelDirtyMin.Z; z <= levelDirtyMax.Z; z++)
+			{
+				for (int32 y = levelDirtyMin.Y; y <= levelDirtyMax.Y; y++)
+				{
+					for (int32 x = levelDirtyMin.X; x <= levelDirtyMax.X; x++)
+					{
+						T blockMin = GetMipMin(level - 1, 2 * x, 2 * y, 2 * z);
+						T blockMax = GetMipMax(level - 1, 2 * x, 2 * y, 2 * z);
+						T blockSum = T();
+						int32 blockCount = 0;
+
+						// Blocks on the far boundary of odd sized levels are only partially filled
+						for (int32 k = 2 * z; k < FMath::Min(2 * z + 2, childSize.Z); k++)
+						{
+							for (int32 j = 2 * y; j < FMath::Min(2 * y + 2, childSize.Y); j++)
+							{
+								for (int32 i = 2 * x; i < FMath::Min(2 * x + 2, childSize.X); i++)
+								{
+									blockMin = FMath::Min(blockMin, GetMipMin(level - 1, i, j, k));
+									blockMax = FMath::Max(blockMax, GetMipMax(level - 1, i, j, k));
+									blockSum += GetMipAverage(level - 1, i, j, k);
+									blockCount++;
+								}
+							}
+						}
+
+						int32 index = mipLevel.GetIndex(x, y, z);
+						mipLevel.minValues[index] = blockMin;
+						mipLevel.maxValues[index] = blockMax;
+						mipLevel.averageValues[index] = blockSum / blockCount;
+					}
+				}
+			}
+		}
+
+		bMipChainDirty = false;
+	}
+
+	/// <summary>
+	/// Maintain one bit per element recording whether it lies above the threshold, packed as one 64 bit word per 4x4x4 block.
+	/// The mask is kept up to date by every call to SetElement.
+	/// </summary>
+	/// <param name="threshold">The value that elements are compared against, normally the isovalue</param>
+	void EnableSignMask(T threshold)
+	{
+		signMaskThreshold = threshold;
+		signMask.Initialise(sizeX, sizeY, sizeZ);
+
+		for (int32 z = 0; z < sizeZ; z++)
+		{
+			for (int32 y = 0; y < sizeY; y++)
+			{
+				for (int32 x = 0; x < sizeX; x++)
+				{
+					signMask.SetBit(x, y, z, data[GetArrayIndex(x, y, z)] > threshold);
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Release the sign mask so that writes no longer update it
+	/// </summary>
+	void DisableSignMask()
+	{
+		signMask.Empty();
+	}
+
+	bool HasSignMask() const
+	{
+		return !signMask.IsEmpty();
+	}
+
+	T GetSignMaskThreshold() const
+	{
+		return signMaskThreshold;
+	}
+
+	/// <summary>
+	/// Get the sign mask, which records whether each element lies above the threshold without reading the element itself
+	/// </summary>
+	const FSignMask3D& GetSignMask() const
+	{
+		return signMask;
+	}
+
 private:
+	// The number of points modified at once above which the sign mask is updated in parallel
+	static constexpr int64 ParallelSignMaskThreshold = 64 * 64 * 64;
+
+	/// <summary>
+	/// Grow the region of the mip chain that must be recalculated to include the given coordinate
+	/// </summary>
+	void MarkMipChainDirty(int32 x, int32 y, int32 z)
+	{
+		if (!bMipChainDirty)
+		{
+			mipDirtyMin = FIntVector3(x, y, z);
+			mipDirtyMax = FIntVector3(x, y, z);
+			bMipChainDirty = true;
+			return;
+		}
+		mipDirtyMin = FIntVector3(FMath::Min(mipDirtyMin.X, x), FMath::Min(mipDirtyMin.Y, y), FMath::Min(mipDirtyMin.Z, z));
+		mipDirtyMax = FIntVector3(FMath::Max(mipDirtyMax.X, x), FMath::Max(mipDirtyMax.Y, y), FMath::Max(mipDirtyMax.Z, z));
+	}
+
+	// A single coarse level of the mip chain
+	struct FMipLevel
+	{
+		int32 sizeX = 0, sizeY = 0, sizeZ = 0;
+		TArray<T> minValues;
+		TArray<T> maxValues;
+		TArray<T> averageValues;
+
+		int32 GetIndex(int32 x, int32 y, int32 z) const
+		{
+			return x + (y * sizeX) + (z * sizeX * sizeY);
+		}
+	};
 
 	TArray<T> data;
 	int32 sizeX, sizeY, sizeZ;
+
+	// The coarse levels of the mip chain, empty when the mip chain is disabled
+	TArray<FMipLevel> mipLevels;
+
+	// The inclusive bounds of the full resolution region that has changed since the mip chain was last updated
+	bool bMipChainDirty = false;
+	FIntVector3 mipDirtyMin;
+	FIntVector3 mipDirtyMax;
+
+	// One bit per element set when the element is above signMaskThreshold. Empty when disabled
+	FSignMask3D signMask;
+	T signMaskThreshold = T();
 };
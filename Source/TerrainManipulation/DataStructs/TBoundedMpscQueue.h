@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/UniquePtr.h"
+#include <atomic>
+
+/**
+ * A fixed capacity ring buffer that any number of threads can push into without locking, and a single thread pops from.
+ * Each slot carries a sequence number that says whether it is free for the producer whose turn it is or ready for the consumer,
+ * so producers only contend on claiming a position and never wait on each other. A full queue rejects the push rather than growing
+ */
+template <typename T>
+class TERRAINMANIPULATION_API TBoundedMpscQueue
+{
+public:
+	explicit TBoundedMpscQueue(int32 capacity = 1024)
+	{
+		Reset(capacity);
+	}
+
+	TBoundedMpscQueue(const TBoundedMpscQueue&) = delete;
+	TBoundedMpscQueue& operator=(const TBoundedMpscQueue&) = delete;
+
+	/// <summary>
+	/// Discard every item and reallocate the ring. Not thread safe, so it must only be called while nothing is pushing or popping
+	/// </summary>
+	/// <param name="capacity">The number of items the queue can hold, rounded up to a power of two</param>
+	void Reset(int32 capacity)
+	{
+		int32 slotCount = (int32)FMath::RoundUpToPowerOfTwo((uint32)FMath::Max(capacity, 2));
+		slots = MakeUnique<FSlot[]>(slotCount);
+		for (int32 i = 0; i < slotCount; i++)
+		{
+			slots[i].sequence.store((uint64)i, std::memory_order_relaxed);
+		}
+		indexMask = (uint64)slotCount - 1;
+		enqueuePosition.store(0, std::memory_order_relaxed);
+		dequeuePosition.store(0, std::memory_order_relaxed);
+		rejectedCount.store(0, std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Push an item from any thread
+	/// </summary>
+	/// <returns>False if the queue is full, in which case the item is not added and the rejection is counted</returns>
+	bool TryEnqueue(const T& item)
+	{
+		return TryEnqueueWith([&item](T& slotValue) { slotValue = item; });
+	}
+
+	bool TryEnqueue(T&& item)
+	{
+		return TryEnqueueWith([&item](T& slotValue) { slotValue = MoveTemp(item); });
+	}
+
+	/// <summary>
+	/// Pop the oldest item. Only one thread may call this
+	/// </summary>
+	/// <returns>False if the queue is empty, or the oldest item is still being written by its producer</returns>
+	bool TryDequeue(T& outItem)
+	{
+		uint64 position = dequeuePosition.load(std::memory_order_relaxed);
+		FSlot& slot = slots[position & indexMask];
+		if ((int64)(slot.sequence.load(std::memory_order_acquire) - (position + 1)) < 0)
+		{
+			return false;
+		}
+
+		outItem = MoveTemp(slot.value);
+
+		// The slot becomes free for the producer one full lap of the ring later
+		slot.sequence.store(position + indexMask + 1, std::memory_order_release);
+		dequeuePosition.store(position + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	int32 GetCapacity() const
+	{
+		return (int32)(indexMask + 1);
+	}
+
+	/// <summary>
+	/// Get the number of items in the queue. Pushes and pops on other threads may change it before it is read
+	/// </summary>
+	int32 GetApproximateNum() const
+	{
+		int64 count = (int64)(enqueuePosition.load(std::memory_order_relaxed) - dequeuePosition.load(std::memory_order_relaxed));
+		return (int32)FMath::Clamp<int64>(count, 0, GetCapacity());
+	}
+
+	/// <summary>
+	/// Get the number of pushes rejected because the queue was full since the count was last taken, and reset the count
+	/// </summary>
+	int32 TakeRejectedCount()
+	{
+		return rejectedCount.exchange(0, std::memory_order_relaxed);
+	}
+
+private:
+	struct FSlot
+	{
+		// Equal to the position of the producer that may write the slot, or one more than that once the value is ready to be read
+		std::atomic<uint64> sequence = 0;
+
+		T value;
+	};
+
+	template <typename WriteFunctionType>
+	bool TryEnqueueWith(WriteFunctionType writeValue)
+	{
+		uint64 position = enqueuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			FSlot& slot = slots[position & indexMask];
+			int64 difference = (int64)(slot.sequence.load(std::memory_order_acquire) - position);
+			if (difference == 0)
+			{
+				// The slot is free, so try to claim this position before another producer does
+				if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					writeValue(slot.value);
+					slot.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+			{
+				// The slot still holds an item from the previous lap that the consumer has not popped
+				rejectedCount.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else
+			{
+				// Another producer claimed this position first
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	TUniquePtr<FSlot[]> slots;
+
+	uint64 indexMask = 0;
+
+	// Producers and the consumer each own one position, kept on separate cache lines so that they do not slow each other down
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> enqueuePosition = 0;
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> dequeuePosition = 0;
+
+	std::atomic<int32> rejectedCount = 0;
+};
@@ -0,0 +1,385 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SignMask3D.h"
+#include "TArray3D.h"
+
+/**
+ * A 3D array that only keeps full precision values near the isosurface.
+ * Elements are grouped into 8x8x8 bricks, and bricks are only stored when they lie within the band of the surface.
+ * Everywhere else only the sign of each element is kept, and it reads back as threshold +/- farValue.
+ */
+template <typename T>
+class TERRAINMANIPULATION_API TNarrowBandArray3D
+{
+public:
+	static constexpr int32 BrickSize = 8;
+	static constexpr int32 BrickElementCount = BrickSize * BrickSize * BrickSize;
+
+	TNarrowBandArray3D<T>() : TNarrowBandArray3D<T>(1, 1, 1, T(), T(), 1)
+	{
+	}
+	/// <summary>
+	/// Create an array with every element below the threshold and no bricks stored
+	/// </summary>
+	/// <param name="threshold">The value that separates the two sides of the surface, normally the isovalue</param>
+	/// <param name="farValue">The distance from the threshold reported for elements outside of the band</param>
+	/// <param name="bandWidth">The number of elements either side of the surface that keep full precision values</param>
+	TNarrowBandArray3D<T>(int32 sizeX, int32 sizeY, int32 sizeZ, T threshold, T farValue, int32 bandWidth)
+	{
+		this->sizeX = sizeX;
+		this->sizeY = sizeY;
+		this->sizeZ = sizeZ;
+		this->threshold = threshold;
+		this->farValue = farValue;
+		this->bandWidth = bandWidth;
+
+		brickCountX = FMath::DivideAndRoundUp(sizeX, BrickSize);
+		brickCountY = FMath::DivideAndRoundUp(sizeY, BrickSize);
+		brickCountZ = FMath::DivideAndRoundUp(sizeZ, BrickSize);
+		brickSlots.Init(INDEX_NONE, brickCountX * brickCountY * brickCountZ);
+		signMask.Initialise(sizeX, sizeY, sizeZ);
+	}
+
+	/// <summary>
+	/// Convert a dense array into the narrow band representation, discarding values away from the surface
+	/// </summary>
+	/// <param name="dense">The full resolution values</param>
+	/// <param name="threshold">The value that separates the two sides of the surface, normally the isovalue</param>
+	/// <param name="farValue">The distance from the threshold reported for elements outside of the band</param>
+	/// <param name="bandWidth">The number of elements either side of the surface that keep full precision values</param>
+	/// <returns>The narrow band array</returns>
+	static TNarrowBandArray3D<T> FromDense(const TArray3D<T>& dense, T threshold, T farValue, int32 bandWidth)
+	{
+		TNarrowBandArray3D<T> result(dense.GetSize(0), dense.GetSize(1), dense.GetSize(2), threshold, farValue, bandWidth);
+		for (int32 z = 0; z < result.sizeZ; z++)
+		{
+			for (int32 y = 0; y < result.sizeY; y++)
+			{
+				for (int32 x = 0; x < result.sizeX; x++)
+				{
+					result.signMask.SetBit(x, y, z, dense.GetElement(x, y, z) > threshold);
+				}
+			}
+		}
+
+		// Decide the band from the signs alone, then fill the stored bricks with their true values
+		result.UpdateBand();
+		for (int32 brickIndex = 0; brickIndex < result.brickSlots.Num(); brickIndex++)
+		{
+			if (result.brickSlots[brickIndex] == INDEX_NONE) continue;
+
+			FIntVector3 brickOrigin = result.GetBrickOrigin(brickIndex);
+			for (int32 z = brickOrigin.Z; z < FMath::Min(brickOrigin.Z + BrickSize, result.sizeZ); z++)
+			{
+				for (int32 y = brickOrigin.Y; y < FMath::Min(brickOrigin.Y + BrickSize, result.sizeY); y++)
+				{
+					for (int32 x = brickOrigin.X; x < FMath::Min(brickOrigin.X + BrickSize, result.sizeX); x++)
+					{
+						result.brickPool[result.GetPoolIndex(result.brickSlots[brickIndex], x, y, z)] = dense.GetElement(x, y, z);
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// Get the element at the specified (x,y,z) coordinates
+	/// </summary>
+	/// <returns>The stored value inside the band, otherwise threshold +/- farValue depending on the side of the surface</returns>
+	T GetElement(int32 x, int32 y, int32 z) const
+	{
+		int32 slot = brickSlots[GetBrickIndex(x / BrickSize, y / BrickSize, z / BrickSize)];
+		if (slot != INDEX_NONE)
+		{
+			return brickPool[GetPoolIndex(slot, x, y, z)];
+		}
+		return signMask.GetBit(x, y, z) ? threshold + farValue : threshold - farValue;
+	}
+	T GetElement(FIntVector3 indices) const
+	{
+		return GetElement(indices.X, indices.Y, indices.Z);
+	}
+
+	/// <summary>
+	/// Set the value of the element at the specified (x,y,z) coordinates.
+	/// Writing outside of the band stores the brick containing the element, so edits automatically grow the band.
+	/// </summary>
+	/// <param name="value">The value to be set</param>
+	void SetElement(int32 x, int32 y, int32 z, T value)
+	{
+		int32 brickIndex = GetBrickIndex(x / BrickSize, y / BrickSize, z / BrickSize);
+		if (brickSlots[brickIndex] == INDEX_NONE)
+		{
+			AllocateBrick(brickIndex);
+		}
+		brickPool[GetPoolIndex(brickSlots[brickIndex], x, y, z)] = value;
+		signMask.SetBit(x, y, z, value > threshold);
+	}
+	void SetElement(FIntVector3 indices, T value)
+	{
+		SetElement(indices.X, indices.Y, indices.Z, value);
+	}
+
+	int32 GetSize(int32 coordinateAxis) const
+	{
+		switch (coordinateAxis)
+		{
+		case 0:
+			return sizeX;
+		case 1:
+			return sizeY;
+		case 2:
+			return sizeZ;
+		default:
+			return 0;
+		}
+	}
+
+	bool IsValidIndex(int32 x, int32 y, int32 z) const
+	{
+		if (x < 0 || x >= sizeX) return false;
+		if (y < 0 || y >= sizeY) return false;
+		if (z < 0 || z >= sizeZ) return false;
+
+		return true;
+	}
+
+	T GetThreshold() const
+	{
+		return threshold;
+	}
+
+	/// <summary>
+	/// Get the sign mask, which records whether each element lies above the threshold for the whole array
+	/// </summary>
+	const FSignMask3D& GetSignMask() const
+	{
+		return signMask;
+	}
+
+	/// <summary>
+	/// Recalculate the band for the whole array
+	/// </summary>
+	void UpdateBand()
+	{
+		UpdateBand(FIntVector3(0, 0, 0), FIntVector3(sizeX - 1, sizeY - 1, sizeZ - 1));
+	}
+
+	/// <summary>
+	/// Store the bricks that have moved into the band and release the bricks that have left it, after the region has been edited
+	/// </summary>
+	/// <param name="regionMin">The lowest coordinate of the edited region (inclusive)</param>
+	/// <param name="regionMax">The highest coordinate of the edited region (inclusive)</param>
+	void UpdateBand(FIntVector3 regionMin, FIntVector3 regionMax)
+	{
+		int32 bandBricks = FMath::DivideAndRoundUp(bandWidth, BrickSize);
+
+		// Membership of a brick depends on the surface within bandBricks of it, and the edit can change membership up to bandBricks away
+		FIntVector3 updateMin = ClampBrick(FIntVector3(regionMin.X / BrickSize - bandBricks, regionMin.Y / BrickSize - bandBricks, regionMin.Z / BrickSize - bandBricks));
+		FIntVector3 updateMax = ClampBrick(FIntVector3(regionMax.X / BrickSize + bandBricks, regionMax.Y / BrickSize + bandBricks, regionMax.Z / BrickSize + bandBricks));
+		FIntVector3 surfaceMin = ClampBrick(updateMin - FIntVector3(bandBricks));
+		FIntVector3 surfaceMax = ClampBrick(updateMax + FIntVector3(bandBricks));
+
+		FIntVector3 surfaceExtent = surfaceMax - surfaceMin + FIntVector3(1);
+		TArray<bool> surfaceBricks;
+		surfaceBricks.SetNumUninitialized(surfaceExtent.X * surfaceExtent.Y * surfaceExtent.Z);
+		for (int32 k = surfaceMin.Z; k <= surfaceMax.Z; k++)
+		{
+			for (int32 j = surfaceMin.Y; j <= surfaceMax.Y; j++)
+			{
+				for (int32 i = surfaceMin.X; i <= surfaceMax.X; i++)
+				{
+					int32 localIndex = (i - surfaceMin.X) + surfaceExtent.X * ((j - surfaceMin.Y) + surfaceExtent.Y * (k - surfaceMin.Z));
+					surfaceBricks[localIndex] = DoesBrickContainSurface(i, j, k);
+				}
+			}
+		}
+
+		for (int32 k = updateMin.Z; k <= updateMax.Z; k++)
+		{
+			for (int32 j = updateMin.Y; j <= updateMax.Y; j++)
+			{
+				for (int32 i = updateMin.X; i <= updateMax.X; i++)
+				{
+					bool bInBand = false;
+					for (int32 c = FMath::Max(k - bandBricks, surfaceMin.Z); c <= FMath::Min(k + bandBricks, surfaceMax.Z) && !bInBand; c++)
+					{
+						for (int32 b = FMath::Max(j - bandBricks, surfaceMin.Y); b <= FMath::Min(j + bandBricks, surfaceMax.Y) && !bInBand; b++)
+						{
+							for (int32 a = FMath::Max(i - bandBricks, surfaceMin.X); a <= FMath::Min(i + bandBricks, surfaceMax.X) && !bInBand; a++)
+							{
+								bInBand = surfaceBricks[(a - surfaceMin.X) + surfaceExtent.X * ((b - surfaceMin.Y) + surfaceExtent.Y * (c - surfaceMin.Z))];
+							}
+						}
+					}
+
+					int32 brickIndex = GetBrickIndex(i, j, k);
+					if (bInBand && brickSlots[brickIndex] == INDEX_NONE)
+					{
+						AllocateBrick(brickIndex);
+					}
+					else if (!bInBand && brickSlots[brickIndex] != INDEX_NONE)
+					{
+						FreeBrick(brickIndex);
+					}
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Copy a box of elements into a dense array, starting from regionMin
+	/// </summary>
+	/// <param name="out">The dense array to fill, whose size determines the size of the box</param>
+	/// <param name="regionMin">The coordinate of this array that maps onto (0,0,0) of the dense array</param>
+	void CopyRegionTo(TArray3D<T>& out, FIntVector3 regionMin) const
+	{
+		for (int32 z = 0; z < out.GetSize(2); z++)
+		{
+			for (int32 y = 0; y < out.GetSize(1); y++)
+			{
+				for (int32 x = 0; x < out.GetSize(0); x++)
+				{
+					out.SetElement(x, y, z, GetElement(regionMin.X + x, regionMin.Y + y, regionMin.Z + z));
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Write back a dense copy of a box of elements, such as one taken with CopyRegionTo and then edited.
+	/// Only elements whose value has changed are written, so unchanged bricks outside the band stay unallocated
+	/// </summary>
+	/// <param name="source">The dense array to read from, whose size determines the size of the box</param>
+	/// <param name="regionMin">The coordinate of this array that maps onto (0,0,0) of the dense array</param>
+	void WriteRegionFrom(const TArray3D<T>& source, FIntVector3 regionMin)
+	{
+		for (int32 z = 0; z < source.GetSize(2); z++)
+		{
+			for (int32 y = 0; y < source.GetSize(1); y++)
+			{
+				const T* row = source.GetRowData(y, z);
+				for (int32 x = 0; x < source.GetSize(0); x++)
+				{
+					if (row[x] != GetElement(regionMin.X + x, regionMin.Y + y, regionMin.Z + z))
+					{
+						SetElement(regionMin.X + x, regionMin.Y + y, regionMin.Z + z, row[x]);
+					}
+				}
+			}
+		}
+	}
+
+private:
+	int32 GetBrickIndex(int32 brickX, int32 brickY, int32 brickZ) const
+	{
+		return brickX + (brickY * brickCountX) + (brickZ * brickCountX * brickCountY);
+	}
+
+	FIntVector3 GetBrickOrigin(int32 brickIndex) const
+	{
+		int32 brickX = brickIndex % brickCountX;
+		int32 brickY = (brickIndex / brickCountX) % brickCountY;
+		int32 brickZ = brickIndex / (brickCountX * brickCountY);
+		return FIntVector3(brickX * BrickSize, brickY * BrickSize, brickZ * BrickSize);
+	}
+
+	FIntVector3 ClampBrick(FIntVector3 brick) const
+	{
+		return FIntVector3(FMath::Clamp(brick.X, 0, brickCountX - 1), FMath::Clamp(brick.Y, 0, brickCountY - 1), FMath::Clamp(brick.Z, 0, brickCountZ - 1));
+	}
+
+	/// <summary>
+	/// Get the index of an element within the brick pool, given the slot of the brick that contains it
+	/// </summary>
+	static int32 GetPoolIndex(int32 slot, int32 x, int32 y, int32 z)
+	{
+		return slot * BrickElementCount + (x % BrickSize) + (y % BrickSize) * BrickSize + (z % BrickSize) * BrickSize * BrickSize;
+	}
+
+	/// <summary>
+	/// Check whether any cell starting inside the brick straddles the threshold, using the 2x2x2 sign mask blocks that make up the brick
+	/// </summary>
+	bool DoesBrickContainSurface(int32 brickX, int32 brickY, int32 brickZ) const
+	{
+		constexpr int32 blocksPerBrick = BrickSize / 4;
+		for (int32 k = brickZ * blocksPerBrick; k < FMath::Min((brickZ + 1) * blocksPerBrick, signMask.GetBlockCount(2)); k++)
+		{
+			for (int32 j = brickY * blocksPerBrick; j < FMath::Min((brickY + 1) * blocksPerBrick, signMask.GetBlockCount(1)); j++)
+			{
+				for (int32 i = brickX * blocksPerBrick; i < FMath::Min((brickX + 1) * blocksPerBrick, signMask.GetBlockCount(0)); i++)
+				{
+					if (signMask.CanBlockContainSurface(i, j, k)) return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	/// <summary>
+	/// Give a brick storage in the pool, seeding its values from the sign of each element
+	/// </summary>
+	void AllocateBrick(int32 brickIndex)
+	{
+		int32 slot;
+		if (freeSlots.Num() > 0)
+		{
+			slot = freeSlots.Pop(EAllowShrinking::No);
+		}
+		else
+		{
+			slot = brickPool.Num() / BrickElementCount;
+			brickPool.AddUninitialized(BrickElementCount);
+		}
+		brickSlots[brickIndex] = slot;
+
+		FIntVector3 brickOrigin = GetBrickOrigin(brickIndex);
+		for (int32 z = brickOrigin.Z; z < brickOrigin.Z + BrickSize; z++)
+		{
+			for (int32 y = brickOrigin.Y; y < brickOrigin.Y + BrickSize; y++)
+			{
+				for (int32 x = brickOrigin.X; x < brickOrigin.X + BrickSize; x++)
+				{
+					// Elements overhanging the far boundary of the array are never read, so give them a neutral value
+					bool bAbove = IsValidIndex(x, y, z) && signMask.GetBit(x, y, z);
+					brickPool[GetPoolIndex(slot, x, y, z)] = bAbove ? threshold + farValue : threshold - farValue;
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Return the storage of a brick to the pool, after which its elements only keep their signs
+	/// </summary>
+	void FreeBrick(int32 brickIndex)
+	{
+		freeSlots.Add(brickSlots[brickIndex]);
+		brickSlots[brickIndex] = INDEX_NONE;
+	}
+
+	int32 sizeX, sizeY, sizeZ;
+	int32 brickCountX, brickCountY, brickCountZ;
+
+	// The value separating the two sides of the surface, and the offset from it reported for elements outside of the band
+	T threshold;
+	T farValue;
+
+	// The number of elements either side of the surface that keep full precision values
+	int32 bandWidth;
+
+	// For every brick, the slot in brickPool holding its values, or INDEX_NONE if only the signs are kept
+	TArray<int32> brickSlots;
+
+	// The values of all stored bricks, BrickElementCount at a time
+	TArray<T> brickPool;
+
+	// Slots in brickPool released by bricks leaving the band, reused before the pool grows
+	TArray<int32> freeSlots;
+
+	// The side of the surface for every element, including those outside of the band
+	FSignMask3D signMask;
+};
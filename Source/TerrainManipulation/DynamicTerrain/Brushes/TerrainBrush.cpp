@@ -0,0 +1,544 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainBrush.h"
+#include "Math/VectorRegister.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	/// <summary>
+	/// Apply an operation that does not depend on the position of the point to a span, four points at a time
+	/// </summary>
+	template <typename VectorOperation, typename ScalarOperation>
+	void ApplyUniformToSpan(float* row, int32 count, VectorOperation vectorOperation, ScalarOperation scalarOperation)
+	{
+		int32 x = 0;
+		for (; x + 4 <= count; x += 4)
+		{
+			VectorStore(vectorOperation(VectorLoad(row + x)), row + x);
+		}
+		for (; x < count; x++)
+		{
+			row[x] = scalarOperation(row[x]);
+		}
+	}
+
+	/// <summary>
+	/// A copy of a box of the grid that is box filtered in place with separable passes along each axis
+	/// </summary>
+	class FFilterScratch
+	{
+	public:
+		/// <summary>
+		/// Copy a box of the grid into the scratch buffer
+		/// </summary>
+		/// <param name="grid">The grid to copy from</param>
+		/// <param name="regionMin">The indices of the first point to copy, within the grid</param>
+		/// <param name="regionSize">The number of points to copy along each axis</param>
+		/// <param name="bParallel">Whether the lines of each pass are split across worker threads</param>
+		void Load(const TArray3D<float>& grid, FIntVector3 regionMin, FIntVector3 regionSize, bool bParallel)
+		{
+			this->bParallel = bParallel;
+			size = regionSize;
+			values.SetNumUninitialized(size.X * size.Y * size.Z);
+			filtered.SetNumUninitialized(values.Num());
+			for (int32 z = 0; z < size.Z; z++)
+			{
+				for (int32 y = 0; y < size.Y; y++)
+				{
+					const float* sourceRow = grid.GetRowData(regionMin.Y + y, regionMin.Z + z) + regionMin.X;
+					FMemory::Memcpy(&values[GetIndex(0, y, z)], sourceRow, size.X * sizeof(float));
+				}
+			}
+		}
+
+		/// <summary>
+		/// Replace every value with the average of the values within radius along X.
+		/// Each row is a serial running sum, so this pass is not vectorised
+		/// </summary>
+		void BoxFilterX(int32 radius)
+		{
+			if (radius <= 0 || size.X <= 1) return;
+
+			ParallelFor(size.Y * size.Z, [&](int32 rowIndex)
+				{
+					int32 rowStart = rowIndex * size.X;
+					const float* in = &values[rowStart];
+					float* out = &filtered[rowStart];
+					double sum = 0;
+					int32 low = 0, high = -1;
+					for (int32 x = 0; x < size.X; x++)
+					{
+						for (int32 newHigh = FMath::Min(x + radius, size.X - 1); high < newHigh;) sum += in[++high];
+						for (int32 newLow = FMath::Max(x - radius, 0); low < newLow;) sum -= in[low++];
+						out[x] = (float)(sum / (high - low + 1));
+					}
+				}, !bParallel);
+			Swap(values, filtered);
+		}
+
+		/// <summary>
+		/// Replace every value with the average of the values within radius along Y
+		/// </summary>
+		void BoxFilterY(int32 radius)
+		{
+			if (radius <= 0 || size.Y <= 1) return;
+			BoxFilterAcrossRows(radius, size.Y, size.X, size.Z, size.X * size.Y);
+		}
+
+		/// <summary>
+		/// Replace every value with the average of the values within radius along Z
+		/// </summary>
+		void BoxFilterZ(int32 radius)
+		{
+			if (radius <= 0 || size.Z <= 1) return;
+			BoxFilterAcrossRows(radius, size.Z, size.X * size.Y, size.Y, size.X);
+		}
+
+		/// <summary>
+		/// Get the first filtered value of a row along X
+		/// </summary>
+		const float* GetRow(int32 y, int32 z) const
+		{
+			return &values[GetIndex(0, y, z)];
+		}
+
+	private:
+		int32 GetIndex(int32 x, int32 y, int32 z) const
+		{
+			return x + size.X * (y + size.Y * z);
+		}
+
+		/// <summary>
+		/// Box filter along an axis other than X, where each step along the axis moves a whole contiguous row.
+		/// A running sum of rows is kept, so every add, subtract and scale works on four values at a time.
+		/// The sums are doubles like those of the X pass, so that long lines do not drift
+		/// </summary>
+		/// <param name="radius">The number of rows either side to average</param>
+		/// <param name="axisLength">The number of rows along the axis being filtered</param>
+		/// <param name="axisStride">The distance in the buffer between neighbouring rows along the axis</param>
+		/// <param name="lineCount">The number of independent lines of rows along the other axis</param>
+		/// <param name="lineStride">The distance in the buffer between neighbouring lines</param>
+		void BoxFilterAcrossRows(int32 radius, int32 axisLength, int32 axisStride, int32 lineCount, int32 lineStride)
+		{
+			// Every line has its own running sum in the one buffer, which is kept between the Y and Z passes
+			rowSums.SetNumUninitialized(lineCount * size.X, EAllowShrinking::No);
+			ParallelFor(lineCount, [&](int32 line)
+				{
+					double* rowSum = &rowSums[line * size.X];
+					FMemory::Memzero(rowSum, size.X * sizeof(double));
+					int32 low = 0, high = -1;
+					for (int32 step = 0; step < axisLength; step++)
+					{
+						for (int32 newHigh = FMath::Min(step + radius, axisLength - 1); high < newHigh;)
+						{
+							high++;
+							CombineRows(rowSum, &values[line * lineStride + high * axisStride], 1.0);
+						}
+						for (int32 newLow = FMath::Max(step - radius, 0); low < newLow; low++)
+						{
+							CombineRows(rowSum, &values[line * lineStride + low * axisStride], -1.0);
+						}
+
+						double scale = 1.0 / (high - low + 1);
+						float* out = &filtered[line * lineStride + step * axisStride];
+						const VectorRegister4Double scaleVector = VectorSetDouble1(scale);
+						int32 x = 0;
+						for (; x + 4 <= size.X; x += 4)
+						{
+							VectorStore(MakeVectorRegisterFloatFromDouble(VectorMultiply(VectorLoad(rowSum + x), scaleVector)), out + x);
+						}
+						for (; x < size.X; x++)
+						{
+							out[x] = (float)(rowSum[x] * scale);
+						}
+					}
+				}, !bParallel);
+			Swap(values, filtered);
+		}
+
+		/// <summary>
+		/// Add a row multiplied by a sign onto the running sum
+		/// </summary>
+		void CombineRows(double* rowSum, const float* row, double sign) const
+		{
+			const VectorRegister4Double signVector = VectorSetDouble1(sign);
+			int32 x = 0;
+			for (; x + 4 <= size.X; x += 4)
+			{
+				VectorStore(VectorMultiplyAdd(VectorRegister4Double(VectorLoad(row + x)), signVector, VectorLoad(rowSum + x)), rowSum + x);
+			}
+			for (; x < size.X; x++)
+			{
+				rowSum[x] += row[x] * sign;
+			}
+		}
+
+		// The number of points along each axis of the box
+		FIntVector3 size;
+
+		// The current values of the box
+		TArray<float> values;
+
+		// The destination of the pass in progress, swapped with values when the pass is complete
+		TArray<float> filtered;
+
+		// The running sum of rows of each line in a Y or Z pass
+		TArray<double> rowSums;
+
+		// Whether the lines of each pass are split across worker threads
+		bool bParallel = false;
+	};
+}
+
+FVector FTerrainBrush::GetBoundingHalfExtents() const
+{
+	// Growing the influence term scales the shape about its centre, except for the straight section of a capsule
+	double influenceScale = FMath::Sqrt(GetInfluenceTerm());
+	double scaledRadius = radius * influenceScale;
+	switch (shape) {
+	case ETerrainBrushShape::TBS_Box:
+		return halfExtents * influenceScale;
+	case ETerrainBrushShape::TBS_Capsule:
+		return FVector(scaledRadius, scaledRadius, scaledRadius + halfHeight);
+	case ETerrainBrushShape::TBS_Cylinder:
+		return FVector(scaledRadius, scaledRadius, halfHeight * influenceScale);
+	case ETerrainBrushShape::TBS_Sphere:
+	default:
+		return FVector(scaledRadius, scaledRadius, scaledRadius);
+	}
+}
+
+bool FTerrainBrush::IsAdditive() const
+{
+	return mode == ETerrainBrushMode::TBM_Add || mode == ETerrainBrushMode::TBM_Subtract || mode == ETerrainBrushMode::TBM_SmoothFalloff;
+}
+
+bool FTerrainBrush::IsIdempotent() const
+{
+	// The filters and the smoothed maximum move the field again on every pass, so only the modes that write a fixed target qualify
+	return mode == ETerrainBrushMode::TBM_Set || mode == ETerrainBrushMode::TBM_Min || mode == ETerrainBrushMode::TBM_Max;
+}
+
+bool FTerrainBrush::HasSameShape(const FTerrainBrush& other) const
+{
+	if (shape != other.shape || mode != other.mode) return false;
+	if (mode == ETerrainBrushMode::TBM_Smooth && smoothRadius != other.smoothRadius) return false;
+	if (mode == ETerrainBrushMode::TBM_SmoothUnion && blendWidth != other.blendWidth) return false;
+	if (shape == ETerrainBrushShape::TBS_Box) return halfExtents == other.halfExtents;
+	if (shape == ETerrainBrushShape::TBS_Sphere) return radius == other.radius;
+	return radius == other.radius && halfHeight == other.halfHeight;
+}
+
+FGridRegion FTerrainBrush::GetAffectedPoints(FVector3f gridCellDimensions, FIntVector3 lowerBound, FIntVector3 upperBound) const
+{
+	FVector boundingHalfExtents = GetBoundingHalfExtents();
+	FIntVector3 minIndex(
+		FMath::CeilToInt32((centre.X - boundingHalfExtents.X) / gridCellDimensions.X),
+		FMath::CeilToInt32((centre.Y - boundingHalfExtents.Y) / gridCellDimensions.Y),
+		FMath::CeilToInt32((centre.Z - boundingHalfExtents.Z) / gridCellDimensions.Z));
+	FIntVector3 maxIndex(
+		FMath::FloorToInt32((centre.X + boundingHalfExtents.X) / gridCellDimensions.X),
+		FMath::FloorToInt32((centre.Y + boundingHalfExtents.Y) / gridCellDimensions.Y),
+		FMath::FloorToInt32((centre.Z + boundingHalfExtents.Z) / gridCellDimensions.Z));
+	return FGridRegion(minIndex, maxIndex).Clamped(lowerBound, upperBound);
+}
+
+FGridRegion FTerrainBrush::ApplyToGrid(TArray3D<float>& grid, FIntVector3 gridIndexOffset, FVector3f gridCellDimensions, int64 parallelPointThreshold) const
+{
+	if (GetRadiusX() <= 0)
+	{
+		return FGridRegion();
+	}
+
+	FIntVector3 gridUpperBound = gridIndexOffset + FIntVector3(grid.GetSize(0) - 1, grid.GetSize(1) - 1, grid.GetSize(2) - 1);
+	FGridRegion bounds = GetAffectedPoints(gridCellDimensions, gridIndexOffset, gridUpperBound);
+	if (bounds.IsEmpty())
+	{
+		return FGridRegion();
+	}
+
+	if (mode == ETerrainBrushMode::TBM_Smooth || mode == ETerrainBrushMode::TBM_Flatten)
+	{
+		return ApplyFilterToGrid(grid, gridIndexOffset, gridCellDimensions, bounds, parallelPointThreshold);
+	}
+
+	float stepT = gridCellDimensions.X / GetRadiusX();
+	FGridRegion modifiedRegion = ForEachRowSpan(gridCellDimensions, bounds, parallelPointThreshold,
+		[&](int32 y, int32 z, int32 startX, int32 endX, float firstT, float fixedTerm, float radialTerm)
+		{
+			float* row = grid.GetRowData(y - gridIndexOffset.Y, z - gridIndexOffset.Z) + (startX - gridIndexOffset.X);
+			ApplyToSpan(row, endX - startX + 1, firstT, stepT, fixedTerm, radialTerm);
+		});
+
+	if (!modifiedRegion.IsEmpty())
+	{
+		grid.MarkRegionModified(modifiedRegion.minIndex - gridIndexOffset, modifiedRegion.maxIndex - gridIndexOffset);
+	}
+	return modifiedRegion;
+}
+
+FGridRegion FTerrainBrush::ApplyFilterToGrid(TArray3D<float>& grid, FIntVector3 gridIndexOffset, FVector3f gridCellDimensions, const FGridRegion& bounds, int64 parallelPointThreshold) const
+{
+	FIntVector3 gridUpperBound = gridIndexOffset + FIntVector3(grid.GetSize(0) - 1, grid.GetSize(1) - 1, grid.GetSize(2) - 1);
+
+	// Smoothing reads a margin around the footprint, while flattening averages whole horizontal slices of the footprint and nothing beyond it
+	FGridRegion sourceRegion;
+	FIntVector3 filterRadius;
+	if (mode == ETerrainBrushMode::TBM_Smooth)
+	{
+		int32 radius = FMath::Max(smoothRadius, 1);
+		filterRadius = FIntVector3(radius, radius, radius);
+		sourceRegion = bounds.Expanded(radius).Clamped(gridIndexOffset, gridUpperBound);
+	}
+	else
+	{
+		filterRadius = FIntVector3(bounds.GetSize().X, bounds.GetSize().Y, 0);
+		sourceRegion = bounds;
+	}
+
+	FFilterScratch scratch;
+	scratch.Load(grid, sourceRegion.minIndex - gridIndexOffset, sourceRegion.GetSize(), sourceRegion.Num() >= parallelPointThreshold);
+	scratch.BoxFilterX(filterRadius.X);
+	scratch.BoxFilterY(filterRadius.Y);
+	scratch.BoxFilterZ(filterRadius.Z);
+
+	float stepT = gridCellDimensions.X / GetRadiusX();
+	FGridRegion modifiedRegion = ForEachRowSpan(gridCellDimensions, bounds, parallelPointThreshold,
+		[&](int32 y, int32 z, int32 startX, int32 endX, float firstT, float fixedTerm, float radialTerm)
+		{
+			float* row = grid.GetRowData(y - gridIndexOffset.Y, z - gridIndexOffset.Z) + (startX - gridIndexOffset.X);
+			const float* filteredRow = scratch.GetRow(y - sourceRegion.minIndex.Y, z - sourceRegion.minIndex.Z) + (startX - sourceRegion.minIndex.X);
+			BlendSpan(row, filteredRow, endX - startX + 1, firstT, stepT, fixedTerm, radialTerm);
+		});
+
+	if (!modifiedRegion.IsEmpty())
+	{
+		grid.MarkRegionModified(modifiedRegion.minIndex - gridIndexOffset, modifiedRegion.maxIndex - gridIndexOffset);
+	}
+	return modifiedRegion;
+}
+
+template <typename SpanFunction>
+FGridRegion FTerrainBrush::ForEachRowSpan(FVector3f gridCellDimensions, const FGridRegion& bounds, int64 parallelPointThreshold, SpanFunction spanFunction) const
+{
+	// Every slice writes to its own rows and records its own region, so the slices share nothing until the regions are merged
+	int32 sliceCount = bounds.GetSize().Z;
+	TArray<FGridRegion> sliceRegions;
+	sliceRegions.SetNum(sliceCount);
+	ParallelFor(sliceCount, [&](int32 slice)
+		{
+			int32 z = bounds.minIndex.Z + slice;
+			for (int32 y = bounds.minIndex.Y; y <= bounds.maxIndex.Y; y++)
+			{
+				int32 startX, endX;
+				float firstT, fixedTerm, radialTerm;
+				if (!GetRowSpan(y, z, gridCellDimensions, bounds, startX, endX, firstT, fixedTerm, radialTerm))
+				{
+					continue;
+				}
+
+				spanFunction(y, z, startX, endX, firstT, fixedTerm, radialTerm);
+				sliceRegions[slice].Include(FIntVector3(startX, y, z));
+				sliceRegions[slice].Include(FIntVector3(endX, y, z));
+			}
+		}, bounds.Num() < parallelPointThreshold);
+
+	FGridRegion modifiedRegion;
+	for (const FGridRegion& sliceRegion : sliceRegions)
+	{
+		modifiedRegion.Include(sliceRegion);
+	}
+	return modifiedRegion;
+}
+
+bool FTerrainBrush::GetRowSpan(int32 y, int32 z, FVector3f gridCellDimensions, const FGridRegion& bounds, int32& outStartX, int32& outEndX, float& outFirstT, float& outFixedTerm, float& outRadialTerm) const
+{
+	GetRowTerms(y * gridCellDimensions.Y - centre.Y, z * gridCellDimensions.Z - centre.Z, outFixedTerm, outRadialTerm);
+	float influenceTerm = GetInfluenceTerm();
+	if (outFixedTerm > influenceTerm || outRadialTerm > influenceTerm)
+	{
+		// The row misses the shape entirely
+		return false;
+	}
+
+	// Solve radialTerm + t^2 <= influenceTerm for the points of the row inside the shape
+	double radiusX = GetRadiusX();
+	double halfSpan = radiusX * FMath::Sqrt(influenceTerm - outRadialTerm);
+	outStartX = FMath::Max(FMath::CeilToInt32((centre.X - halfSpan) / gridCellDimensions.X), bounds.minIndex.X);
+	outEndX = FMath::Min(FMath::FloorToInt32((centre.X + halfSpan) / gridCellDimensions.X), bounds.maxIndex.X);
+	outFirstT = (outStartX * gridCellDimensions.X - centre.X) / radiusX;
+	return outStartX <= outEndX;
+}
+
+float FTerrainBrush::GetInfluenceTerm() const
+{
+	if (mode != ETerrainBrushMode::TBM_SmoothUnion || value <= 0)
+	{
+		return 1;
+	}
+
+	// The smoothed maximum moves a point wherever the shape's field, isovalue + value * (1 - d^2), is above the point's current value - blendWidth.
+	// The points that place the surface are those within blendWidth of the isovalue, so the shape is followed out to isovalue - 2 * blendWidth
+	return 1 + 2 * FMath::Max(blendWidth, 0.0f) / value;
+}
+
+double FTerrainBrush::GetRadiusX() const
+{
+	return shape == ETerrainBrushShape::TBS_Box ? halfExtents.X : radius;
+}
+
+void FTerrainBrush::GetRowTerms(double offsetY, double offsetZ, float& outFixedTerm, float& outRadialTerm) const
+{
+	switch (shape) {
+	case ETerrainBrushShape::TBS_Box:
+		outFixedTerm = FMath::Max(FMath::Square(offsetY / halfExtents.Y), FMath::Square(offsetZ / halfExtents.Z));
+		outRadialTerm = 0;
+		break;
+	case ETerrainBrushShape::TBS_Capsule:
+	{
+		// Measure from the nearest point on the central segment
+		double segmentOffsetZ = offsetZ - FMath::Clamp(offsetZ, (double)-halfHeight, (double)halfHeight);
+		outFixedTerm = 0;
+		outRadialTerm = (FMath::Square(offsetY) + FMath::Square(segmentOffsetZ)) / FMath::Square(radius);
+		break;
+	}
+	case ETerrainBrushShape::TBS_Cylinder:
+		outFixedTerm = halfHeight > 0 ? FMath::Square(offsetZ / halfHeight) : (offsetZ == 0 ? 0 : 2);
+		outRadialTerm = FMath::Square(offsetY) / FMath::Square(radius);
+		break;
+	case ETerrainBrushShape::TBS_Sphere:
+	default:
+		outFixedTerm = 0;
+		outRadialTerm = (FMath::Square(offsetY) + FMath::Square(offsetZ)) / FMath::Square(radius);
+		break;
+	}
+}
+
+void FTerrainBrush::ApplyToSpan(float* row, int32 count, float firstT, float stepT, float fixedTerm, float radialTerm) const
+{
+	const float brushValue = value;
+	const VectorRegister4Float brushVector = VectorSetFloat1(brushValue);
+
+	switch (mode) {
+	case ETerrainBrushMode::TBM_Add:
+		ApplyUniformToSpan(row, count,
+			[&](VectorRegister4Float current) { return VectorAdd(current, brushVector); },
+			[&](float current) { return current + brushValue; });
+		break;
+	case ETerrainBrushMode::TBM_Subtract:
+		ApplyUniformToSpan(row, count,
+			[&](VectorRegister4Float current) { return VectorSubtract(current, brushVector); },
+			[&](float current) { return current - brushValue; });
+		break;
+	case ETerrainBrushMode::TBM_Set:
+		ApplyUniformToSpan(row, count,
+			[&](VectorRegister4Float current) { return brushVector; },
+			[&](float current) { return brushValue; });
+		break;
+	case ETerrainBrushMode::TBM_Min:
+		ApplyUniformToSpan(row, count,
+			[&](VectorRegister4Float current) { return VectorMin(current, brushVector); },
+			[&](float current) { return FMath::Min(current, brushValue); });
+		break;
+	case ETerrainBrushMode::TBM_Max:
+		ApplyUniformToSpan(row, count,
+			[&](VectorRegister4Float current) { return VectorMax(current, brushVector); },
+			[&](float current) { return FMath::Max(current, brushValue); });
+		break;
+	case ETerrainBrushMode::TBM_SmoothFalloff:
+	{
+		// The weight (1 - d^2)^2 falls smoothly to zero at the edge, and avoids a square root per point
+		const VectorRegister4Float fixedVector = VectorSetFloat1(fixedTerm);
+		const VectorRegister4Float radialVector = VectorSetFloat1(radialTerm);
+		const VectorRegister4Float stepVector = VectorSetFloat1(stepT * 4);
+		VectorRegister4Float tVector = VectorMultiplyAdd(MakeVectorRegisterFloat(0.0f, 1.0f, 2.0f, 3.0f), VectorSetFloat1(stepT), VectorSetFloat1(firstT));
+
+		int32 x = 0;
+		for (; x + 4 <= count; x += 4)
+		{
+			VectorRegister4Float distanceSquared = VectorMax(fixedVector, VectorMultiplyAdd(tVector, tVector, radialVector));
+			VectorRegister4Float weight = VectorMax(VectorSubtract(GlobalVectorConstants::FloatOne, distanceSquared), GlobalVectorConstants::FloatZero);
+			weight = VectorMultiply(weight, weight);
+			VectorStore(VectorMultiplyAdd(weight, brushVector, VectorLoad(row + x)), row + x);
+			tVector = VectorAdd(tVector, stepVector);
+		}
+		for (; x < count; x++)
+		{
+			float t = firstT + stepT * x;
+			float weight = FMath::Max(1 - FMath::Max(fixedTerm, radialTerm + t * t), 0.0f);
+			row[x] += brushValue * weight * weight;
+		}
+		break;
+	}
+	case ETerrainBrushMode::TBM_SmoothUnion:
+	{
+		// Polynomial smooth maximum of the current value and the shape's field isovalue + value * (1 - d^2), which falls below the isovalue outside the shape
+		const float blend = FMath::Max(blendWidth, KINDA_SMALL_NUMBER);
+		const VectorRegister4Float isovalueVector = VectorSetFloat1(isovalue);
+		const VectorRegister4Float blendVector = VectorSetFloat1(blend);
+		const VectorRegister4Float halfOverBlendVector = VectorSetFloat1(0.5f / blend);
+		const VectorRegister4Float fixedVector = VectorSetFloat1(fixedTerm);
+		const VectorRegister4Float radialVector = VectorSetFloat1(radialTerm);
+		const VectorRegister4Float stepVector = VectorSetFloat1(stepT * 4);
+		VectorRegister4Float tVector = VectorMultiplyAdd(MakeVectorRegisterFloat(0.0f, 1.0f, 2.0f, 3.0f), VectorSetFloat1(stepT), VectorSetFloat1(firstT));
+
+		int32 x = 0;
+		for (; x + 4 <= count; x += 4)
+		{
+			VectorRegister4Float distanceSquared = VectorMax(fixedVector, VectorMultiplyAdd(tVector, tVector, radialVector));
+			VectorRegister4Float shapeValue = VectorMultiplyAdd(brushVector, VectorSubtract(GlobalVectorConstants::FloatOne, distanceSquared), isovalueVector);
+			VectorRegister4Float current = VectorLoad(row + x);
+			VectorRegister4Float difference = VectorSubtract(shapeValue, current);
+			VectorRegister4Float h = VectorMultiplyAdd(difference, halfOverBlendVector, GlobalVectorConstants::FloatOneHalf);
+			h = VectorMin(VectorMax(h, GlobalVectorConstants::FloatZero), GlobalVectorConstants::FloatOne);
+			VectorRegister4Float fillet = VectorMultiply(VectorMultiply(blendVector, h), VectorSubtract(GlobalVectorConstants::FloatOne, h));
+			VectorStore(VectorAdd(VectorMultiplyAdd(difference, h, current), fillet), row + x);
+			tVector = VectorAdd(tVector, stepVector);
+		}
+		for (; x < count; x++)
+		{
+			float t = firstT + stepT * x;
+			float shapeValue = isovalue + brushValue * (1 - FMath::Max(fixedTerm, radialTerm + t * t));
+			float difference = shapeValue - row[x];
+			float h = FMath::Clamp(0.5f + difference * 0.5f / blend, 0.0f, 1.0f);
+			row[x] += difference * h + blend * h * (1 - h);
+		}
+		break;
+	}
+	default:
+		// The filtering modes are applied by ApplyFilterToGrid
+		break;
+	}
+}
+
+void FTerrainBrush::BlendSpan(float* row, const float* filteredRow, int32 count, float firstT, float stepT, float fixedTerm, float radialTerm) const
+{
+	// The same (1 - d^2)^2 falloff as TBM_SmoothFalloff keeps the edge of the footprint seamless
+	const float strength = FMath::Clamp(value, 0.0f, 1.0f);
+	const VectorRegister4Float strengthVector = VectorSetFloat1(strength);
+	const VectorRegister4Float fixedVector = VectorSetFloat1(fixedTerm);
+	const VectorRegister4Float radialVector = VectorSetFloat1(radialTerm);
+	const VectorRegister4Float stepVector = VectorSetFloat1(stepT * 4);
+	VectorRegister4Float tVector = VectorMultiplyAdd(MakeVectorRegisterFloat(0.0f, 1.0f, 2.0f, 3.0f), VectorSetFloat1(stepT), VectorSetFloat1(firstT));
+
+	int32 x = 0;
+	for (; x + 4 <= count; x += 4)
+	{
+		VectorRegister4Float distanceSquared = VectorMax(fixedVector, VectorMultiplyAdd(tVector, tVector, radialVector));
+		VectorRegister4Float weight = VectorMax(VectorSubtract(GlobalVectorConstants::FloatOne, distanceSquared), GlobalVectorConstants::FloatZero);
+		weight = VectorMultiply(VectorMultiply(weight, weight), strengthVector);
+
+		VectorRegister4Float current = VectorLoad(row + x);
+		VectorRegister4Float difference = VectorSubtract(VectorLoad(filteredRow + x), current);
+		VectorStore(VectorMultiplyAdd(difference, weight, current), row + x);
+		tVector = VectorAdd(tVector, stepVector);
+	}
+	for (; x < count; x++)
+	{
+		float t = firstT + stepT * x;
+		float weight = FMath::Max(1 - FMath::Max(fixedTerm, radialTerm + t * t), 0.0f);
+		row[x] += (filteredRow[x] - row[x]) * weight * weight * strength;
+	}
+}
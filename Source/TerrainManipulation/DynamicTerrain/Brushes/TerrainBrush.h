@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TerrainManipulation/DataStructs/TArray3D.h"
+#include "TerrainManipulation/DataStructs/GridRegion.h"
+#include "TerrainBrush.generated.h"
+
+UENUM(BlueprintType)
+enum class ETerrainBrushShape : uint8 {
+	TBS_Sphere,
+	TBS_Box,
+	TBS_Capsule,
+	TBS_Cylinder
+};
+
+UENUM(BlueprintType)
+enum class ETerrainBrushMode : uint8 {
+	// Add the value to every point inside the shape
+	TBM_Add,
+	// Subtract the value from every point inside the shape
+	TBM_Subtract,
+	// Replace every point inside the shape with the value
+	TBM_Set,
+	// Take the lower of the current value and the brush value (CSG intersection of solids)
+	TBM_Min,
+	// Take the higher of the current value and the brush value (CSG union of solids)
+	TBM_Max,
+	// Add the value scaled by a weight that falls smoothly from 1 at the centre to 0 at the edge of the shape
+	TBM_SmoothFalloff,
+	// Blend towards a box-filtered copy of the field, with the value as the strength between 0 and 1
+	TBM_Smooth,
+	// Blend towards the average of each horizontal slice of the shape, which levels the surface, with the value as the strength between 0 and 1
+	TBM_Flatten,
+	// Take a smoothed maximum of the current value and a field that is the value above the isovalue at the centre and falls to the isovalue at the edge of the shape,
+	// so the shape merges into the surface with a fillet blendWidth wide instead of a crease
+	TBM_SmoothUnion
+};
+
+/**
+ * A shape and an operation to apply to every grid point inside it.
+ * Capsules and cylinders are aligned to the Z axis.
+ */
+USTRUCT(BlueprintType)
+struct TERRAINMANIPULATION_API FTerrainBrush
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	ETerrainBrushShape shape = ETerrainBrushShape::TBS_Sphere;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	ETerrainBrushMode mode = ETerrainBrushMode::TBM_Add;
+
+	// The centre of the shape. World space when passed to the terrain, and local to the terrain when applied to a grid
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector centre = FVector::ZeroVector;
+
+	// The radius of spheres, capsules and cylinders
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float radius = 100;
+
+	// The half size of boxes along each axis
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector halfExtents = FVector(100, 100, 100);
+
+	// The half length along Z of the straight section of capsules and cylinders
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float halfHeight = 100;
+
+	// The value applied by the mode
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float value = 1;
+
+	// The number of grid points either side of each point averaged by the smooth mode
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 1))
+	int32 smoothRadius = 1;
+
+	// The range of field values over which the smooth union mode blends the shape into the current surface
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	float blendWidth = 0.25f;
+
+	// The isovalue of the terrain the brush is applied to, which the smooth union shape is measured from. Set by the terrain when the brush is applied
+	float isovalue = 0;
+
+	/// <summary>
+	/// Get the half size of the axis-aligned box that bounds the shape
+	/// </summary>
+	FVector GetBoundingHalfExtents() const;
+
+	/// <summary>
+	/// Check whether applying the brush twice is the same as applying it once with double the value
+	/// </summary>
+	bool IsAdditive() const;
+
+	/// <summary>
+	/// Check whether applying the brush a second time leaves the field as the first application left it
+	/// </summary>
+	bool IsIdempotent() const;
+
+	/// <summary>
+	/// Check whether two brushes differ only in their centre and value
+	/// </summary>
+	bool HasSameShape(const FTerrainBrush& other) const;
+
+	/// <summary>
+	/// Get the grid points inside the bounding box of the shape
+	/// </summary>
+	/// <param name="gridCellDimensions">The size of a single grid cell in local coordinates</param>
+	/// <param name="lowerBound">The lowest grid indices that may be returned (inclusive)</param>
+	/// <param name="upperBound">The highest grid indices that may be returned (inclusive)</param>
+	FGridRegion GetAffectedPoints(FVector3f gridCellDimensions, FIntVector3 lowerBound, FIntVector3 upperBound) const;
+
+	/// <summary>
+	/// Apply the brush to every grid point inside the shape.
+	/// Each row along X has its span inside the shape solved analytically and is then written four points at a time
+	/// </summary>
+	/// <param name="grid">The grid to modify, which may be a window onto a larger grid</param>
+	/// <param name="gridIndexOffset">The indices of the (0,0,0) point of the grid within the whole terrain</param>
+	/// <param name="gridCellDimensions">The size of a single grid cell in local coordinates</param>
+	/// <param name="parallelPointThreshold">The number of points in the footprint above which slices along Z are applied in parallel</param>
+	/// <returns>The grid points that were modified, in the indices of the whole terrain</returns>
+	FGridRegion ApplyToGrid(TArray3D<float>& grid, FIntVector3 gridIndexOffset, FVector3f gridCellDimensions, int64 parallelPointThreshold = DefaultParallelPointThreshold) const;
+
+	// The footprint size above which brushes are applied in parallel when no threshold is given
+	static constexpr int64 DefaultParallelPointThreshold = 64 * 64 * 64;
+
+private:
+	/// <summary>
+	/// Get the largest normalised squared distance from the centre that the mode modifies near the surface.
+	/// This is 1 for every mode except the smooth union, whose fillet reaches beyond the edge of the shape
+	/// </summary>
+	float GetInfluenceTerm() const;
+
+	/// <summary>
+	/// Get the half length of the shape along X, which scales the normalised distance used for the row spans
+	/// </summary>
+	double GetRadiusX() const;
+
+	/// <summary>
+	/// Split the normalised squared distance of the points in a row into a part that is fixed along the row and a part that grows with X.
+	/// A point is inside the shape if max(fixedTerm, radialTerm + t^2) is at most 1 (or the influence term), where t is its normalised X offset from the centre
+	/// </summary>
+	/// <param name="offsetY">The Y offset of the row from the centre</param>
+	/// <param name="offsetZ">The Z offset of the row from the centre</param>
+	void GetRowTerms(double offsetY, double offsetZ, float& outFixedTerm, float& outRadialTerm) const;
+
+	/// <summary>
+	/// Find the points of a row along X that lie inside the influence of the shape
+	/// </summary>
+	/// <param name="y">The Y index of the row within the whole terrain</param>
+	/// <param name="z">The Z index of the row within the whole terrain</param>
+	/// <param name="bounds">The points that may be returned</param>
+	/// <param name="outStartX">The first point of the span (inclusive)</param>
+	/// <param name="outEndX">The last point of the span (inclusive)</param>
+	/// <param name="outFirstT">The normalised X offset of the first point from the centre</param>
+	/// <returns>False if the row misses the shape</returns>
+	bool GetRowSpan(int32 y, int32 z, FVector3f gridCellDimensions, const FGridRegion& bounds, int32& outStartX, int32& outEndX, float& outFirstT, float& outFixedTerm, float& outRadialTerm) const;
+
+	/// <summary>
+	/// Apply the mode to a contiguous span of points
+	/// </summary>
+	/// <param name="row">The first point of the span</param>
+	/// <param name="count">The number of points in the span</param>
+	/// <param name="firstT">The normalised X offset of the first point from the centre</param>
+	/// <param name="stepT">The change in normalised X offset between neighbouring points</param>
+	void ApplyToSpan(float* row, int32 count, float firstT, float stepT, float fixedTerm, float radialTerm) const;
+
+	/// <summary>
+	/// Apply the smooth or flatten modes, which read the neighbourhood of each point and so cannot be applied one span at a time.
+	/// The footprint is copied into a scratch buffer and box filtered with separable passes along each axis before being blended back
+	/// </summary>
+	FGridRegion ApplyFilterToGrid(TArray3D<float>& grid, FIntVector3 gridIndexOffset, FVector3f gridCellDimensions, const FGridRegion& bounds, int64 parallelPointThreshold) const;
+
+	/// <summary>
+	/// Call a function for the span of every row of the footprint that lies inside the shape.
+	/// Each slice along Z is independent, so large footprints are split across worker threads
+	/// </summary>
+	/// <param name="spanFunction">Called with (y, z, startX, endX, firstT, fixedTerm, radialTerm) for each span</param>
+	/// <returns>The grid points covered by the spans</returns>
+	template <typename SpanFunction>
+	FGridRegion ForEachRowSpan(FVector3f gridCellDimensions, const FGridRegion& bounds, int64 parallelPointThreshold, SpanFunction spanFunction) const;
+
+	/// <summary>
+	/// Blend a span of points towards their filtered values, weighted by the smooth falloff of the shape
+	/// </summary>
+	/// <param name="row">The first point of the span</param>
+	/// <param name="filteredRow">The filtered value of the first point of the span</param>
+	/// <param name="count">The number of points in the span</param>
+	void BlendSpan(float* row, const float* filteredRow, int32 count, float firstT, float stepT, float fixedTerm, float radialTerm) const;
+};
@@ -4,12 +4,21 @@
 #include "Dynamic_Terrain.h"
 #include "MarchingCubes/MarchingCubesGenerator.h"
 #include "MarchingTetrahedra/MarchingTetrahedraGenerator.h"
+#include "TerrainMeshingBenchmark.h"
 #include "Math/UnrealMathUtility.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 #include <memory>
 
 #include "SimpleComputeShaders/Public/BasicComputeShader/BasicComputeShader.h"
 #include "SimpleComputeShaders/Public/DemoPiComputeShader/DemoPiComputeShader.h"
 
+using namespace UE::Geometry;
+
 // Sets default values
 ADynamic_Terrain::ADynamic_Terrain()
 {
@@ -27,6 +36,15 @@ ADynamic_Terrain::ADynamic_Terrain()
 	bUseGPU = false;
 }
 
+void ADynamic_Terrain::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// The ring is sized here rather than in BeginPlay, as the BeginPlay of another actor may queue brushes before this one's has run.
+	// Nothing else can hold the terrain yet, so no producer can be pushing while the ring is reallocated. It is never resized after this
+	incomingEdits.Reset(editQueueCapacity);
+}
+
 // Called when the game starts or when spawned
 void ADynamic_Terrain::BeginPlay()
 {
@@ -42,19 +60,37 @@ void ADynamic_Terrain::BeginPlay()
 
 	CalculateMesh();
 
-	dynamicMesh->SetNotifyRigidBodyCollision(true);
-	if (bEnableCollision)
+	ConfigureCollision(dynamicMesh);
+
+	if (bRecordEditsFromBeginPlay)
 	{
-		dynamicMesh->SetCollisionProfileName("BlockAll");
-		dynamicMesh->EnableComplexAsSimpleCollision();
+		StartRecording();
 	}
-	else
+}
+
+void ADynamic_Terrain::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Keep whatever was recorded rather than lose the session
+	if (bRecordingEdits)
+	{
+		StopRecording(FString::Printf(TEXT("Recording_%s"), *FDateTime::Now().ToString()));
+	}
+
+	// Workers finish on their own, and nothing will be left to apply their results
+	CancelMeshJobs();
+
+	// Idle generators each hold a snapshot of the grid, which nothing will mesh again
+	if (marchingCubesGeneratorPool.IsValid())
+	{
+		marchingCubesGeneratorPool->Empty();
+	}
+	if (marchingTetrahedraGeneratorPool.IsValid())
 	{
-		dynamicMesh->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-		dynamicMesh->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Block);
-		dynamicMesh->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
-		dynamicMesh->EnableComplexAsSimpleCollision();
+		marchingTetrahedraGeneratorPool->Empty();
 	}
+	retiredMeshes.Empty();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -62,50 +98,169 @@ void ADynamic_Terrain::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	// The batching and redistancing of a replay are driven by its recorded events, so the edit queue waits until the replay has finished
+	if (bReplaying)
+	{
+		if (!ReplayNextFrame())
+		{
+			FinishReplay();
+		}
+	}
+	else
+	{
+		ProcessEditQueue();
+	}
+
+	if (ShouldMeshInChunks())
+	{
+		QueueSettledChunks();
+		StartScheduledChunkRemeshes();
+	}
+
+	LaunchWaitingMeshJobs();
+
+	// Jobs launched or stepped this tick are applied straight away if they have already finished
+	StepTimeSlicedMeshJobs();
+	ApplyCompletedMeshJobs();
 }
 
 void ADynamic_Terrain::CalculateMesh()
 {
-	double sizeX = (topRightAnchor.X - bottomLeftAnchor.X) / (dataGrid.GetSize(0) - 1);
-	double sizeY = (topRightAnchor.Y - bottomLeftAnchor.Y) / (dataGrid.GetSize(1) - 1);
-	double sizeZ = (topRightAnchor.Z - bottomLeftAnchor.Z) / (dataGrid.GetSize(2) - 1);
-	FVector3f gridCellDimensions = FVector3f(sizeX, sizeY, sizeZ);
+	if (bRecordingEdits)
+	{
+		RecordEditEvent(ETerrainEditEventType::TEE_Remesh);
+	}
 
-	FDynamicMesh3 mesh;
-	switch (surfaceGenerationAlgorithm) {
-	case EIsosurfaceGenerationAlgorithm::IGA_MarchingCubes:
-		marchingCubesGenerator = std::make_unique<MarchingCubesGenerator>();
-		marchingCubesGenerator->dataGrid = dataGrid;
-		marchingCubesGenerator->isovalue = isovalue;
-		marchingCubesGenerator->gridCellDimensions = gridCellDimensions;
-		marchingCubesGenerator->zeroCellOffset = FVector3f::ZeroVector;
-		if (bUseGPU)
+	RemeshTerrain();
+}
+
+void ADynamic_Terrain::RemeshTerrain()
+{
+	if (ShouldMeshInChunks())
+	{
+		// Until every chunk exists, or if the isovalue has moved, the whole terrain has to be meshed
+		FGridRegion chunksToRemesh;
+		if (!bChunksGenerated || meshedIsovalue != isovalue)
 		{
-			marchingCubesGenerator->GenerateOnGPU(dynamicMesh);
+			FIntVector3 chunkCount = GetChunkCount();
+			chunksToRemesh = FGridRegion(FIntVector3(0, 0, 0), chunkCount - FIntVector3(1, 1, 1));
 		}
 		else
 		{
-			mesh = marchingCubesGenerator->GenerateOnCPU();
-			UpdateDynamicMesh(mesh);
+			chunksToRemesh = GetChunksTouchingPoints(dirtyRegion);
 		}
-		break;
-	case EIsosurfaceGenerationAlgorithm::IGA_MarchingTetrahedra:
-		marchingTetrahedraGenerator = std::make_unique<MarchingTetrahedraGenerator>();
-		marchingTetrahedraGenerator->dataGrid = dataGrid;
-		marchingTetrahedraGenerator->isovalue = isovalue;
-		marchingTetrahedraGenerator->gridCellDimensions = gridCellDimensions;
-		marchingTetrahedraGenerator->zeroCellOffset = FVector3f::ZeroVector;
-		if (bUseGPU)
+
+		// The chunks nearest the player are started now, and the rest over the following ticks
+		chunkScheduler.MarkDirty(chunksToRemesh);
+		StartScheduledChunkRemeshes();
+
+		bChunksGenerated = true;
+		meshedIsovalue = isovalue;
+		dirtyRegion = FGridRegion();
+		return;
+	}
+
+	// A finished job is still newer than the mesh on display, so it is applied before deciding how to remesh.
+	// A job already running on a worker, or part way through its slices, is left to finish, as cancelling it would throw its work away and a steady stream of edits would then never show a result.
+	// The remesh waits for it instead, with the dirty region gathering every edit until then, so any number of requests make one follow-up remesh
+	if (meshJob.IsValid())
+	{
+		if (!meshJob->IsComplete() && meshJob->HasStarted())
 		{
-			marchingTetrahedraGenerator->GenerateOnGPU(dynamicMesh);
+			bRemeshAfterMeshJob = true;
+			return;
+		}
+
+		TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> job = MoveTemp(meshJob);
+		meshJob.Reset();
+		if (job->IsComplete())
+		{
+			ApplyMeshJob(*job);
 		}
 		else
 		{
-			mesh = marchingTetrahedraGenerator->GenerateOnCPU();
-			UpdateDynamicMesh(mesh);
+			// Nothing has been generated yet, so the job is replaced by one that covers its region as well
+			job->Cancel();
+			dirtyRegion.Include(job->sourceRegion);
 		}
-		break;
 	}
+	bRemeshAfterMeshJob = false;
+
+	int32 mipLevel = (storageMode == ETerrainStorageMode::TSM_Dense && dataGrid.HasMipChain()) ? FMath::Clamp(meshMipLevel, 0, dataGrid.GetMipLevelCount()) : 0;
+
+	// Only the full resolution CPU mesh records which cell generated each triangle, so anything else must be rebuilt from scratch
+	bool bCanRemeshIncrementally = bIncrementalRemesh && bMeshHasCellGroups && !bUseGPU && mipLevel == 0 && meshedIsovalue == isovalue;
+	if (bCanRemeshIncrementally)
+	{
+		if (!dirtyRegion.IsEmpty())
+		{
+			RemeshRegion(dirtyRegion);
+		}
+		dirtyRegion = FGridRegion();
+		return;
+	}
+
+	FVector3f gridCellDimensions = GetGridCellDimensions();
+	FVector3f zeroCellOffset = FVector3f::ZeroVector;
+
+	// Jobs take a pooled generator of their own, while meshing in place uses the generator kept by the actor.
+	// Either way the snapshot is copied into the grid the generator kept from its previous run
+	std::unique_ptr<ISurfaceGenerationAlgorithm> jobGenerator = ShouldUseMeshJobs() && !bUseGPU ? AcquireGenerator() : nullptr;
+	ISurfaceGenerationAlgorithm* generator = jobGenerator ? jobGenerator.get() : PrepareGenerator();
+	TArray3D<float>& sourceGrid = generator->dataGrid;
+
+	// Bring the mip chain up to date with any edits made since the last remesh
+	dataGrid.UpdateMipChain();
+
+	// The isovalue may be changed from blueprints, in which case the sign mask must be rebuilt against it
+	if (dataGrid.HasSignMask() && dataGrid.GetSignMaskThreshold() != isovalue)
+	{
+		dataGrid.EnableSignMask(isovalue);
+	}
+
+	// Coarser levels are meshed with proportionally larger cells, centred on the blocks they average
+	if (mipLevel > 0)
+	{
+		float levelScale = (float)(1 << mipLevel);
+		zeroCellOffset = gridCellDimensions * ((levelScale - 1) * 0.5f);
+		gridCellDimensions *= levelScale;
+	}
+	dataGrid.CopyMipLevelAveragesTo(mipLevel, sourceGrid);
+	ConfigureGenerator(*generator, gridCellDimensions, zeroCellOffset, FIntVector3(0, 0, 0));
+
+	if (jobGenerator)
+	{
+		// The mesh state is only updated once the result is applied, as until then the old mesh is still the one displayed
+		TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> job = CreateMeshJob(MoveTemp(jobGenerator));
+		job->target = ETerrainMeshJobTarget::TMJ_FullMesh;
+		job->sourceRegion = FGridRegion(FIntVector3(0, 0, 0), FIntVector3(gridPointCount.X - 1, gridPointCount.Y - 1, gridPointCount.Z - 1));
+		job->bHasCellGroups = mipLevel == 0;
+		job->isovalue = isovalue;
+		StartMeshJob(job);
+		meshJob = job;
+		dirtyRegion = FGridRegion();
+		return;
+	}
+
+	if (bUseGPU)
+	{
+		ResetRenderSections();
+		cellTriangles.Reset();
+		generator->GenerateOnGPU(dynamicMesh);
+	}
+	else
+	{
+		double meshStartTime = FPlatformTime::Seconds();
+		FDynamicMesh3& mesh = generator->GenerateOnCPU();
+		double uploadStartTime = FPlatformTime::Seconds();
+		UpdateDynamicMesh(mesh, mipLevel == 0);
+		frameTimings.meshSeconds += uploadStartTime - meshStartTime;
+		frameTimings.uploadSeconds += FPlatformTime::Seconds() - uploadStartTime;
+	}
+
+	bMeshHasCellGroups = !bUseGPU && mipLevel == 0;
+	meshedIsovalue = isovalue;
+	dirtyRegion = FGridRegion();
 }
 
 FVector3d ADynamic_Terrain::GetLocalPositionOfGridPoint(int x, int y, int z) const
@@ -128,99 +283,1693 @@ FVector ADynamic_Terrain::GetLocalPositionOfGridPoint(FIntVector vertexCoords) c
 
 float ADynamic_Terrain::GetValueOfDataGrid(const FIntVector& vertexCoords) const
 {
-	return dataGrid.GetElement(vertexCoords);
+	return GetGridValue(vertexCoords.X, vertexCoords.Y, vertexCoords.Z);
+}
+
+bool ADynamic_Terrain::CanRegionContainSurface(const FIntVector& minCoords, const FIntVector& maxCoords)
+{
+	// A sign mask built against the isovalue answers from one word per 4x4x4 block, without reading any values.
+	// Narrow band storage always keeps one, so its chunks are rejected without expanding bricks the remesh would then read again
+	if (storageMode == ETerrainStorageMode::TSM_NarrowBand && narrowBandGrid.GetThreshold() == isovalue)
+	{
+		return narrowBandGrid.GetSignMask().DoesRegionStraddle(minCoords, maxCoords);
+	}
+	if (storageMode == ETerrainStorageMode::TSM_Dense && dataGrid.HasSignMask() && dataGrid.GetSignMaskThreshold() == isovalue && !dataGrid.HasMipChain())
+	{
+		return dataGrid.GetSignMask().DoesRegionStraddle(minCoords, maxCoords);
+	}
+
+	float regionMin, regionMax;
+	if (storageMode == ETerrainStorageMode::TSM_Dense && dataGrid.HasMipChain())
+	{
+		dataGrid.UpdateMipChain();
+		if (!dataGrid.GetValueRangeInRegion(minCoords, maxCoords, regionMin, regionMax))
+		{
+			return false;
+		}
+	}
+	else if (storageMode == ETerrainStorageMode::TSM_ImplicitEdits)
+	{
+		// Reading the box in one go evaluates each brick once, rather than looking the brick up for every point
+		FGridRegion region = FGridRegion(minCoords, maxCoords).Clamped(FIntVector3(0, 0, 0), FIntVector3(gridPointCount.X - 1, gridPointCount.Y - 1, gridPointCount.Z - 1));
+		if (region.IsEmpty())
+		{
+			return false;
+		}
+
+		FIntVector3 regionSize = region.GetSize();
+		TArray3D<float> window(regionSize.X, regionSize.Y, regionSize.Z);
+		implicitField.CopyRegionTo(window, region.minIndex);
+		regionMin = TNumericLimits<float>::Max();
+		regionMax = TNumericLimits<float>::Lowest();
+		for (float value : window.GetRawDataStruct())
+		{
+			regionMin = FMath::Min(regionMin, value);
+			regionMax = FMath::Max(regionMax, value);
+		}
+	}
+	else
+	{
+		// Without a mip chain or a sign mask that matches the isovalue, every grid point in the region has to be read
+		regionMin = TNumericLimits<float>::Max();
+		regionMax = TNumericLimits<float>::Lowest();
+		for (int32 z = FMath::Max(minCoords.Z, 0); z <= FMath::Min(maxCoords.Z, gridPointCount.Z - 1); z++)
+		{
+			for (int32 y = FMath::Max(minCoords.Y, 0); y <= FMath::Min(maxCoords.Y, gridPointCount.Y - 1); y++)
+			{
+				for (int32 x = FMath::Max(minCoords.X, 0); x <= FMath::Min(maxCoords.X, gridPointCount.X - 1); x++)
+				{
+					float value = GetGridValue(x, y, z);
+					regionMin = FMath::Min(regionMin, value);
+					regionMax = FMath::Max(regionMax, value);
+				}
+			}
+		}
+	}
+
+	// The generators treat values equal to the isovalue as outside, so the surface needs one point strictly above
+	return regionMin <= isovalue && regionMax > isovalue;
+}
+
+bool ADynamic_Terrain::IsGridPointInside(const FIntVector& vertexCoords) const
+{
+	if (storageMode == ETerrainStorageMode::TSM_NarrowBand && narrowBandGrid.GetThreshold() == isovalue)
+	{
+		return narrowBandGrid.GetSignMask().GetBit(vertexCoords.X, vertexCoords.Y, vertexCoords.Z);
+	}
+	if (storageMode == ETerrainStorageMode::TSM_Dense && dataGrid.HasSignMask() && dataGrid.GetSignMaskThreshold() == isovalue)
+	{
+		return dataGrid.GetSignMask().GetBit(vertexCoords.X, vertexCoords.Y, vertexCoords.Z);
+	}
+	return GetGridValue(vertexCoords.X, vertexCoords.Y, vertexCoords.Z) > isovalue;
 }
 
 void ADynamic_Terrain::AddToDataGridInRadius(FVector centre, float radius, float valueToAdd)
 {
+	FTerrainBrush brush;
+	brush.shape = ETerrainBrushShape::TBS_Sphere;
+	brush.mode = ETerrainBrushMode::TBM_Add;
+	brush.centre = centre;
+	brush.radius = radius;
+	brush.value = valueToAdd;
+	ApplyBrush(brush);
+}
+
+void ADynamic_Terrain::ApplyBrush(const FTerrainBrush& brush)
+{
+	bool bReadsNeighbourhood = brush.mode == ETerrainBrushMode::TBM_Smooth || brush.mode == ETerrainBrushMode::TBM_Flatten;
+	if (storageMode == ETerrainStorageMode::TSM_ImplicitEdits && bReadsNeighbourhood)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Smooth and flatten brushes depend on the values around them and cannot be recorded as implicit edits"));
+		return;
+	}
+
+	if (bRecordingEdits)
+	{
+		RecordEditEvent(ETerrainEditEventType::TEE_Brush, brush);
+	}
+
 	// Translate from world coordinates to local coordinates
-	FTransform transform = RootComponent->GetComponentTransform();
-	FVector transformedUnscaledGridCoordinates = transform.InverseTransformPosition((FVector3d)centre);
+	FTerrainBrush localBrush = brush;
+	localBrush.centre = RootComponent->GetComponentTransform().InverseTransformPosition(brush.centre);
+	localBrush.isovalue = isovalue;
+
+	FVector3f gridCellDimensions = GetGridCellDimensions();
+	FGridRegion bounds = localBrush.GetAffectedPoints(gridCellDimensions, FIntVector3(0, 0, 0), FIntVector3(gridPointCount.X - 1, gridPointCount.Y - 1, gridPointCount.Z - 1));
+	if (bounds.IsEmpty())
+	{
+		return;
+	}
+
+	// A brush applied outside of a queued batch is recorded as a batch of its own, unless the batch of earlier edits is still waiting on redistancing
+	bool bRecordHistory = ShouldRecordEditHistory();
+	bool bOwnsJournalBatch = bRecordHistory && !editJournal.IsBatchOpen();
+	if (bOwnsJournalBatch)
+	{
+		editJournal.BeginBatch();
+	}
+	if (bRecordHistory)
+	{
+		CaptureJournalBricks(bounds);
+	}
+
+	FGridRegion editRegion;
+	if (storageMode == ETerrainStorageMode::TSM_NarrowBand)
+	{
+		// The brush works on dense rows, so the affected box is expanded, edited and written back
+		FIntVector3 windowSize = bounds.GetSize();
+		TArray3D<float> window(windowSize.X, windowSize.Y, windowSize.Z);
+		narrowBandGrid.CopyRegionTo(window, bounds.minIndex);
+		editRegion = localBrush.ApplyToGrid(window, bounds.minIndex, gridCellDimensions, brushParallelPointThreshold);
+		if (!editRegion.IsEmpty())
+		{
+			narrowBandGrid.WriteRegionFrom(window, bounds.minIndex);
 
-	double gridSizeX = (topRightAnchor.X - bottomLeftAnchor.X) / (gridPointCount.X - 1);
-	double gridSizeY = (topRightAnchor.Y - bottomLeftAnchor.Y) / (gridPointCount.Y - 1);
-	double gridSizeZ = (topRightAnchor.Z - bottomLeftAnchor.Z) / (gridPointCount.Z - 1);
+			// Grow the band around any surface the edit created and release the bricks it has moved away from
+			narrowBandGrid.UpdateBand(editRegion.minIndex, editRegion.maxIndex);
+		}
+	}
+	else if (storageMode == ETerrainStorageMode::TSM_ImplicitEdits)
+	{
+		// The edit is only recorded here, and is evaluated when the bricks it overlaps are next read
+		editRegion = implicitField.AddEdit(localBrush);
+	}
+	else
+	{
+		editRegion = localBrush.ApplyToGrid(dataGrid, FIntVector3(0, 0, 0), gridCellDimensions, brushParallelPointThreshold);
+	}
 
-	// Scale local coordinates into grid coordinates
-	FVector scaledGridCoordinates = FVector(transformedUnscaledGridCoordinates.X / gridSizeX, transformedUnscaledGridCoordinates.Y / gridSizeY, transformedUnscaledGridCoordinates.Z / gridSizeZ);
+	dirtyRegion.Include(editRegion);
+	journalBatchRegion.Include(editRegion);
 
-	// Translation into grid coordinates may make the sphere an ellipse if grid scales are not identical, so calculate axes lengths
-	double rX = radius / gridSizeX;
-	double rY = radius / gridSizeY;
-	double rZ = radius / gridSizeZ;
+	// Distances up to the margin away from the edit may now measure to a surface that has moved
+	if (ShouldRedistance())
+	{
+		redistancer.Enqueue(editRegion.Expanded(redistanceMarginCells));
+	}
 
-	// Iterate over integers in the rectangle surrounding the ellipse and check if it is inside the radius
-	for (int32 x = FMath::CeilToInt32(scaledGridCoordinates.X - rX); x <= FMath::CeilToInt32(scaledGridCoordinates.X + rX); x++) 
+	// Otherwise the batch is left open for ProcessEditQueue to commit once the redistancing has caught up
+	if (bOwnsJournalBatch && !redistancer.HasPendingBricks())
 	{
-		if (x < 0 || x >= dataGrid.GetSize(0)) {
-			// Invalid coordinate, skip this row
-			continue;
+		CommitJournalBatch();
+	}
+}
+
+void ADynamic_Terrain::QueueBrush(const FTerrainBrush& brush)
+{
+	// A rejected brush is counted by the queue and reported when the queue is next drained
+	TryQueueBrush(brush);
+}
+
+bool ADynamic_Terrain::TryQueueBrush(const FTerrainBrush& brush)
+{
+	return incomingEdits.TryEnqueue(brush);
+}
+
+float ADynamic_Terrain::GetEditQueueFill() const
+{
+	return (float)incomingEdits.GetApproximateNum() / incomingEdits.GetCapacity();
+}
+
+void ADynamic_Terrain::QueueEdit(FVector centre, float radius, float valueToAdd)
+{
+	FTerrainBrush brush;
+	brush.shape = ETerrainBrushShape::TBS_Sphere;
+	brush.mode = ETerrainBrushMode::TBM_Add;
+	brush.centre = centre;
+	brush.radius = radius;
+	brush.value = valueToAdd;
+	QueueBrush(brush);
+}
+
+void ADynamic_Terrain::RequestRemesh()
+{
+	bRemeshRequested = true;
+}
+
+void ADynamic_Terrain::ProcessEditQueue()
+{
+	DrainIncomingEdits();
+	TArray<FTerrainBrush> brushes;
+	editQueue.Drain(brushes);
+
+	// The batch is kept open until the redistancing of its edits has finished, however many ticks that takes, so the edits and every slice
+	// of redistancing that follows them are undone as a single step. Edits arriving before then join the batch that is still open
+	// Where the batches open and close, and how far each tick's redistancing gets, depend on timing, so they are recorded for a replay to follow
+	if (ShouldRecordEditHistory() && brushes.Num() > 0 && !editJournal.IsBatchOpen())
+	{
+		if (bRecordingEdits)
+		{
+			RecordEditEvent(ETerrainEditEventType::TEE_BeginBatch);
 		}
-		for (int32 y = FMath::CeilToInt32(scaledGridCoordinates.Y - rY); y <= FMath::CeilToInt32(scaledGridCoordinates.Y + rY); y++)
+		editJournal.BeginBatch();
+	}
+
+	// Each edit only widens the dirty region, so the whole batch is covered by one remesh of the union
+	for (const FTerrainBrush& brush : brushes)
+	{
+		ApplyBrush(brush);
+	}
+
+	int32 pendingBrickCount = redistancer.GetPendingBrickCount();
+	bool bRedistanced = RedistanceEditedBricks();
+	if (bRecordingEdits && pendingBrickCount > 0)
+	{
+		RecordEditEvent(ETerrainEditEventType::TEE_Redistance).brickCount = pendingBrickCount - redistancer.GetPendingBrickCount();
+	}
+
+	if (editJournal.IsBatchOpen() && !redistancer.HasPendingBricks())
+	{
+		if (bRecordingEdits)
 		{
-			if (y < 0 || y >= dataGrid.GetSize(1)) {
-				// Invalid coordinate, skip this row
-				continue;
-			}
-			for (int32 z = FMath::CeilToInt32(scaledGridCoordinates.Z - rZ); z <= FMath::CeilToInt32(scaledGridCoordinates.Z + rZ); z++) 
-			{
-				if (z < 0 || z >= dataGrid.GetSize(2)) {
-					// Invalid coordinate, skip this row
-					continue;
-				}
+			RecordEditEvent(ETerrainEditEventType::TEE_CommitBatch);
+		}
+		CommitJournalBatch();
+	}
 
-				double normalisedDistanceFromCentre = FMath::Square((x - scaledGridCoordinates.X) / rX) + FMath::Square((y - scaledGridCoordinates.Y) / rY) + FMath::Square((z - scaledGridCoordinates.Z) / rZ);
-				if (normalisedDistanceFromCentre <= 1) 
-				{
-					// The object is inside the ellipse, so add to the value
-					float currentVal = dataGrid.GetElement(x, y, z);
-					dataGrid.SetElement(x, y, z, currentVal + valueToAdd);
-				}
+	if (brushes.Num() > 0 || bRedistanced || bRemeshRequested)
+	{
+		bRemeshRequested = false;
+		CalculateMesh();
+	}
+}
+
+void ADynamic_Terrain::DrainIncomingEdits()
+{
+	// Coalescing happens here on the game thread, so producers only pay for a single push
+	FTerrainBrush brush;
+	while (incomingEdits.TryDequeue(brush))
+	{
+		editQueue.Enqueue(brush, editCoalesceTolerance);
+	}
+
+	int32 rejectedCount = incomingEdits.TakeRejectedCount();
+	if (rejectedCount > 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("The terrain edit queue was full and %d brushes were dropped"), rejectedCount);
+	}
+}
+
+bool ADynamic_Terrain::ShouldRedistance() const
+{
+	return bRedistanceAfterEdits && storageMode != ETerrainStorageMode::TSM_ImplicitEdits;
+}
+
+bool ADynamic_Terrain::RedistanceEditedBricks(int32 maxBricks)
+{
+	if (!redistancer.HasPendingBricks())
+	{
+		return false;
+	}
+
+	// A brick limit replaces the time budget rather than adding to it, so that a replay redistances exactly as many bricks as were recorded
+	double budgetSeconds = maxBricks > 0 ? TNumericLimits<double>::Max() : redistanceBudgetMs / 1000.0;
+	FGridRegion rewrittenRegion = redistancer.Process(budgetSeconds, maxBricks, redistanceMarginCells, isovalue, redistanceValuePerCell,
+		[this](FIntVector3 regionMin, TArray3D<float>& outGrid)
+		{
+			ReadGridRegion(regionMin, outGrid);
+		},
+		[this](FIntVector3 regionMin, const TArray3D<float>& sourceGrid)
+		{
+			// Redistancing is part of the edit batch that caused it, so the bricks it rewrites are captured like any other edit
+			if (editJournal.IsBatchOpen())
+			{
+				CaptureJournalBricks(FGridRegion(regionMin, regionMin + FIntVector3(sourceGrid.GetSize(0) - 1, sourceGrid.GetSize(1) - 1, sourceGrid.GetSize(2) - 1)));
 			}
-		}
+			WriteGridRegion(regionMin, sourceGrid);
+		});
+
+	dirtyRegion.Include(rewrittenRegion);
+	journalBatchRegion.Include(rewrittenRegion);
+	return !rewrittenRegion.IsEmpty();
+}
+
+bool ADynamic_Terrain::Undo()
+{
+	if (!ApplyJournalBatch(true))
+	{
+		return false;
 	}
+	CalculateMesh();
+	return true;
 }
 
-void ADynamic_Terrain::InitialiseDataGrid()
+bool ADynamic_Terrain::Redo()
 {
-	dataGrid = TArray3D<float>(gridPointCount.X, gridPointCount.Y, gridPointCount.Z);
+	if (!ApplyJournalBatch(false))
+	{
+		return false;
+	}
+	CalculateMesh();
+	return true;
+}
 
-	int generationStrategy = 0;
-	// 0 = Random
-	// 1 = Spherical
+bool ADynamic_Terrain::ApplyJournalBatch(bool bUndo)
+{
+	// Recorded even if there is nothing to apply, as finishing the open batch below still changes the field
+	if (bRecordingEdits)
+	{
+		RecordEditEvent(bUndo ? ETerrainEditEventType::TEE_Undo : ETerrainEditEventType::TEE_Redo);
+	}
 
-	for (int i = 0; i < gridPointCount.X; i++)
+	// A batch still waiting on redistancing is finished first, so that it is the one undone rather than the batch before it
+	if (editJournal.IsBatchOpen())
 	{
-		for (int j = 0; j < gridPointCount.Y; j++)
+		CompleteJournalBatch();
+	}
+
+	TArray<FTerrainBrickDelta> deltas;
+	FGridRegion batchRegion;
+	bool bApplied = bUndo ? editJournal.Undo(deltas, batchRegion) : editJournal.Redo(deltas, batchRegion);
+	if (!bApplied)
+	{
+		return false;
+	}
+
+	// The journal restores values that were already redistanced, and redistancing afterwards would record a new batch and lose the redo history
+	redistancer.Reset();
+
+	ApplyJournalDeltas(deltas);
+	dirtyRegion.Include(batchRegion);
+	return true;
+}
+
+void ADynamic_Terrain::CaptureJournalBricks(const FGridRegion& pointRegion)
+{
+	FIntVector3 brickMin = pointRegion.minIndex / FTerrainEditJournal::BrickSize;
+	FIntVector3 brickMax = pointRegion.maxIndex / FTerrainEditJournal::BrickSize;
+	for (int32 k = brickMin.Z; k <= brickMax.Z; k++)
+	{
+		for (int32 j = brickMin.Y; j <= brickMax.Y; j++)
 		{
-			for (int k = 0; k < gridPointCount.Z; k++)
+			for (int32 i = brickMin.X; i <= brickMax.X; i++)
 			{
-				switch (generationStrategy) {
-				case 0:
-					dataGrid.SetElement(i, j, k, FMath::RandRange(0, 1));
-					break;
-				case 1:
-					dataGrid.SetElement(i, j, k, -FMath::Sqrt((double)FMath::Square(i) + FMath::Square(j) + FMath::Square(k)));
-					break;
-				default:
-					dataGrid.SetElement(i, j, k, 0);
+				FIntVector3 brickCoords(i, j, k);
+				if (editJournal.IsBrickCaptured(brickCoords))
+				{
+					continue;
 				}
+
+				FGridRegion brickRegion = FTerrainEditJournal::GetBrickRegion(brickCoords, gridPointCount);
+				FIntVector3 brickSize = brickRegion.GetSize();
+				TArray3D<float> brick(brickSize.X, brickSize.Y, brickSize.Z);
+				ReadGridRegion(brickRegion.minIndex, brick);
+				editJournal.CaptureBrick(brickCoords, MoveTemp(brick));
 			}
 		}
 	}
 }
 
-void ADynamic_Terrain::UpdateDynamicMesh(UE::Geometry::FDynamicMesh3& mesh)
+void ADynamic_Terrain::CommitJournalBatch()
 {
-	if (dynamicMesh == nullptr)
+	editJournal.CommitBatch([this](FIntVector3 brickCoords, TArray3D<float>& outBrick)
+		{
+			ReadGridRegion(FTerrainEditJournal::GetBrickRegion(brickCoords, gridPointCount).minIndex, outBrick);
+		}, journalBatchRegion);
+	journalBatchRegion = FGridRegion();
+}
+
+void ADynamic_Terrain::CompleteJournalBatch()
+{
+	while (redistancer.HasPendingBricks())
 	{
-		dynamicMesh = Cast<UDynamicMeshComponent>(GetRootComponent());
+		RedistanceEditedBricks();
 	}
 
-	if (dynamicMesh) 
+	if (editJournal.IsBatchOpen())
+	{
+		CommitJournalBatch();
+	}
+}
+
+void ADynamic_Terrain::ApplyJournalDeltas(const TArray<FTerrainBrickDelta>& deltas)
+{
+	for (const FTerrainBrickDelta& delta : deltas)
 	{
-		dynamicMesh->SetMesh(MoveTemp(mesh));
-		dynamicMesh->NotifyMeshUpdated();		
+		FGridRegion brickRegion = FTerrainEditJournal::GetBrickRegion(delta.brickCoords, gridPointCount);
+		FIntVector3 brickSize = brickRegion.GetSize();
+		TArray3D<float> brick(brickSize.X, brickSize.Y, brickSize.Z);
+		if (delta.xorBits.Num() != brick.GetRawDataStruct().Num())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Edit history does not match the size of the grid"));
+			continue;
+		}
+
+		ReadGridRegion(brickRegion.minIndex, brick);
+
+		// The brick is a single contiguous array, so the XOR can run straight over its bits
+		uint32* brickBits = reinterpret_cast<uint32*>(brick.GetRowData(0, 0));
+		for (int32 i = 0; i < delta.xorBits.Num(); i++)
+		{
+			brickBits[i] ^= delta.xorBits[i];
+		}
+
+		WriteGridRegion(brickRegion.minIndex, brick);
+	}
+}
+
+void ADynamic_Terrain::StartRecording()
+{
+	recording = FTerrainEditRecording();
+	recording.header.randomSeed = randomSeed;
+	recording.header.gridPointCount = gridPointCount;
+	recording.header.bottomLeftAnchor = bottomLeftAnchor;
+	recording.header.topRightAnchor = topRightAnchor;
+	recording.header.isovalue = isovalue;
+	recording.header.surfaceGenerationAlgorithm = (uint8)surfaceGenerationAlgorithm;
+	recording.header.storageMode = (uint8)storageMode;
+	recording.header.narrowBandWidth = narrowBandWidth;
+	recording.header.narrowBandFarValue = narrowBandFarValue;
+	recording.header.bUseChunks = bUseChunks;
+	recording.header.chunkCellCount = chunkCellCount;
+	recording.header.bPipelineChunkRemeshes = bPipelineChunkRemeshes;
+	recording.header.bAsyncMeshing = bAsyncMeshing;
+	recording.header.bTimeSlicedMeshing = bTimeSlicedMeshing;
+	recording.header.meshingBudgetMs = meshingBudgetMs;
+	recording.header.bIncrementalRemesh = bIncrementalRemesh;
+	recording.header.bMaintainMipChain = bMaintainMipChain;
+	recording.header.mipChainLevelCount = mipChainLevelCount;
+	recording.header.meshMipLevel = meshMipLevel;
+	recording.header.bRecordEditHistory = bRecordEditHistory;
+	recording.header.editHistoryMaxBatches = editHistoryMaxBatches;
+	recording.header.bRedistanceAfterEdits = bRedistanceAfterEdits;
+	recording.header.redistanceMarginCells = redistanceMarginCells;
+	recording.header.redistanceValuePerCell = redistanceValuePerCell;
+	recordingStartFrame = GFrameCounter;
+	bRecordingEdits = true;
+}
+
+bool ADynamic_Terrain::StopRecording(const FString& recordingName)
+{
+	if (!bRecordingEdits)
+	{
+		return false;
+	}
+	bRecordingEdits = false;
+
+	FString recordingPath = FTerrainEditRecording::GetRecordingPath(recordingName);
+	if (!recording.SaveToFile(recordingPath))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to save terrain recording to %s"), *recordingPath);
+		return false;
+	}
+	UE_LOG(LogTemp, Display, TEXT("Saved %d terrain edit events to %s"), recording.events.Num(), *recordingPath);
+	return true;
+}
+
+bool ADynamic_Terrain::StartReplay(const FString& recordingName, bool bMaximumSpeed)
+{
+	FString recordingPath = FTerrainEditRecording::GetRecordingPath(recordingName);
+	if (!replayRecording.LoadFromFile(recordingPath))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to load terrain recording from %s"), *recordingPath);
+		return false;
+	}
+
+	// The recording is replayed against a fresh terrain built with the settings it was recorded with
+	bRecordingEdits = false;
+	const FTerrainRecordingHeader& header = replayRecording.header;
+	randomSeed = header.randomSeed;
+	gridPointCount = header.gridPointCount;
+	bottomLeftAnchor = header.bottomLeftAnchor;
+	topRightAnchor = header.topRightAnchor;
+	isovalue = header.isovalue;
+	surfaceGenerationAlgorithm = (EIsosurfaceGenerationAlgorithm)header.surfaceGenerationAlgorithm;
+	storageMode = (ETerrainStorageMode)header.storageMode;
+	if (replayRecording.version >= FTerrainEditRecording::FirstBatchEventVersion)
+	{
+		narrowBandWidth = header.narrowBandWidth;
+		narrowBandFarValue = header.narrowBandFarValue;
+		bUseChunks = header.bUseChunks;
+		chunkCellCount = header.chunkCellCount;
+		bPipelineChunkRemeshes = header.bPipelineChunkRemeshes;
+		bAsyncMeshing = header.bAsyncMeshing;
+		bTimeSlicedMeshing = header.bTimeSlicedMeshing;
+		meshingBudgetMs = header.meshingBudgetMs;
+		bIncrementalRemesh = header.bIncrementalRemesh;
+		bMaintainMipChain = header.bMaintainMipChain;
+		mipChainLevelCount = header.mipChainLevelCount;
+		meshMipLevel = header.meshMipLevel;
+		bRecordEditHistory = header.bRecordEditHistory;
+		editHistoryMaxBatches = header.editHistoryMaxBatches;
+		bRedistanceAfterEdits = header.bRedistanceAfterEdits;
+		redistanceMarginCells = header.redistanceMarginCells;
+		redistanceValuePerCell = header.redistanceValuePerCell;
+	}
+
+	DrainIncomingEdits();
+	TArray<FTerrainBrush> discardedBrushes;
+	editQueue.Drain(discardedBrushes);
+	bRemeshRequested = false;
+
+	InitialiseDataGrid();
+	bMeshHasCellGroups = false;
+	bChunksGenerated = false;
+	dirtyRegion = FGridRegion();
+	CalculateMesh();
+
+	replayName = recordingName;
+	replayEventIndex = 0;
+	replayFrame = 0;
+	replayTimings.Reset();
+	bReplaying = true;
+
+	if (bMaximumSpeed)
+	{
+		// Every recorded frame is replayed back to back within this call
+		while (ReplayNextFrame())
+		{
+		}
+		FinishReplay();
+	}
+	return true;
+}
+
+bool ADynamic_Terrain::ReplayNextFrame()
+{
+	frameTimings = FTerrainFrameTimings();
+	frameTimings.frame = replayFrame;
+
+	// Batches are opened and committed, and bricks redistanced, exactly where the recording says, so brushes land on the same partly redistanced field
+	// and each undo reverts the same edits as it did live. Older recordings hold no such events, so their brushes are batched a frame at a time instead
+	bool bHasBatchEvents = replayRecording.version >= FTerrainEditRecording::FirstBatchEventVersion;
+	const TArray<FTerrainEditEvent>& events = replayRecording.events;
+	for (; replayEventIndex < events.Num() && events[replayEventIndex].frame <= replayFrame; replayEventIndex++)
+	{
+		const FTerrainEditEvent& event = events[replayEventIndex];
+		double editStartTime = FPlatformTime::Seconds();
+		if (!bHasBatchEvents && event.type != ETerrainEditEventType::TEE_Brush)
+		{
+			CompleteJournalBatch();
+		}
+		switch (event.type) {
+		case ETerrainEditEventType::TEE_Brush:
+			if (!bHasBatchEvents && ShouldRecordEditHistory() && !editJournal.IsBatchOpen())
+			{
+				editJournal.BeginBatch();
+			}
+			ApplyBrush(event.brush);
+			frameTimings.editCount++;
+			break;
+		case ETerrainEditEventType::TEE_BeginBatch:
+			if (ShouldRecordEditHistory() && !editJournal.IsBatchOpen())
+			{
+				editJournal.BeginBatch();
+			}
+			break;
+		case ETerrainEditEventType::TEE_Redistance:
+			if (event.brickCount > 0)
+			{
+				RedistanceEditedBricks(event.brickCount);
+			}
+			break;
+		case ETerrainEditEventType::TEE_CommitBatch:
+			if (editJournal.IsBatchOpen())
+			{
+				CommitJournalBatch();
+			}
+			break;
+		case ETerrainEditEventType::TEE_Undo:
+		case ETerrainEditEventType::TEE_Redo:
+			ApplyJournalBatch(event.type == ETerrainEditEventType::TEE_Undo);
+			frameTimings.editCount++;
+			break;
+		case ETerrainEditEventType::TEE_Remesh:
+			CalculateMesh();
+			frameTimings.remeshCount++;
+			continue;
+		}
+		frameTimings.editSeconds += FPlatformTime::Seconds() - editStartTime;
+	}
+
+	if (!bHasBatchEvents)
+	{
+		double batchStartTime = FPlatformTime::Seconds();
+		CompleteJournalBatch();
+		frameTimings.editSeconds += FPlatformTime::Seconds() - batchStartTime;
+	}
+
+	replayTimings.Add(frameTimings);
+	replayFrame++;
+	return replayEventIndex < events.Num();
+}
+
+void ADynamic_Terrain::FinishReplay()
+{
+	// Anything still waiting when the recording was stopped is finished off, so the terrain is left as a live session would settle
+	CompleteJournalBatch();
+	bReplaying = false;
+	replayRecording = FTerrainEditRecording();
+
+	FString report = TEXT("Frame,Edits,Remeshes,EditMs,MeshMs,UploadMs,CollisionMs\n");
+	FTerrainFrameTimings total, worst;
+	for (const FTerrainFrameTimings& timings : replayTimings)
+	{
+		report += FString::Printf(TEXT("%u,%d,%d,%.3f,%.3f,%.3f,%.3f\n"), timings.frame, timings.editCount, timings.remeshCount,
+			timings.editSeconds * 1000, timings.meshSeconds * 1000, timings.uploadSeconds * 1000, timings.collisionSeconds * 1000);
+		total.editCount += timings.editCount;
+		total.remeshCount += timings.remeshCount;
+		total.editSeconds += timings.editSeconds;
+		total.meshSeconds += timings.meshSeconds;
+		total.uploadSeconds += timings.uploadSeconds;
+		total.collisionSeconds += timings.collisionSeconds;
+		worst.editSeconds = FMath::Max(worst.editSeconds, timings.editSeconds);
+		worst.meshSeconds = FMath::Max(worst.meshSeconds, timings.meshSeconds);
+		worst.uploadSeconds = FMath::Max(worst.uploadSeconds, timings.uploadSeconds);
+		worst.collisionSeconds = FMath::Max(worst.collisionSeconds, timings.collisionSeconds);
+	}
+
+	FString reportPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TerrainRecordings"), replayName + TEXT("_timings.csv"));
+	FFileHelper::SaveStringToFile(report, *reportPath);
+
+	int32 frameCount = FMath::Max(replayTimings.Num(), 1);
+	UE_LOG(LogTemp, Display, TEXT("Replayed %s: %d frames, %d edits, %d remeshes"), *replayName, replayTimings.Num(), total.editCount, total.remeshCount);
+	UE_LOG(LogTemp, Display, TEXT("  Edit   total %.2f ms, mean %.3f ms/frame, worst %.3f ms"), total.editSeconds * 1000, total.editSeconds * 1000 / frameCount, worst.editSeconds * 1000);
+	UE_LOG(LogTemp, Display, TEXT("  Mesh   total %.2f ms, mean %.3f ms/frame, worst %.3f ms"), total.meshSeconds * 1000, total.meshSeconds * 1000 / frameCount, worst.meshSeconds * 1000);
+	UE_LOG(LogTemp, Display, TEXT("  Upload total %.2f ms, mean %.3f ms/frame, worst %.3f ms"), total.uploadSeconds * 1000, total.uploadSeconds * 1000 / frameCount, worst.uploadSeconds * 1000);
+	UE_LOG(LogTemp, Display, TEXT("  Collision total %.2f ms, mean %.3f ms/frame, worst %.3f ms"), total.collisionSeconds * 1000, total.collisionSeconds * 1000 / frameCount, worst.collisionSeconds * 1000);
+	UE_LOG(LogTemp, Display, TEXT("  Per frame timings written to %s"), *reportPath);
+}
+
+FTerrainEditEvent& ADynamic_Terrain::RecordEditEvent(ETerrainEditEventType type, const FTerrainBrush& brush)
+{
+	FTerrainEditEvent& event = recording.events.AddDefaulted_GetRef();
+	event.frame = (uint32)(GFrameCounter - recordingStartFrame);
+	event.type = type;
+	event.brush = brush;
+	return event;
+}
+
+void ADynamic_Terrain::InitialiseDataGrid()
+{
+	// History recorded against a previous grid cannot be applied to this one, and neither can meshes still being generated from it
+	CancelMeshJobs();
+	chunkScheduler.Reset();
+	chunkRemeshTimes.Reset();
+	unoptimizedChunks.Reset();
+	cellTriangles.Reset();
+	editJournal.Reset();
+	journalBatchRegion = FGridRegion();
+	editJournal.Configure((int64)editHistoryMemoryCapMB * 1024 * 1024, editHistoryMaxBatches);
+	redistancer.Configure(gridPointCount, GetGridCellDimensions());
+
+	if (storageMode == ETerrainStorageMode::TSM_ImplicitEdits)
+	{
+		// Nothing is evaluated until it is meshed or queried
+		dataGrid = TArray3D<float>();
+		implicitField.Initialise(gridPointCount, GetGridCellDimensions(), [this](int32 x, int32 y, int32 z)
+			{
+				return GetBaseFieldValue(x, y, z);
+			}, implicitBrickCacheSize);
+		return;
+	}
+
+	dataGrid = TArray3D<float>(gridPointCount.X, gridPointCount.Y, gridPointCount.Z);
+	for (int i = 0; i < gridPointCount.X; i++)
+	{
+		for (int j = 0; j < gridPointCount.Y; j++)
+		{
+			for (int k = 0; k < gridPointCount.Z; k++)
+			{
+				dataGrid.SetElement(i, j, k, GetBaseFieldValue(i, j, k));
+			}
+		}
+	}
+
+	if (storageMode == ETerrainStorageMode::TSM_NarrowBand)
+	{
+		// Only keep the values near the surface, and release the dense grid used to build them
+		narrowBandGrid = TNarrowBandArray3D<float>::FromDense(dataGrid, isovalue, narrowBandFarValue, narrowBandWidth);
+		dataGrid = TArray3D<float>();
+		return;
+	}
+
+	if (bMaintainMipChain)
+	{
+		dataGrid.EnableMipChain(mipChainLevelCount);
+	}
+
+	if (bMaintainSignMask)
+	{
+		dataGrid.EnableSignMask(isovalue);
+	}
+}
+
+float ADynamic_Terrain::GetBaseFieldValue(int32 x, int32 y, int32 z) const
+{
+	int generationStrategy = 0;
+	// 0 = Random
+	// 1 = Spherical
+
+	switch (generationStrategy) {
+	case 0:
+	{
+		// Hashing the indices gives each point the same random value whichever order the points are evaluated in
+		FIntVector3 coords(x, y, z);
+		return (float)(FCrc::MemCrc32(&coords, sizeof(coords), randomSeed) & 1);
+	}
+	case 1:
+		return -FMath::Sqrt((double)FMath::Square(x) + FMath::Square(y) + FMath::Square(z));
+	default:
+		return 0;
+	}
+}
+
+bool ADynamic_Terrain::ShouldRecordEditHistory() const
+{
+	return bRecordEditHistory && storageMode != ETerrainStorageMode::TSM_ImplicitEdits;
+}
+
+float ADynamic_Terrain::GetGridValue(int32 x, int32 y, int32 z) const
+{
+	if (storageMode == ETerrainStorageMode::TSM_NarrowBand)
+	{
+		return narrowBandGrid.GetElement(x, y, z);
+	}
+	if (storageMode == ETerrainStorageMode::TSM_ImplicitEdits)
+	{
+		return implicitField.GetElement(x, y, z);
+	}
+	return dataGrid.GetElement(x, y, z);
+}
+
+FVector3f ADynamic_Terrain::GetGridCellDimensions() const
+{
+	double sizeX = (topRightAnchor.X - bottomLeftAnchor.X) / (gridPointCount.X - 1);
+	double sizeY = (topRightAnchor.Y - bottomLeftAnchor.Y) / (gridPointCount.Y - 1);
+	double sizeZ = (topRightAnchor.Z - bottomLeftAnchor.Z) / (gridPointCount.Z - 1);
+	return FVector3f(sizeX, sizeY, sizeZ);
+}
+
+void ADynamic_Terrain::ReadGridRegion(FIntVector3 regionMin, TArray3D<float>& outGrid) const
+{
+	if (storageMode == ETerrainStorageMode::TSM_NarrowBand)
+	{
+		narrowBandGrid.CopyRegionTo(outGrid, regionMin);
+	}
+	else if (storageMode == ETerrainStorageMode::TSM_ImplicitEdits)
+	{
+		implicitField.CopyRegionTo(outGrid, regionMin);
+	}
+	else
+	{
+		dataGrid.CopyRegionTo(outGrid, regionMin);
+	}
+}
+
+void ADynamic_Terrain::WriteGridRegion(FIntVector3 regionMin, const TArray3D<float>& sourceGrid)
+{
+	if (storageMode == ETerrainStorageMode::TSM_NarrowBand)
+	{
+		narrowBandGrid.WriteRegionFrom(sourceGrid, regionMin);
+		narrowBandGrid.UpdateBand(regionMin, regionMin + FIntVector3(sourceGrid.GetSize(0) - 1, sourceGrid.GetSize(1) - 1, sourceGrid.GetSize(2) - 1));
+	}
+	else if (storageMode == ETerrainStorageMode::TSM_ImplicitEdits)
+	{
+		// Implicit storage is only changed by recording edits, which is why it keeps no edit history
+		UE_LOG(LogTemp, Warning, TEXT("Grid values cannot be written to implicit storage"));
+	}
+	else
+	{
+		dataGrid.WriteRegionFrom(sourceGrid, regionMin);
+	}
+}
+
+std::unique_ptr<ISurfaceGenerationAlgorithm> ADynamic_Terrain::CreateGenerator(EIsosurfaceGenerationAlgorithm algorithm)
+{
+	switch (algorithm) {
+	case EIsosurfaceGenerationAlgorithm::IGA_MarchingTetrahedra:
+		return std::make_unique<MarchingTetrahedraGenerator>();
+	case EIsosurfaceGenerationAlgorithm::IGA_MarchingCubes:
+	default:
+		return std::make_unique<MarchingCubesGenerator>();
+	}
+}
+
+ISurfaceGenerationAlgorithm* ADynamic_Terrain::PrepareGenerator()
+{
+	std::unique_ptr<ISurfaceGenerationAlgorithm>& generator = surfaceGenerationAlgorithm == EIsosurfaceGenerationAlgorithm::IGA_MarchingTetrahedra
+		? marchingTetrahedraGenerator : marchingCubesGenerator;
+	if (!generator)
+	{
+		generator = CreateGenerator(surfaceGenerationAlgorithm);
+	}
+	return generator.get();
+}
+
+std::unique_ptr<ISurfaceGenerationAlgorithm> ADynamic_Terrain::AcquireGenerator()
+{
+	return GetGeneratorPool()->Acquire();
+}
+
+const TSharedPtr<FTerrainGeneratorPool, ESPMode::ThreadSafe>& ADynamic_Terrain::GetGeneratorPool()
+{
+	EIsosurfaceGenerationAlgorithm algorithm = surfaceGenerationAlgorithm;
+	TSharedPtr<FTerrainGeneratorPool, ESPMode::ThreadSafe>& pool = algorithm == EIsosurfaceGenerationAlgorithm::IGA_MarchingTetrahedra
+		? marchingTetrahedraGeneratorPool : marchingCubesGeneratorPool;
+	if (!pool.IsValid())
+	{
+		// One idle generator for every job that can run at once, which follows the worker thread limit as it changes
+		pool = MakeShared<FTerrainGeneratorPool, ESPMode::ThreadSafe>([algorithm]() { return CreateGenerator(algorithm); }, &ADynamic_Terrain::GetMaxConcurrentMeshJobs);
+	}
+	return pool;
+}
+
+void ADynamic_Terrain::ConfigureGenerator(ISurfaceGenerationAlgorithm& generator, FVector3f gridCellDimensions, FVector3f zeroCellOffset, FIntVector3 gridIndexOffset) const
+{
+	generator.isovalue = isovalue;
+	generator.gridCellDimensions = gridCellDimensions;
+	generator.zeroCellOffset = zeroCellOffset;
+	generator.gridIndexOffset = gridIndexOffset;
+	generator.globalCellCount = FIntVector3(gridPointCount.X - 1, gridPointCount.Y - 1, gridPointCount.Z - 1);
+}
+
+TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> ADynamic_Terrain::CreateMeshJob(std::unique_ptr<ISurfaceGenerationAlgorithm> generator)
+{
+	// A generator whose last mesh was handed to the display is given a back buffer to write over
+	if (retiredMeshes.Num() > 0 && generator->RecycleMesh(retiredMeshes.Last()))
+	{
+		retiredMeshes.Pop(EAllowShrinking::No);
+	}
+
+	return MakeShared<FTerrainMeshJob, ESPMode::ThreadSafe>(MoveTemp(generator), GetGeneratorPool());
+}
+
+int32 ADynamic_Terrain::GetMaxConcurrentMeshJobs()
+{
+	// One job per worker thread that meshing may use, plus one stepped on the game thread
+	return UTerrainMeshingSettings::GetMaxWorkerThreads() + 1;
+}
+
+void ADynamic_Terrain::PresentMesh(UDynamicMeshComponent* component, FDynamicMesh3& mesh)
+{
+	component->EditMesh([&mesh](FDynamicMesh3& displayedMesh)
+		{
+			// Moved rather than swapped bitwise, so that any attribute set is reparented to the mesh that now holds it
+			FDynamicMesh3 previousMesh = MoveTemp(displayedMesh);
+			displayedMesh = MoveTemp(mesh);
+			mesh = MoveTemp(previousMesh);
+		}, EDynamicMeshComponentRenderUpdateMode::FullUpdate);
+}
+
+void ADynamic_Terrain::RetireMesh(FDynamicMesh3& mesh)
+{
+	if (mesh.MaxVertexID() == 0 && mesh.MaxTriangleID() == 0)
+	{
+		return;
+	}
+
+	if (retiredMeshes.Num() < GetMaxConcurrentMeshJobs())
+	{
+		retiredMeshes.Add(MoveTemp(mesh));
+		return;
+	}
+
+	// Freeing a whole mesh is slow enough to be kept off the game thread
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [retiredMesh = MoveTemp(mesh)]() mutable
+		{
+			retiredMesh.Clear();
+		});
+}
+
+bool ADynamic_Terrain::ShouldUseMeshJobs() const
+{
+	return bAsyncMeshing || bTimeSlicedMeshing;
+}
+
+bool ADynamic_Terrain::ShouldMeshInChunks() const
+{
+	// Sparse storage is read a chunk at a time, so the whole volume is never expanded into one dense grid.
+	// For implicit storage this also keeps each remesh within a chunk's worth of bricks, rather than cycling the whole volume through the brick cache
+	return bUseChunks || storageMode != ETerrainStorageMode::TSM_Dense;
+}
+
+void ADynamic_Terrain::StartMeshJob(const TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>& job)
+{
+	// Worker threads are preferred when both are enabled, and time sliced jobs are left for StepTimeSlicedMeshJobs
+	if (bAsyncMeshing || (bPipelineChunkRemeshes && job->target == ETerrainMeshJobTarget::TMJ_Chunk))
+	{
+		job->bWaitingForWorker = true;
+		waitingMeshJobs.Add(job);
+		LaunchWaitingMeshJobs();
+	}
+}
+
+void ADynamic_Terrain::LaunchWaitingMeshJobs()
+{
+	runningMeshJobs.RemoveAll([](const TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>& job)
+		{
+			return job->IsComplete();
+		});
+
+	// Jobs beyond the limit wait here rather than in the task scheduler, so that the rest of the game keeps the other workers
+	int32 maxRunningJobs = UTerrainMeshingSettings::GetMaxWorkerThreads();
+	UE::Tasks::ETaskPriority priority = UTerrainMeshingSettings::GetTaskPriority();
+	int32 launchedCount = 0;
+	while (launchedCount < waitingMeshJobs.Num() && runningMeshJobs.Num() < maxRunningJobs)
+	{
+		TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> job = waitingMeshJobs[launchedCount++];
+		if (job->IsCancelled())
+		{
+			continue;
+		}
+
+		if (bPipelineChunkRemeshes && job->target == ETerrainMeshJobTarget::TMJ_Chunk)
+		{
+			LaunchChunkPipeline(job);
+		}
+		else
+		{
+			job->Launch(priority);
+		}
+		runningMeshJobs.Add(job);
+	}
+	waitingMeshJobs.RemoveAt(0, launchedCount, EAllowShrinking::No);
+}
+
+void ADynamic_Terrain::LaunchChunkPipeline(const TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>& job)
+{
+	job->bPipelined = true;
+	job->Launch(UTerrainMeshingSettings::GetTaskPriority());
+
+	// Components can only be touched on the game thread, so the stages after extraction are game thread tasks.
+	// They hold the terrain weakly, as it may be destroyed while the extraction is still running
+	TWeakObjectPtr<ADynamic_Terrain> weakTerrain(this);
+	UE::Tasks::FTask uploadTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [weakTerrain, job]()
+		{
+			ADynamic_Terrain* terrain = weakTerrain.Get();
+			if (terrain != nullptr && !job->IsCancelled())
+			{
+				terrain->UploadPipelinedChunk(*job);
+			}
+		}, UE::Tasks::Prerequisites(job->GetTask()), UE::Tasks::ETaskPriority::Normal, UE::Tasks::EExtendedTaskPriority::GameThreadNormalPri);
+
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [weakTerrain, job]()
+		{
+			ADynamic_Terrain* terrain = weakTerrain.Get();
+			if (terrain != nullptr && job->bUploaded)
+			{
+				terrain->RebuildPipelinedChunkCollision(*job);
+			}
+		}, UE::Tasks::Prerequisites(uploadTask), UE::Tasks::ETaskPriority::Normal, UE::Tasks::EExtendedTaskPriority::GameThreadNormalPri);
+}
+
+void ADynamic_Terrain::UploadPipelinedChunk(FTerrainMeshJob& job)
+{
+	// A job that has been superseded, or already applied by the remesh that superseded it, is no longer the chunk's job
+	TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>* currentJob = chunkMeshJobs.Find(job.chunkCoords);
+	if (currentJob == nullptr || currentJob->Get() != &job)
+	{
+		return;
+	}
+
+	// Uploads share the per tick limit with every other chunk result, and any over it are left for ApplyCompletedMeshJobs to pick up by urgency
+	if (GetRemainingChunkResultsThisFrame() <= 0)
+	{
+		job.bUploadDeferred = true;
+		return;
+	}
+	chunkResultsAppliedThisFrame++;
+
+	double uploadStartTime = FPlatformTime::Seconds();
+	TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> retainedJob = *currentJob;
+	chunkMeshJobs.Remove(job.chunkCoords);
+	ApplyMeshJob(job);
+	job.bUploaded = true;
+
+	pipelineTimings.snapshotSeconds += job.snapshotSeconds;
+	pipelineTimings.meshSeconds += job.meshSeconds;
+	pipelineTimings.uploadSeconds += FPlatformTime::Seconds() - uploadStartTime;
+}
+
+void ADynamic_Terrain::RebuildPipelinedChunkCollision(const FTerrainMeshJob& job)
+{
+	double collisionStartTime = FPlatformTime::Seconds();
+	if (UDynamicMeshComponent** chunkComponent = chunkMeshes.Find(job.chunkCoords))
+	{
+		(*chunkComponent)->UpdateCollision(false);
+	}
+	double collisionSeconds = FPlatformTime::Seconds() - collisionStartTime;
+
+	frameTimings.collisionSeconds += collisionSeconds;
+	pipelineTimings.collisionSeconds += collisionSeconds;
+	pipelineTimings.latencySeconds += FPlatformTime::Seconds() - job.startTime;
+	pipelineTimings.chunkCount++;
+}
+
+void ADynamic_Terrain::LogPipelineTimings()
+{
+	int32 chunkCount = FMath::Max(pipelineTimings.chunkCount, 1);
+	UE_LOG(LogTemp, Display, TEXT("Pipelined %d chunk remeshes, mean per chunk:"), pipelineTimings.chunkCount);
+	UE_LOG(LogTemp, Display, TEXT("  Snapshot  %.3f ms (game thread)"), pipelineTimings.snapshotSeconds * 1000 / chunkCount);
+	UE_LOG(LogTemp, Display, TEXT("  Mesh      %.3f ms (worker)"), pipelineTimings.meshSeconds * 1000 / chunkCount);
+	UE_LOG(LogTemp, Display, TEXT("  Upload    %.3f ms (game thread)"), pipelineTimings.uploadSeconds * 1000 / chunkCount);
+	UE_LOG(LogTemp, Display, TEXT("  Collision %.3f ms (game thread)"), pipelineTimings.collisionSeconds * 1000 / chunkCount);
+	UE_LOG(LogTemp, Display, TEXT("  Latency   %.3f ms (start to collision)"), pipelineTimings.latencySeconds * 1000 / chunkCount);
+	pipelineTimings = FTerrainPipelineTimings();
+}
+
+void ADynamic_Terrain::RunMeshingScalingBenchmark(int32 maxWorkers, int32 repetitions)
+{
+	EIsosurfaceGenerationAlgorithm algorithm = surfaceGenerationAlgorithm;
+	TArray<FTerrainMeshingScalingResult> results = FTerrainMeshingBenchmark::RunScalingBenchmark([algorithm]() { return CreateGenerator(algorithm); },
+		maxWorkers, repetitions, UTerrainMeshingSettings::GetTaskPriority());
+	FTerrainMeshingBenchmark::ReportResults(results, algorithm == EIsosurfaceGenerationAlgorithm::IGA_MarchingTetrahedra
+		? TEXT("MeshingScaling_MarchingTetrahedra") : TEXT("MeshingScaling_MarchingCubes"));
+}
+
+void ADynamic_Terrain::StepTimeSlicedMeshJobs()
+{
+	if (bAsyncMeshing || !bTimeSlicedMeshing)
+	{
+		return;
+	}
+
+	// Every job shares the one budget. The first job is always stepped, so that a tiny budget still makes progress
+	double deadline = FPlatformTime::Seconds() + meshingBudgetMs / 1000.0;
+	bool bSteppedAny = false;
+	auto stepJob = [&](FTerrainMeshJob& job)
+		{
+			double remainingSeconds = deadline - FPlatformTime::Seconds();
+			if (job.bWaitingForWorker || job.IsComplete() || (bSteppedAny && remainingSeconds <= 0))
+			{
+				return;
+			}
+			job.Step(FMath::Max(remainingSeconds, 0.0));
+			bSteppedAny = true;
+		};
+
+	if (meshJob.IsValid())
+	{
+		stepJob(*meshJob);
+	}
+	for (const TPair<FIntVector, TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>>& chunkJob : chunkMeshJobs)
+	{
+		stepJob(*chunkJob.Value);
+	}
+}
+
+void ADynamic_Terrain::ApplyCompletedMeshJobs()
+{
+	// Superseded jobs are dropped as soon as they are cancelled, so every job still held is the latest for its target
+	if (meshJob.IsValid() && meshJob->IsComplete())
+	{
+		TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> job = MoveTemp(meshJob);
+		meshJob.Reset();
+		ApplyMeshJob(*job);
+
+		// Remeshes requested while the job was running were held back, and are made now as one remesh against the latest grid
+		if (bRemeshAfterMeshJob)
+		{
+			bRemeshAfterMeshJob = false;
+			RemeshTerrain();
+		}
+	}
+
+	TArray<FIntVector> completedChunks;
+	for (const TPair<FIntVector, TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>>& chunkJob : chunkMeshJobs)
+	{
+		// Pipelined jobs upload themselves from their own game thread task, unless the upload was deferred for want of this frame's limit
+		if (chunkJob.Value->IsComplete() && (!chunkJob.Value->bPipelined || chunkJob.Value->bUploadDeferred))
+		{
+			completedChunks.Add(chunkJob.Key);
+		}
+	}
+
+	// Only the most urgent results are applied when more have finished than may be applied in one tick, and the rest wait for the next
+	int32 maxResults = GetRemainingChunkResultsThisFrame();
+	if (completedChunks.Num() > maxResults)
+	{
+		chunkScheduler.SortByUrgency(completedChunks, GetChunkView(), [this](const FIntVector& chunkCoords) { return GetChunkBounds(chunkCoords); });
+		completedChunks.SetNum(FMath::Max(maxResults, 0));
+	}
+
+	for (const FIntVector& chunkCoords : completedChunks)
+	{
+		TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> job = chunkMeshJobs.FindChecked(chunkCoords);
+		if (job->bPipelined)
+		{
+			// A deferred upload goes through the rest of its pipeline here, as its own collision stage has already been skipped
+			UploadPipelinedChunk(*job);
+			if (job->bUploaded)
+			{
+				RebuildPipelinedChunkCollision(*job);
+			}
+			continue;
+		}
+
+		chunkMeshJobs.Remove(chunkCoords);
+		ApplyMeshJob(*job);
+		chunkResultsAppliedThisFrame++;
+	}
+}
+
+int32 ADynamic_Terrain::GetRemainingChunkResultsThisFrame()
+{
+	// Pipelined uploads run as game thread tasks outside of Tick, so the count is kept per frame rather than reset by Tick
+	if (chunkResultsFrame != GFrameCounter)
+	{
+		chunkResultsFrame = GFrameCounter;
+		chunkResultsAppliedThisFrame = 0;
+	}
+	return FMath::Max(maxChunkResultsAppliedPerTick, 1) - chunkResultsAppliedThisFrame;
+}
+
+void ADynamic_Terrain::ApplyMeshJob(FTerrainMeshJob& job)
+{
+	// The extraction ran on a worker, so only the time it took is added here and none of it was spent on the game thread
+	frameTimings.meshSeconds += job.meshSeconds;
+
+	double uploadStartTime = FPlatformTime::Seconds();
+	job.DecodeResult();
+	switch (job.target) {
+	case ETerrainMeshJobTarget::TMJ_CellRegion:
+		ApplyCellRegionMesh(job.mesh, job.cellRegion);
+		break;
+	case ETerrainMeshJobTarget::TMJ_Chunk:
+		ApplyChunkMesh(job.chunkCoords, job.mesh);
+
+		// Remeshes requested while the job was running were held back, so the chunk is queued again to pick up the edits it missed
+		if (chunksToRemeshAfterJob.Remove(job.chunkCoords) > 0)
+		{
+			chunkScheduler.MarkDirty(FGridRegion(job.chunkCoords, job.chunkCoords));
+		}
+		break;
+	case ETerrainMeshJobTarget::TMJ_FullMesh:
+	default:
+		UpdateDynamicMesh(job.mesh, job.bHasCellGroups);
+		bMeshHasCellGroups = job.bHasCellGroups;
+		meshedIsovalue = job.isovalue;
+		break;
+	}
+
+	// The job now holds whichever mesh was displayed before, or the region mesh that was copied into the display
+	RetireMesh(job.mesh);
+	frameTimings.uploadSeconds += FPlatformTime::Seconds() - uploadStartTime;
+}
+
+void ADynamic_Terrain::CancelMeshJobs()
+{
+	if (meshJob.IsValid())
+	{
+		meshJob->Cancel();
+		meshJob.Reset();
+	}
+	bRemeshAfterMeshJob = false;
+
+	for (const TPair<FIntVector, TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>>& chunkJob : chunkMeshJobs)
+	{
+		chunkJob.Value->Cancel();
+	}
+	chunkMeshJobs.Reset();
+	chunksToRemeshAfterJob.Reset();
+	waitingMeshJobs.Reset();
+	runningMeshJobs.Reset();
+}
+
+void ADynamic_Terrain::RemeshRegion(const FGridRegion& pointRegion)
+{
+	// A modified point changes every cell it is a corner of, and the cells either side are regenerated too so that the seam lies on unchanged values
+	FGridRegion cellRegion = FGridRegion(pointRegion.minIndex - FIntVector3(2, 2, 2), pointRegion.maxIndex + FIntVector3(1, 1, 1))
+		.Clamped(FIntVector3(0, 0, 0), FIntVector3(gridPointCount.X - 2, gridPointCount.Y - 2, gridPointCount.Z - 2));
+	if (cellRegion.IsEmpty())
+	{
+		return;
+	}
+
+	// Jobs take a pooled generator of their own, while meshing in place uses the generator kept by the actor
+	std::unique_ptr<ISurfaceGenerationAlgorithm> jobGenerator = ShouldUseMeshJobs() ? AcquireGenerator() : nullptr;
+	ISurfaceGenerationAlgorithm* generator = jobGenerator ? jobGenerator.get() : PrepareGenerator();
+
+	// The window holds every corner of the cells being regenerated, and is read into the grid the generator kept from its previous run
+	FIntVector3 windowSize = cellRegion.GetSize() + FIntVector3(1, 1, 1);
+	TArray3D<float>& window = generator->dataGrid;
+	window.SetSizeUninitialized(windowSize.X, windowSize.Y, windowSize.Z);
+	ReadGridRegion(cellRegion.minIndex, window);
+	if (bMaintainSignMask)
+	{
+		window.EnableSignMask(isovalue);
+	}
+
+	FVector3f gridCellDimensions = GetGridCellDimensions();
+	FVector3f zeroCellOffset = gridCellDimensions * FVector3f(cellRegion.minIndex.X, cellRegion.minIndex.Y, cellRegion.minIndex.Z);
+	ConfigureGenerator(*generator, gridCellDimensions, zeroCellOffset, cellRegion.minIndex);
+	if (jobGenerator)
+	{
+		TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> job = CreateMeshJob(MoveTemp(jobGenerator));
+		job->target = ETerrainMeshJobTarget::TMJ_CellRegion;
+		job->cellRegion = cellRegion;
+		job->sourceRegion = pointRegion;
+		job->isovalue = isovalue;
+		StartMeshJob(job);
+		meshJob = job;
+		return;
+	}
+
+	double meshStartTime = FPlatformTime::Seconds();
+	const FDynamicMesh3& regionMesh = generator->GenerateOnCPU();
+	frameTimings.meshSeconds += FPlatformTime::Seconds() - meshStartTime;
+
+	double uploadStartTime = FPlatformTime::Seconds();
+	ApplyCellRegionMesh(regionMesh, cellRegion);
+	frameTimings.uploadSeconds += FPlatformTime::Seconds() - uploadStartTime;
+}
+
+void ADynamic_Terrain::ApplyCellRegionMesh(const FDynamicMesh3& regionMesh, const FGridRegion& cellRegion)
+{
+	if (dynamicMesh == nullptr)
+	{
+		dynamicMesh = Cast<UDynamicMeshComponent>(GetRootComponent());
+	}
+
+	if (dynamicMesh)
+	{
+		if (bPartialRenderUpdates && renderSections.IsBuilt())
+		{
+			// Every triangle keeps its ID, so only the vertices of the sections holding the changed triangles are uploaded again
+			bool bPatched = false;
+			dynamicMesh->EditMesh([&](FDynamicMesh3& mesh)
+				{
+					bPatched = renderSections.TryReplaceCellTriangles(mesh, regionMesh, cellRegion, changedRenderTriangles);
+					if (bPatched)
+					{
+						// The written triangles are the only ones left in the cells of the region, whichever IDs they had before
+						RemoveCellsFromTriangleIndex(cellRegion, [](int32) {});
+						for (int32 tid : changedRenderTriangles)
+						{
+							int32 groupID = mesh.GetTriangleGroup(tid);
+							if (groupID != FTerrainRenderSections::spareGroupID)
+							{
+								cellTriangles.Add(groupID, tid);
+							}
+						}
+					}
+				}, EDynamicMeshComponentRenderUpdateMode::NoUpdate);
+			if (bPatched)
+			{
+				dynamicMesh->FastNotifyTriangleVerticesUpdated(changedRenderTriangles, EMeshRenderAttributeFlags::Positions | EMeshRenderAttributeFlags::VertexNormals);
+				dynamicMesh->UpdateCollision(false);
+				return;
+			}
+		}
+
+		// A section that has run out of spares changes the triangles of the mesh, so every buffer is rebuilt and the sections are given new spares
+		TUniquePtr<FMeshRenderDecomposition> decomposition;
+		dynamicMesh->EditMesh([&](FDynamicMesh3& mesh)
+			{
+				ReplaceCellTriangles(mesh, regionMesh, cellRegion);
+				if (bPartialRenderUpdates)
+				{
+					ConfigureRenderSections();
+					decomposition = renderSections.Build(mesh);
+				}
+			});
+		if (decomposition.IsValid())
+		{
+			dynamicMesh->SetExternalDecomposition(MoveTemp(decomposition));
+		}
+		else
+		{
+			ResetRenderSections();
+		}
+	}
+	else {
+		UE_LOG(LogTemp, Warning, TEXT("No Mesh Component"));
+	}
+}
+
+void ADynamic_Terrain::ReplaceCellTriangles(FDynamicMesh3& mesh, const FDynamicMesh3& regionMesh, const FGridRegion& cellRegion)
+{
+	// Only the triangles indexed under the cells of the region are touched, so the cost follows the size of the edit rather than the mesh.
+	// Marching cubes triangles have vertices of their own, but marching tetrahedra triangles share theirs with their neighbours, including those outside the region.
+	// Only vertices left without a triangle are removed, so shared ones survive. Meshes with shared vertices fail HasOwnVertices in the render sections,
+	// so their partial updates always fall back to this path and a rebuild of every render buffer
+	RemoveCellsFromTriangleIndex(cellRegion, [&mesh](int32 tid)
+		{
+			mesh.RemoveTriangle(tid, true, false);
+		});
+
+	for (int32 tid : regionMesh.TriangleIndicesItr())
+	{
+		FIndex3i triangle = regionMesh.GetTriangle(tid);
+		int32 vert1 = mesh.AppendVertex(regionMesh.GetVertex(triangle.A));
+		int32 vert2 = mesh.AppendVertex(regionMesh.GetVertex(triangle.B));
+		int32 vert3 = mesh.AppendVertex(regionMesh.GetVertex(triangle.C));
+		int32 groupID = regionMesh.GetTriangleGroup(tid);
+		cellTriangles.Add(groupID, mesh.AppendTriangle(FIndex3i(vert1, vert2, vert3), groupID));
+	}
+}
+
+void ADynamic_Terrain::RebuildCellTriangleIndex(const FDynamicMesh3& mesh, bool bHasCellGroups)
+{
+	cellTriangles.Reset();
+	if (!bHasCellGroups)
+	{
+		return;
+	}
+
+	// Each triangle group is the linear index of the cell that generated it, so the mesh is only walked once per full remesh
+	for (int32 tid : mesh.TriangleIndicesItr())
+	{
+		int32 groupID = mesh.GetTriangleGroup(tid);
+		if (groupID != FTerrainRenderSections::spareGroupID)
+		{
+			cellTriangles.Add(groupID, tid);
+		}
+	}
+}
+
+void ADynamic_Terrain::RemoveCellsFromTriangleIndex(const FGridRegion& cellRegion, TFunctionRef<void(int32)> visitTriangle)
+{
+	int32 cellCountX = gridPointCount.X - 1;
+	int32 cellCountY = gridPointCount.Y - 1;
+	for (int32 z = cellRegion.minIndex.Z; z <= cellRegion.maxIndex.Z; z++)
+	{
+		for (int32 y = cellRegion.minIndex.Y; y <= cellRegion.maxIndex.Y; y++)
+		{
+			for (int32 x = cellRegion.minIndex.X; x <= cellRegion.maxIndex.X; x++)
+			{
+				for (TMultiMap<int32, int32>::TKeyIterator it = cellTriangles.CreateKeyIterator(x + cellCountX * (y + cellCountY * z)); it; ++it)
+				{
+					visitTriangle(it.Value());
+					it.RemoveCurrent();
+				}
+			}
+		}
+	}
+}
+
+void ADynamic_Terrain::ConfigureRenderSections()
+{
+	renderSections.Configure(FIntVector3(gridPointCount.X - 1, gridPointCount.Y - 1, gridPointCount.Z - 1), GetGridCellDimensions(), renderSectionCellCount, renderSectionSpareFraction);
+}
+
+void ADynamic_Terrain::ResetRenderSections()
+{
+	if (!renderSections.IsBuilt())
+	{
+		return;
+	}
+
+	renderSections.Reset();
+	if (dynamicMesh)
+	{
+		dynamicMesh->SetExternalDecomposition(nullptr);
+	}
+}
+
+void ADynamic_Terrain::ConfigureCollision(UDynamicMeshComponent* component) const
+{
+	component->SetNotifyRigidBodyCollision(true);
+	if (bEnableCollision)
+	{
+		component->SetCollisionProfileName("BlockAll");
+		component->EnableComplexAsSimpleCollision();
+	}
+	else
+	{
+		component->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
+		component->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Block);
+		component->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+		component->EnableComplexAsSimpleCollision();
+	}
+}
+
+FIntVector3 ADynamic_Terrain::GetChunkCount() const
+{
+	return FIntVector3(
+		FMath::DivideAndRoundUp(gridPointCount.X - 1, chunkCellCount),
+		FMath::DivideAndRoundUp(gridPointCount.Y - 1, chunkCellCount),
+		FMath::DivideAndRoundUp(gridPointCount.Z - 1, chunkCellCount));
+}
+
+FGridRegion ADynamic_Terrain::GetChunksTouchingPoints(const FGridRegion& pointRegion) const
+{
+	if (pointRegion.IsEmpty())
+	{
+		return FGridRegion();
+	}
+
+	// A grid point is a corner of the cells either side of it, so a point on a chunk face belongs to both chunks
+	FGridRegion cellRegion = FGridRegion(pointRegion.minIndex - FIntVector3(1, 1, 1), pointRegion.maxIndex)
+		.Clamped(FIntVector3(0, 0, 0), FIntVector3(gridPointCount.X - 2, gridPointCount.Y - 2, gridPointCount.Z - 2));
+	if (cellRegion.IsEmpty())
+	{
+		return FGridRegion();
+	}
+	return FGridRegion(cellRegion.minIndex / chunkCellCount, cellRegion.maxIndex / chunkCellCount);
+}
+
+void ADynamic_Terrain::QueueSettledChunks()
+{
+	if (unoptimizedChunks.Num() == 0)
+	{
+		return;
+	}
+
+	double now = FPlatformTime::Seconds();
+	for (auto chunk = unoptimizedChunks.CreateIterator(); chunk; ++chunk)
+	{
+		double* lastRemeshTime = chunkRemeshTimes.Find(*chunk);
+		if (lastRemeshTime == nullptr || now - *lastRemeshTime >= chunkOptimizationSettleSeconds)
+		{
+			chunkScheduler.MarkDirty(FGridRegion(*chunk, *chunk));
+			chunk.RemoveCurrent();
+		}
+	}
+}
+
+void ADynamic_Terrain::StartScheduledChunkRemeshes()
+{
+	if (!chunkScheduler.HasPendingChunks())
+	{
+		return;
+	}
+
+	chunkScheduler.offscreenDistanceScale = offscreenChunkDistanceScale;
+	TArray<FIntVector> chunksToRemesh;
+	chunkScheduler.TakeMostUrgent(FMath::Max(maxChunkJobsStartedPerTick, 1), GetChunkView(), [this](const FIntVector& chunkCoords)
+		{
+			return GetChunkBounds(chunkCoords);
+		}, chunksToRemesh);
+
+	for (const FIntVector& chunkCoords : chunksToRemesh)
+	{
+		RemeshChunk(chunkCoords);
+	}
+}
+
+FTerrainChunkView ADynamic_Terrain::GetChunkView() const
+{
+	FTerrainChunkView view;
+	const FTransform& terrainTransform = GetActorTransform();
+
+	if (APlayerCameraManager* cameraManager = UGameplayStatics::GetPlayerCameraManager(this, 0))
+	{
+		view.bHasCamera = true;
+		view.cameraLocation = terrainTransform.InverseTransformPosition(cameraManager->GetCameraLocation());
+		view.cameraForward = terrainTransform.InverseTransformVectorNoScale(cameraManager->GetCameraRotation().Vector()).GetSafeNormal();
+		view.halfFieldOfView = FMath::DegreesToRadians(cameraManager->GetFOVAngle() * 0.5f);
+	}
+
+	// The chunk under the feet of each player pawn is the one whose collision they are relying on
+	UWorld* world = GetWorld();
+	if (world)
+	{
+		FVector3f gridCellDimensions = GetGridCellDimensions();
+		FIntVector3 chunkCount = GetChunkCount();
+		for (FConstPlayerControllerIterator iterator = world->GetPlayerControllerIterator(); iterator; ++iterator)
+		{
+			APlayerController* playerController = iterator->Get();
+			APawn* pawn = playerController ? playerController->GetPawn() : nullptr;
+			if (pawn == nullptr)
+			{
+				continue;
+			}
+
+			FVector feet = pawn->GetActorLocation() - FVector(0, 0, pawn->GetSimpleCollisionHalfHeight());
+			FVector localFeet = terrainTransform.InverseTransformPosition(feet);
+			FIntVector chunkCoords(
+				FMath::FloorToInt32(localFeet.X / (gridCellDimensions.X * chunkCellCount)),
+				FMath::FloorToInt32(localFeet.Y / (gridCellDimensions.Y * chunkCellCount)),
+				FMath::FloorToInt32(localFeet.Z / (gridCellDimensions.Z * chunkCellCount)));
+			if (FGridRegion(FIntVector3(0, 0, 0), chunkCount - FIntVector3(1, 1, 1)).Contains(chunkCoords))
+			{
+				view.occupiedChunks.Add(chunkCoords);
+			}
+		}
+	}
+	return view;
+}
+
+FBox ADynamic_Terrain::GetChunkBounds(const FIntVector& chunkCoords) const
+{
+	FVector3f gridCellDimensions = GetGridCellDimensions();
+	FVector chunkSize(gridCellDimensions.X * chunkCellCount, gridCellDimensions.Y * chunkCellCount, gridCellDimensions.Z * chunkCellCount);
+	FVector chunkMin(chunkCoords.X * chunkSize.X, chunkCoords.Y * chunkSize.Y, chunkCoords.Z * chunkSize.Z);
+	return FBox(chunkMin, chunkMin + chunkSize);
+}
+
+void ADynamic_Terrain::RemeshChunk(const FIntVector& chunkCoords)
+{
+	FIntVector3 pointMin = chunkCoords * chunkCellCount;
+	FIntVector3 pointMax = FIntVector3(
+		FMath::Min(pointMin.X + chunkCellCount, gridPointCount.X - 1),
+		FMath::Min(pointMin.Y + chunkCellCount, gridPointCount.Y - 1),
+		FMath::Min(pointMin.Z + chunkCellCount, gridPointCount.Z - 1));
+
+	// A job already meshing the chunk is left to finish, and the chunk is queued again once its result has been applied.
+	// A finished job is applied so that nothing is thrown away, and one that has not started yet is simply replaced.
+	// Either way this remesh covers any request held back, so applying the old result must not queue the chunk again
+	chunksToRemeshAfterJob.Remove(chunkCoords);
+	if (TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>* runningJob = chunkMeshJobs.Find(chunkCoords))
+	{
+		if (!(*runningJob)->IsComplete() && (*runningJob)->HasStarted())
+		{
+			chunksToRemeshAfterJob.Add(chunkCoords);
+			return;
+		}
+
+		TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> supersededJob;
+		chunkMeshJobs.RemoveAndCopyValue(chunkCoords, supersededJob);
+		if (supersededJob->IsComplete())
+		{
+			ApplyMeshJob(*supersededJob);
+		}
+		else
+		{
+			supersededJob->Cancel();
+		}
+	}
+
+	// Chunks the surface cannot pass through are not worth reading in full
+	if (!CanRegionContainSurface(pointMin, pointMax))
+	{
+		DestroyChunkComponent(chunkCoords);
+		return;
+	}
+
+	// Jobs take a pooled generator of their own, while meshing in place uses the generator kept by the actor
+	std::unique_ptr<ISurfaceGenerationAlgorithm> jobGenerator = ShouldUseMeshJobs() || bPipelineChunkRemeshes ? AcquireGenerator() : nullptr;
+	ISurfaceGenerationAlgorithm* generator = jobGenerator ? jobGenerator.get() : PrepareGenerator();
+
+	// The window covers the grid points of the chunk, including the face it shares with the next chunk along.
+	// Chunks are all the same size, so the grid the generator kept from its previous run always fits
+	double snapshotStartTime = FPlatformTime::Seconds();
+	FIntVector3 windowSize = pointMax - pointMin + FIntVector3(1, 1, 1);
+	TArray3D<float>& window = generator->dataGrid;
+	window.SetSizeUninitialized(windowSize.X, windowSize.Y, windowSize.Z);
+	ReadGridRegion(pointMin, window);
+	if (bMaintainSignMask)
+	{
+		window.EnableSignMask(isovalue);
+	}
+
+	// Chunk meshes are built in chunk-local space, with the component placed at the corner of the chunk
+	ConfigureGenerator(*generator, GetGridCellDimensions(), FVector3f::ZeroVector, pointMin);
+	if (jobGenerator)
+	{
+		// Optimizing a mesh that is about to be replaced is wasted work, so chunks being edited are optimized once they settle.
+		// Time sliced jobs are stepped on the game thread, where neither decimation nor the optimization would be hidden
+		double remeshTime = FPlatformTime::Seconds();
+		double* lastRemeshTime = chunkRemeshTimes.Find(chunkCoords);
+		bool bBeingEdited = lastRemeshTime != nullptr && remeshTime - *lastRemeshTime < chunkOptimizationSettleSeconds;
+		chunkRemeshTimes.Add(chunkCoords, remeshTime);
+		bool bOnWorker = bAsyncMeshing || bPipelineChunkRemeshes;
+		bool bOptimize = bOptimizeChunkVertexCache && bOnWorker && !bBeingEdited;
+		if (bOptimizeChunkVertexCache && bOnWorker && bBeingEdited)
+		{
+			unoptimizedChunks.Add(chunkCoords);
+		}
+		else
+		{
+			unoptimizedChunks.Remove(chunkCoords);
+		}
+
+		TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> job = CreateMeshJob(MoveTemp(jobGenerator));
+		job->target = ETerrainMeshJobTarget::TMJ_Chunk;
+		job->chunkCoords = chunkCoords;
+		job->bDecimate = bDecimateChunks && bOnWorker;
+		job->decimationErrorTolerance = chunkDecimationErrorTolerance;
+		job->decimationTriangleBudget = chunkDecimationTriangleBudget;
+		job->bOptimizeVertexCache = bOptimize;
+		job->bQuantizeResult = bQuantizeChunkMeshes;
+
+		// Every chunk is quantized within a box of the full chunk size in its own space, so the lattices of neighbouring chunks line up on their shared faces
+		job->quantizeExtent = GetGridCellDimensions() * (float)chunkCellCount;
+		job->sourceRegion = FGridRegion(pointMin, pointMax);
+		job->isovalue = isovalue;
+		job->startTime = snapshotStartTime;
+		job->snapshotSeconds = FPlatformTime::Seconds() - snapshotStartTime;
+		chunkMeshJobs.Add(chunkCoords, job);
+		StartMeshJob(job);
+		return;
+	}
+
+	double meshStartTime = FPlatformTime::Seconds();
+	FDynamicMesh3& chunkMesh = generator->GenerateOnCPU();
+	frameTimings.meshSeconds += FPlatformTime::Seconds() - meshStartTime;
+
+	double uploadStartTime = FPlatformTime::Seconds();
+	ApplyChunkMesh(chunkCoords, chunkMesh);
+	frameTimings.uploadSeconds += FPlatformTime::Seconds() - uploadStartTime;
+}
+
+void ADynamic_Terrain::ApplyChunkMesh(const FIntVector& chunkCoords, FDynamicMesh3& chunkMesh)
+{
+	if (chunkMesh.TriangleCount() == 0)
+	{
+		DestroyChunkComponent(chunkCoords);
+		return;
+	}
+
+	UDynamicMeshComponent** existingComponent = chunkMeshes.Find(chunkCoords);
+	UDynamicMeshComponent* chunkComponent = existingComponent ? *existingComponent : CreateChunkComponent(chunkCoords);
+	PresentMesh(chunkComponent, chunkMesh);
+}
+
+UDynamicMeshComponent* ADynamic_Terrain::CreateChunkComponent(const FIntVector& chunkCoords)
+{
+	// Names of destroyed chunks are held until garbage collection, so the name is made unique rather than reused
+	FName chunkName = MakeUniqueObjectName(this, UDynamicMeshComponent::StaticClass(), FName(*FString::Printf(TEXT("Chunk_%d_%d_%d"), chunkCoords.X, chunkCoords.Y, chunkCoords.Z)));
+	UDynamicMeshComponent* chunkComponent = NewObject<UDynamicMeshComponent>(this, chunkName);
+	chunkComponent->SetupAttachment(RootComponent);
+
+	FVector3f gridCellDimensions = GetGridCellDimensions();
+	FIntVector3 cellMin = chunkCoords * chunkCellCount;
+	chunkComponent->SetRelativeLocation(FVector(cellMin.X * gridCellDimensions.X, cellMin.Y * gridCellDimensions.Y, cellMin.Z * gridCellDimensions.Z));
+
+	// Chunks are drawn with the material assigned to the root component
+	if (dynamicMesh)
+	{
+		chunkComponent->SetMaterial(0, dynamicMesh->GetMaterial(0));
+	}
+
+	ConfigureCollision(chunkComponent);
+	if (bPipelineChunkRemeshes)
+	{
+		// Collision is left to its own pipeline stage rather than being rebuilt inside SetMesh, and is cooked off the game thread
+		chunkComponent->SetDeferredCollisionUpdatesEnabled(true, false);
+		chunkComponent->bUseAsyncCooking = true;
+	}
+	chunkComponent->RegisterComponent();
+
+	chunkMeshes.Add(chunkCoords, chunkComponent);
+	return chunkComponent;
+}
+
+void ADynamic_Terrain::DestroyChunkComponent(const FIntVector& chunkCoords)
+{
+	UDynamicMeshComponent* chunkComponent = nullptr;
+	if (chunkMeshes.RemoveAndCopyValue(chunkCoords, chunkComponent) && chunkComponent)
+	{
+		chunkComponent->DestroyComponent();
+	}
+}
+
+void ADynamic_Terrain::UpdateDynamicMesh(UE::Geometry::FDynamicMesh3& mesh, bool bHasCellGroups)
+{
+	if (dynamicMesh == nullptr)
+	{
+		dynamicMesh = Cast<UDynamicMeshComponent>(GetRootComponent());
+	}
+
+	if (dynamicMesh) 
+	{
+		RebuildCellTriangleIndex(mesh, bHasCellGroups);
+		if (bPartialRenderUpdates && bHasCellGroups)
+		{
+			// The proxy is only rebuilt once at the end of the frame, so handing over the mesh and its sections separately costs nothing extra
+			ConfigureRenderSections();
+			TUniquePtr<FMeshRenderDecomposition> decomposition = renderSections.Build(mesh);
+			PresentMesh(dynamicMesh, mesh);
+			dynamicMesh->SetExternalDecomposition(MoveTemp(decomposition));
+		}
+		else
+		{
+			PresentMesh(dynamicMesh, mesh);
+			ResetRenderSections();
+		}
 	}
 	else {
 		UE_LOG(LogTemp, Warning, TEXT("No Mesh Component"));
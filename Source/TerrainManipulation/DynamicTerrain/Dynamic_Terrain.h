@@ -5,6 +5,19 @@
 #include "ProceduralMeshComponent.h"
 #include "Components/DynamicMeshComponent.h"
 #include "TerrainManipulation/DataStructs/TArray3D.h"
+#include "TerrainManipulation/DataStructs/TNarrowBandArray3D.h"
+#include "TerrainManipulation/DataStructs/GridRegion.h"
+#include "TerrainManipulation/DataStructs/TBoundedMpscQueue.h"
+#include "TerrainEditQueue.h"
+#include "TerrainEditJournal.h"
+#include "TerrainEditRecording.h"
+#include "ImplicitTerrainField.h"
+#include "TerrainRedistancer.h"
+#include "TerrainMeshJob.h"
+#include "TerrainGeneratorPool.h"
+#include "TerrainChunkScheduler.h"
+#include "TerrainMeshingSettings.h"
+#include "TerrainRenderSections.h"
 #include "MarchingCubes/MarchingCubesGenerator.h"
 #include "MarchingTetrahedra/MarchingTetrahedraGenerator.h"
 #include "Dynamic_Terrain.generated.h"
@@ -15,6 +28,14 @@ enum class EIsosurfaceGenerationAlgorithm {
 	IGA_MarchingTetrahedra
 };
 
+UENUM()
+enum class ETerrainStorageMode {
+	TSM_Dense,
+	TSM_NarrowBand,
+	// A procedural base field and a list of edits, evaluated only for the bricks that are meshed or queried
+	TSM_ImplicitEdits
+};
+
 UCLASS()
 class TERRAINMANIPULATION_API ADynamic_Terrain : public AActor
 {
@@ -55,14 +76,192 @@ protected:
 	UPROPERTY(EditAnywhere)
 	bool bUseGPU;
 
+	// Maintain a chain of downsampled min/max/average levels alongside the dataGrid for coarse queries
+	UPROPERTY(EditAnywhere)
+	bool bMaintainMipChain = false;
+
+	// The number of downsampled levels to maintain above the full resolution dataGrid
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bMaintainMipChain", ClampMin = 1))
+	int32 mipChainLevelCount = 4;
+
+	// The mip level to extract the mesh from, where 0 is the full resolution dataGrid
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bMaintainMipChain", ClampMin = 0))
+	int32 meshMipLevel = 0;
+
+	// Maintain a bitmask of which grid points lie above the isovalue so that inactive cells can be skipped without reading the dataGrid
+	UPROPERTY(EditAnywhere)
+	bool bMaintainSignMask = true;
+
+	// How the scalar field is stored between edits
+	UPROPERTY(EditAnywhere)
+	ETerrainStorageMode storageMode = ETerrainStorageMode::TSM_Dense;
+
+	// The number of grid points either side of the surface that keep full precision values in narrow band storage
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "storageMode == ETerrainStorageMode::TSM_NarrowBand", ClampMin = 1))
+	int32 narrowBandWidth = 3;
+
+	// The distance from the isovalue reported for grid points outside of the narrow band
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "storageMode == ETerrainStorageMode::TSM_NarrowBand"))
+	float narrowBandFarValue = 1;
+
+	// The number of evaluated bricks of implicit storage kept in memory before the least recently used are discarded
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "storageMode == ETerrainStorageMode::TSM_ImplicitEdits", ClampMin = 1))
+	int32 implicitBrickCacheSize = 4096;
+
+	// Only re-extract the cells around regions edited since the last remesh, rather than the whole dataGrid
+	UPROPERTY(EditAnywhere)
+	bool bIncrementalRemesh = true;
+
+	// Split the render buffers of the root mesh into sections of cells, so that an incremental remesh re-uploads only the sections it touches rather than every buffer.
+	// Each section keeps spare triangles to take up growth, and the whole mesh is only rebuilt once a section runs out. Not used with chunks, which are already separate components
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bIncrementalRemesh"))
+	bool bPartialRenderUpdates = false;
+
+	// The number of grid cells along each axis of a render section
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bPartialRenderUpdates", ClampMin = 1))
+	int32 renderSectionCellCount = 16;
+
+	// The spare triangles given to each render section whenever the mesh is rebuilt, as a fraction of the triangles it holds
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bPartialRenderUpdates", ClampMin = 0))
+	float renderSectionSpareFraction = 0.25f;
+
+	// Extract meshes on worker threads from a copy of the grid, and apply each result on a later tick once it is ready.
+	// A remesh requested while a job is running waits for it to finish, and every such request is then made as one remesh. Not used for GPU generation
+	UPROPERTY(EditAnywhere)
+	bool bAsyncMeshing = false;
+
+	// Generate meshes on the game thread a few rows of cells per tick, and swap each result in once it is complete.
+	// Spreads the cost of a remesh across frames where there are too few cores to offload it, and a remesh requested part way through waits for the job to finish.
+	// Ignored when bAsyncMeshing is set
+	UPROPERTY(EditAnywhere)
+	bool bTimeSlicedMeshing = false;
+
+	// The time in milliseconds each tick may spend on time sliced meshing before the rest is left for the next tick
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bTimeSlicedMeshing", ClampMin = 0))
+	float meshingBudgetMs = 4;
+
+	// Split the terrain into chunks that each own a mesh component, so that an edit only rebuilds the render data and collision of the chunks it touches.
+	// Chunks are always meshed on the CPU at full resolution. Narrow band and implicit storage are always meshed in chunks, as they have no dense grid to mesh in one piece
+	UPROPERTY(EditAnywhere)
+	bool bUseChunks = false;
+
+	// The number of grid cells along each axis of a chunk. Neighbouring chunks share the grid points on their common face
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bUseChunks || storageMode != ETerrainStorageMode::TSM_Dense", ClampMin = 1))
+	int32 chunkCellCount = 32;
+
+	// Run each chunk remesh as a chain of tasks: the grid snapshot on the game thread, extraction on a worker, then upload and collision as separate game thread tasks.
+	// The stages of different chunks overlap, and collision is cooked asynchronously. Applies whether or not bAsyncMeshing is set
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bUseChunks || storageMode != ETerrainStorageMode::TSM_Dense"))
+	bool bPipelineChunkRemeshes = false;
+
+	// Hand chunk meshes from the workers back to the game thread as 3x16 bit chunk local positions and oct-encoded normals, decoded when they are applied.
+	// Cuts the memory held by finished chunk meshes waiting to be applied, at the cost of decoding them on the game thread
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bUseChunks || storageMode != ETerrainStorageMode::TSM_Dense"))
+	bool bQuantizeChunkMeshes = false;
+
+	// Simplify each chunk mesh with quadric error edge collapses on the worker that generated it, for both rendering and collision.
+	// The faces of each chunk are left as generated so that seams stay watertight. Only applies to chunks meshed on worker threads
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bUseChunks || storageMode != ETerrainStorageMode::TSM_Dense"))
+	bool bDecimateChunks = false;
+
+	// The furthest a decimated chunk may stray from the generated surface, in local units. Zero leaves the error unbounded, so the triangle budget alone applies
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bDecimateChunks", ClampMin = 0))
+	float chunkDecimationErrorTolerance = 1;
+
+	// The triangle count each chunk is decimated down to, unless the error tolerance stops it first. Zero decimates as far as the error tolerance allows
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bDecimateChunks", ClampMin = 0))
+	int32 chunkDecimationTriangleBudget = 0;
+
+	// Reorder the triangles of each chunk mesh for vertex cache locality on the worker that generated it. Only applies to chunks meshed on worker threads
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bUseChunks || storageMode != ETerrainStorageMode::TSM_Dense"))
+	bool bOptimizeChunkVertexCache = false;
+
+	// A chunk remeshed again within this many seconds is treated as being edited, and is not optimized until it has been left alone for this long
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bOptimizeChunkVertexCache", ClampMin = 0))
+	float chunkOptimizationSettleSeconds = 2;
+
+	// The largest number of chunk remeshes started each tick. Chunks under a pawn go first, then visible chunks by distance, then the rest
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bUseChunks || storageMode != ETerrainStorageMode::TSM_Dense", ClampMin = 1))
+	int32 maxChunkJobsStartedPerTick = 16;
+
+	// The largest number of finished chunk meshes handed to their components each tick, when meshing asynchronously, time sliced or pipelined
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bUseChunks || storageMode != ETerrainStorageMode::TSM_Dense", ClampMin = 1))
+	int32 maxChunkResultsAppliedPerTick = 16;
+
+	// Chunks outside the camera's view are scheduled as if they were this many times further away
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bUseChunks || storageMode != ETerrainStorageMode::TSM_Dense", ClampMin = 1))
+	float offscreenChunkDistanceScale = 4;
+
+	// The mesh component of every chunk that currently contains part of the surface
+	UPROPERTY(VisibleInstanceOnly, Transient)
+	TMap<FIntVector, UDynamicMeshComponent*> chunkMeshes;
+
+	// The number of queued brushes that can wait to be picked up by the next tick. Brushes queued beyond this are rejected rather than growing the queue.
+	// Read once when the terrain is initialised
+	UPROPERTY(EditAnywhere, meta = (ClampMin = 2))
+	int32 editQueueCapacity = 4096;
+
+	// Queued edits whose centres are closer than this distance (in world units) and share a radius are merged into one edit.
+	// The merged edit is centred on the first, so any value above zero is lossy: the footprint of the later edit is moved onto the earlier one
+	UPROPERTY(EditAnywhere, meta = (ClampMin = 0))
+	float editCoalesceTolerance = 0;
+
+	// The number of grid points in a brush footprint above which the brush is applied across worker threads
+	UPROPERTY(EditAnywhere, meta = (ClampMin = 1))
+	int64 brushParallelPointThreshold = FTerrainBrush::DefaultParallelPointThreshold;
+
+	// Record the bricks changed by each edit batch so that edits can be undone and redone. Not available with implicit storage
+	UPROPERTY(EditAnywhere)
+	bool bRecordEditHistory = true;
+
+	// The compressed size in megabytes of edit history kept in memory, beyond which the oldest batches are written to the Saved directory
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bRecordEditHistory", ClampMin = 0))
+	int32 editHistoryMemoryCapMB = 64;
+
+	// The number of edit batches that can be undone
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bRecordEditHistory", ClampMin = 1))
+	int32 editHistoryMaxBatches = 100;
+
+	// After edits, rewrite the field around them as the signed distance to the surface, which keeps gradients and interpolation well behaved.
+	// The work is spread across ticks within a time budget, and the edit history batch of the edits stays open until it has finished,
+	// so any edits made in the meantime are undone together with them. Not available with implicit storage
+	UPROPERTY(EditAnywhere)
+	bool bRedistanceAfterEdits = false;
+
+	// The number of grid cells around each edit that are redistanced, which is also the largest distance represented in the field
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bRedistanceAfterEdits", ClampMin = 1))
+	int32 redistanceMarginCells = 4;
+
+	// The change in value of the redistanced field over the width of one grid cell
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bRedistanceAfterEdits", ClampMin = 0))
+	float redistanceValuePerCell = 0.25f;
+
+	// The time in milliseconds each tick may spend redistancing before the rest is left for the next tick
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bRedistanceAfterEdits", ClampMin = 0))
+	float redistanceBudgetMs = 2;
+
+	// The seed used to generate the initial scalar field, so that the same terrain can be rebuilt for a replay
+	UPROPERTY(EditAnywhere)
+	int32 randomSeed = 0;
+
+	// Start recording edits as soon as play begins. The recording is saved to the Saved directory when play ends
+	UPROPERTY(EditAnywhere)
+	bool bRecordEditsFromBeginPlay = false;
+
 public:
 	// Sets default values for this actor's properties
 	ADynamic_Terrain();
 
 protected:
+	// Called once the properties are loaded and the components initialised, before any actor begins play
+	virtual void PostInitializeComponents() override;
+
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Called when the game ends or when destroyed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -97,6 +296,24 @@ public:
 	UFUNCTION(BlueprintPure)
 	float GetValueOfDataGrid(const FIntVector &vertexCoords) const;
 
+	/// <summary>
+	/// Conservatively test whether the isosurface may pass through a box of grid points, using the mip chain when available.
+	/// Any edits not yet folded into the mip chain are applied to it first, so this is not a pure query
+	/// </summary>
+	/// <param name="minCoords">The lowest grid indices of the box (inclusive)</param>
+	/// <param name="maxCoords">The highest grid indices of the box (inclusive)</param>
+	/// <returns>False only if every grid point in the box lies on the same side of the isovalue</returns>
+	UFUNCTION(BlueprintCallable)
+	bool CanRegionContainSurface(const FIntVector& minCoords, const FIntVector& maxCoords);
+
+	/// <summary>
+	/// Check whether a grid point lies inside the solid, using the sign mask when available
+	/// </summary>
+	/// <param name="vertexCoords">Vector of ints for the X,Y,Z indices</param>
+	/// <returns>True if the value of the scalar field at this vertex is above the isovalue</returns>
+	UFUNCTION(BlueprintPure)
+	bool IsGridPointInside(const FIntVector& vertexCoords) const;
+
 	/// <summary>
 	/// Add a value to all data points within a radius of a specified point in world-space
 	/// </summary>
@@ -106,11 +323,109 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void AddToDataGridInRadius(FVector centre, float radius, float valueToAdd);
 
+	/// <summary>
+	/// Apply a brush to the scalar field immediately. The mesh is not updated until the next remesh
+	/// </summary>
+	/// <param name="brush">The brush to apply, with its centre in world space</param>
+	UFUNCTION(BlueprintCallable)
+	void ApplyBrush(const FTerrainBrush& brush);
+
+	/// <summary>
+	/// Queue a brush to be applied on the next tick, followed by a single remesh. Safe to call from any thread
+	/// </summary>
+	/// <param name="brush">The brush to apply, with its centre in world space</param>
+	UFUNCTION(BlueprintCallable)
+	void QueueBrush(const FTerrainBrush& brush);
+
+	/// <summary>
+	/// Queue a brush to be applied on the next tick without taking any lock. Safe to call from any thread
+	/// </summary>
+	/// <param name="brush">The brush to apply, with its centre in world space</param>
+	/// <returns>False if the queue is full and the brush was dropped, in which case the caller should slow down or retry later</returns>
+	UFUNCTION(BlueprintCallable)
+	bool TryQueueBrush(const FTerrainBrush& brush);
+
+	/// <summary>
+	/// Get how full the edit queue is, for producers that want to back off before their brushes start being rejected
+	/// </summary>
+	/// <returns>The fraction of the queue's capacity in use, from 0 to 1</returns>
+	UFUNCTION(BlueprintPure)
+	float GetEditQueueFill() const;
+
+	/// <summary>
+	/// Queue an addition to all data points within a radius of a specified point in world-space.
+	/// Queued edits are applied together on the next tick, followed by a single remesh
+	/// </summary>
+	/// <param name="centre">The centre of the sphere</param>
+	/// <param name="radius">The radius of the sphere</param>
+	/// <param name="valueToAdd">The value to be added to all points in the radius</param>
+	UFUNCTION(BlueprintCallable)
+	void QueueEdit(FVector centre, float radius, float valueToAdd);
+
+	/// <summary>
+	/// Recalculate the mesh on the next tick, after any queued edits have been applied
+	/// </summary>
+	UFUNCTION(BlueprintCallable)
+	void RequestRemesh();
+
+	/// <summary>
+	/// Revert the most recent edit batch and remesh the region it modified
+	/// </summary>
+	/// <returns>False if there is nothing to undo</returns>
+	UFUNCTION(BlueprintCallable)
+	bool Undo();
+
+	/// <summary>
+	/// Reapply the most recently undone edit batch and remesh the region it modified
+	/// </summary>
+	/// <returns>False if there is nothing to redo</returns>
+	UFUNCTION(BlueprintCallable)
+	bool Redo();
+
+	/// <summary>
+	/// Start logging every edit and remesh. Replays start from a freshly initialised grid, so recording should start before the first edit
+	/// </summary>
+	UFUNCTION(BlueprintCallable)
+	void StartRecording();
+
+	/// <summary>
+	/// Stop logging edits and save the log to the Saved/TerrainRecordings directory
+	/// </summary>
+	/// <param name="recordingName">The name of the file, without an extension</param>
+	/// <returns>False if no recording was in progress or the file could not be written</returns>
+	UFUNCTION(BlueprintCallable)
+	bool StopRecording(const FString& recordingName);
+
+	/// <summary>
+	/// Reinitialise the terrain with the settings of a recording and reapply its edits, reporting the time spent on each frame when it finishes
+	/// </summary>
+	/// <param name="recordingName">The name of the file in Saved/TerrainRecordings, without an extension</param>
+	/// <param name="bMaximumSpeed">Replay every frame immediately, rather than one recorded frame per tick</param>
+	/// <returns>False if the recording could not be loaded</returns>
+	UFUNCTION(BlueprintCallable)
+	bool StartReplay(const FString& recordingName, bool bMaximumSpeed);
+
+	/// <summary>
+	/// Log the mean time each stage of pipelined chunk remeshes has taken, and start measuring again
+	/// </summary>
+	UFUNCTION(BlueprintCallable)
+	void LogPipelineTimings();
+
+	/// <summary>
+	/// Mesh a fixed dataset with the terrain's algorithm on 1 to maxWorkers worker threads, logging the speedup and efficiency of each and saving them to Saved/Benchmarks.
+	/// Blocks the game thread until it is done
+	/// </summary>
+	/// <param name="maxWorkers">The most workers to try. Zero tries every worker thread of the meshing priority</param>
+	/// <param name="repetitions">The number of timed runs per worker count, of which the fastest is kept</param>
+	UFUNCTION(BlueprintCallable)
+	void RunMeshingScalingBenchmark(int32 maxWorkers, int32 repetitions);
+
 	/// <summary>
 	/// Update the dynamic mesh component with a new FDynamicMesh3 mesh
 	/// </summary>
-	/// <param name="mesh">The new mesh to be rendered</param>
-	void UpdateDynamicMesh(UE::Geometry::FDynamicMesh3& mesh);
+	/// <param name="mesh">The new mesh to be rendered, which is swapped for the mesh that was rendered before</param>
+	/// <param name="bHasCellGroups">Whether every triangle of the mesh is grouped by the cell that generated it, which render sections rely upon</param>
+	void UpdateDynamicMesh(UE::Geometry::FDynamicMesh3& mesh, bool bHasCellGroups = false);
 
 private:
 
@@ -119,11 +434,459 @@ private:
 	/// </summary>
 	void InitialiseDataGrid();
 
+	/// <summary>
+	/// Get the value of a grid point before any edits are applied.
+	/// This depends only on the indices and the random seed, so it can be evaluated in any order and on any thread
+	/// </summary>
+	float GetBaseFieldValue(int32 x, int32 y, int32 z) const;
+
+	/// <summary>
+	/// Check whether edit batches should be recorded in the journal, which needs storage that can be written back to
+	/// </summary>
+	bool ShouldRecordEditHistory() const;
+
+	/// <summary>
+	/// Apply every queued edit, then remesh once if anything has changed.
+	/// The journal batch is committed once the edits and the redistancing they queued have all been applied, which may be several ticks later
+	/// </summary>
+	void ProcessEditQueue();
+
+	/// <summary>
+	/// Move every brush pushed from other threads into the edit queue, coalescing them with the brushes already there
+	/// </summary>
+	void DrainIncomingEdits();
+
+	/// <summary>
+	/// Check whether edits should be followed by redistancing, which needs storage that can be written back to
+	/// </summary>
+	bool ShouldRedistance() const;
+
+	/// <summary>
+	/// Redistance queued bricks until the time budget is used up, adding them to the dirty region and the open journal batch
+	/// </summary>
+	/// <param name="maxBricks">The number of bricks to redistance regardless of the time budget, or zero to use the budget</param>
+	/// <returns>True if any grid points were rewritten</returns>
+	bool RedistanceEditedBricks(int32 maxBricks = 0);
+
+	/// <summary>
+	/// Add an event to the recording in progress
+	/// </summary>
+	/// <returns>The event, for filling in any fields particular to its type</returns>
+	FTerrainEditEvent& RecordEditEvent(ETerrainEditEventType type, const FTerrainBrush& brush = FTerrainBrush());
+
+	/// <summary>
+	/// Apply every recorded event belonging to the next frame of the replay
+	/// </summary>
+	/// <returns>False once every event has been replayed</returns>
+	bool ReplayNextFrame();
+
+	/// <summary>
+	/// End the replay and report the timings of every frame
+	/// </summary>
+	void FinishReplay();
+
 	UE::Geometry::FDynamicMesh3 RegenerateByHand();
 
+	/// <summary>
+	/// Read a value of the scalar field from whichever storage is in use
+	/// </summary>
+	float GetGridValue(int32 x, int32 y, int32 z) const;
+
+	/// <summary>
+	/// Get the size of a single grid cell in local coordinates
+	/// </summary>
+	FVector3f GetGridCellDimensions() const;
+
+	/// <summary>
+	/// Copy a box of the scalar field from whichever storage is in use
+	/// </summary>
+	/// <param name="regionMin">The grid indices of the first point to copy</param>
+	/// <param name="outGrid">The grid to fill, whose size determines the extent of the box</param>
+	void ReadGridRegion(FIntVector3 regionMin, TArray3D<float>& outGrid) const;
+
+	/// <summary>
+	/// Overwrite a box of the scalar field in whichever storage is in use
+	/// </summary>
+	/// <param name="regionMin">The grid indices of the first point to write</param>
+	/// <param name="sourceGrid">The values to write, whose size determines the extent of the box</param>
+	void WriteGridRegion(FIntVector3 regionMin, const TArray3D<float>& sourceGrid);
+
+	/// <summary>
+	/// Record the values of every brick overlapping a region that has not yet been captured by the current edit batch
+	/// </summary>
+	/// <param name="pointRegion">The grid points about to be modified</param>
+	void CaptureJournalBricks(const FGridRegion& pointRegion);
+
+	/// <summary>
+	/// Finish recording the current edit batch
+	/// </summary>
+	void CommitJournalBatch();
+
+	/// <summary>
+	/// Redistance every queued brick regardless of the time budget, then commit the open journal batch if there is one.
+	/// The field and the undo history are then the same however the work would otherwise have been spread over ticks
+	/// </summary>
+	void CompleteJournalBatch();
+
+	/// <summary>
+	/// Undo or redo a batch from the edit journal without remeshing
+	/// </summary>
+	/// <param name="bUndo">Undo the most recent batch if true, otherwise redo the most recently undone batch</param>
+	/// <returns>False if there was no batch to apply</returns>
+	bool ApplyJournalBatch(bool bUndo);
+
+	/// <summary>
+	/// XOR the deltas of an undone or redone batch into the scalar field
+	/// </summary>
+	void ApplyJournalDeltas(const TArray<FTerrainBrickDelta>& deltas);
+
+	/// <summary>
+	/// Create a new generator for an algorithm
+	/// </summary>
+	/// <returns>The generator, owned by the caller</returns>
+	static std::unique_ptr<ISurfaceGenerationAlgorithm> CreateGenerator(EIsosurfaceGenerationAlgorithm algorithm);
+
+	/// <summary>
+	/// Get the generator for the selected algorithm that the actor meshes with on the game thread, creating it the first time.
+	/// It lives as long as the actor, so every remesh reuses the grid snapshot and scratch buffers of the one before
+	/// </summary>
+	/// <returns>The generator, which is retained by the actor</returns>
+	ISurfaceGenerationAlgorithm* PrepareGenerator();
+
+	/// <summary>
+	/// Take a generator for the selected algorithm from the pool shared with mesh jobs
+	/// </summary>
+	/// <returns>The generator, owned by the caller until it is handed to CreateMeshJob</returns>
+	std::unique_ptr<ISurfaceGenerationAlgorithm> AcquireGenerator();
+
+	/// <summary>
+	/// Get the pool of generators for the selected algorithm, creating it the first time
+	/// </summary>
+	const TSharedPtr<FTerrainGeneratorPool, ESPMode::ThreadSafe>& GetGeneratorPool();
+
+	/// <summary>
+	/// Hand a generator the settings for meshing the grid that has been copied into its dataGrid
+	/// </summary>
+	/// <param name="generator">The generator to set up</param>
+	/// <param name="gridCellDimensions">The size of a single cell of the dataGrid in local coordinates</param>
+	/// <param name="zeroCellOffset">The local position of the (0,0,0) point of the dataGrid</param>
+	/// <param name="gridIndexOffset">The indices of the (0,0,0) point of the dataGrid within the whole terrain</param>
+	void ConfigureGenerator(ISurfaceGenerationAlgorithm& generator, FVector3f gridCellDimensions, FVector3f zeroCellOffset, FIntVector3 gridIndexOffset) const;
+
+	/// <summary>
+	/// Create a job around a generator taken from AcquireGenerator, which goes back to the pool once the job is finished with it
+	/// </summary>
+	TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> CreateMeshJob(std::unique_ptr<ISurfaceGenerationAlgorithm> generator);
+
+	/// <summary>
+	/// Get the largest number of mesh jobs that can be generating at once, which bounds how many idle generators and retired meshes are worth keeping
+	/// </summary>
+	static int32 GetMaxConcurrentMeshJobs();
+
+	/// <summary>
+	/// Swap a newly built mesh into a component in place of the mesh it displays, so that the old mesh's storage is handed back rather than freed
+	/// </summary>
+	/// <param name="component">The component to update</param>
+	/// <param name="mesh">The mesh to display, which receives the mesh the component displayed before</param>
+	static void PresentMesh(UDynamicMeshComponent* component, UE::Geometry::FDynamicMesh3& mesh);
+
+	/// <summary>
+	/// Keep a mesh that is no longer displayed to be written over by a later mesh job, or free it on a worker thread if enough are kept already
+	/// </summary>
+	/// <param name="mesh">The mesh to retire, which is left empty</param>
+	void RetireMesh(UE::Geometry::FDynamicMesh3& mesh);
+
+	/// <summary>
+	/// Check whether CPU remeshes should be handed to mesh jobs, rather than generated and applied immediately
+	/// </summary>
+	bool ShouldUseMeshJobs() const;
+
+	/// <summary>
+	/// Check whether the terrain is meshed in chunks, either by choice or because the storage mode only allows reading it a piece at a time
+	/// </summary>
+	bool ShouldMeshInChunks() const;
+
+	/// <summary>
+	/// Queue a remesh of every chunk whose vertex cache optimization was skipped while it was being edited, once it has been left alone for long enough
+	/// </summary>
+	void QueueSettledChunks();
+
+	/// <summary>
+	/// Queue a new job for a worker thread, or leave it to be stepped from Tick when time slicing
+	/// </summary>
+	void StartMeshJob(const TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>& job);
+
+	/// <summary>
+	/// Launch queued jobs, oldest first, until as many are running as the meshing settings allow
+	/// </summary>
+	void LaunchWaitingMeshJobs();
+
+	/// <summary>
+	/// Launch a chunk job on a worker and chain game thread tasks after it to upload the mesh and then rebuild the collision
+	/// </summary>
+	void LaunchChunkPipeline(const TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>& job);
+
+	/// <summary>
+	/// The upload stage of a pipelined chunk remesh, which applies the mesh unless the job has been superseded
+	/// </summary>
+	void UploadPipelinedChunk(FTerrainMeshJob& job);
+
+	/// <summary>
+	/// The collision stage of a pipelined chunk remesh
+	/// </summary>
+	void RebuildPipelinedChunkCollision(const FTerrainMeshJob& job);
+
+	/// <summary>
+	/// Step the time sliced mesh jobs until the meshing budget for this tick is used up
+	/// </summary>
+	void StepTimeSlicedMeshJobs();
+
+	/// <summary>
+	/// Apply the result of every mesh job that has finished
+	/// </summary>
+	void ApplyCompletedMeshJobs();
+
+	/// <summary>
+	/// Get how many more chunk results may be handed to their components this frame, by either ApplyCompletedMeshJobs or a pipelined upload
+	/// </summary>
+	int32 GetRemainingChunkResultsThisFrame();
+
+	/// <summary>
+	/// Remesh whatever has changed since the last remesh, without recording the request. Deferred until the root mesh job finishes if one is running
+	/// </summary>
+	void RemeshTerrain();
+
+	/// <summary>
+	/// Hand the mesh generated by a finished job to the component it was generated for
+	/// </summary>
+	void ApplyMeshJob(FTerrainMeshJob& job);
+
+	/// <summary>
+	/// Cancel every mesh job still running and forget about them
+	/// </summary>
+	void CancelMeshJobs();
+
+	/// <summary>
+	/// Re-extract only the cells touching a box of modified grid points and splice them into the existing mesh
+	/// </summary>
+	/// <param name="pointRegion">The grid points that have been modified since the last remesh</param>
+	void RemeshRegion(const FGridRegion& pointRegion);
+
+	/// <summary>
+	/// Splice the newly generated triangles of a box of cells into the mesh of the root component
+	/// </summary>
+	/// <param name="regionMesh">The newly generated triangles for the cells in the region</param>
+	/// <param name="cellRegion">The cells that have been regenerated</param>
+	void ApplyCellRegionMesh(const UE::Geometry::FDynamicMesh3& regionMesh, const FGridRegion& cellRegion);
+
+	/// <summary>
+	/// Remove every triangle generated by a cell inside the region from the mesh and append the triangles of the replacement mesh
+	/// </summary>
+	/// <param name="mesh">The mesh currently displayed</param>
+	/// <param name="regionMesh">The newly generated triangles for the cells in the region</param>
+	/// <param name="cellRegion">The cells that have been regenerated</param>
+	void ReplaceCellTriangles(UE::Geometry::FDynamicMesh3& mesh, const UE::Geometry::FDynamicMesh3& regionMesh, const FGridRegion& cellRegion);
+
+	/// <summary>
+	/// Index every triangle of a mesh about to be displayed by the cell that generated it, or clear the index if its triangles are not grouped by cell
+	/// </summary>
+	void RebuildCellTriangleIndex(const UE::Geometry::FDynamicMesh3& mesh, bool bHasCellGroups);
+
+	/// <summary>
+	/// Remove every cell of a region from the cell triangle index
+	/// </summary>
+	/// <param name="cellRegion">The cells to remove</param>
+	/// <param name="visitTriangle">Called with each triangle that was indexed under one of the cells</param>
+	void RemoveCellsFromTriangleIndex(const FGridRegion& cellRegion, TFunctionRef<void(int32)> visitTriangle);
+
+	/// <summary>
+	/// Lay the render sections out over the current grid with the current settings
+	/// </summary>
+	void ConfigureRenderSections();
+
+	/// <summary>
+	/// Stop drawing the root mesh in render sections, for when it is replaced by a mesh they cannot describe
+	/// </summary>
+	void ResetRenderSections();
+
+	/// <summary>
+	/// Apply the collision settings of the actor to a mesh component
+	/// </summary>
+	void ConfigureCollision(UDynamicMeshComponent* component) const;
+
+	/// <summary>
+	/// Get the number of chunks along each axis needed to cover every grid cell
+	/// </summary>
+	FIntVector3 GetChunkCount() const;
+
+	/// <summary>
+	/// Get the chunks containing any cell with one of the given grid points as a corner
+	/// </summary>
+	/// <param name="pointRegion">The grid points to be covered</param>
+	/// <returns>An inclusive box of chunk coordinates</returns>
+	FGridRegion GetChunksTouchingPoints(const FGridRegion& pointRegion) const;
+
+	/// <summary>
+	/// Remesh the most urgent chunks waiting in the scheduler, up to the number that may be started each tick
+	/// </summary>
+	void StartScheduledChunkRemeshes();
+
+	/// <summary>
+	/// Get where the terrain is being looked at from and which chunks the player pawns are standing on
+	/// </summary>
+	FTerrainChunkView GetChunkView() const;
+
+	/// <summary>
+	/// Get the box covered by a chunk in the local space of the terrain
+	/// </summary>
+	/// <param name="chunkCoords">The coordinates of the chunk, in chunks</param>
+	FBox GetChunkBounds(const FIntVector& chunkCoords) const;
+
+	/// <summary>
+	/// Regenerate the mesh of a single chunk, creating its component if it has gained a surface and destroying it if it has lost one
+	/// </summary>
+	/// <param name="chunkCoords">The coordinates of the chunk, in chunks</param>
+	void RemeshChunk(const FIntVector& chunkCoords);
+
+	/// <summary>
+	/// Hand a newly generated mesh to the component of a chunk, creating the component if needed and destroying it if the mesh is empty
+	/// </summary>
+	/// <param name="chunkCoords">The coordinates of the chunk, in chunks</param>
+	/// <param name="chunkMesh">The mesh of the chunk, in chunk-local space, which is swapped for the mesh the chunk displayed before</param>
+	void ApplyChunkMesh(const FIntVector& chunkCoords, UE::Geometry::FDynamicMesh3& chunkMesh);
+
+	/// <summary>
+	/// Create and register the mesh component for a chunk
+	/// </summary>
+	/// <param name="chunkCoords">The coordinates of the chunk, in chunks</param>
+	UDynamicMeshComponent* CreateChunkComponent(const FIntVector& chunkCoords);
+
+	/// <summary>
+	/// Destroy the mesh component of a chunk, if it has one
+	/// </summary>
+	/// <param name="chunkCoords">The coordinates of the chunk, in chunks</param>
+	void DestroyChunkComponent(const FIntVector& chunkCoords);
+
+	// The scalar field when using dense storage
 	TArray3D<float> dataGrid;
 
-	// Retain the objects to ensure object lifetime is long enough for the async compute shaders
+	// The scalar field when using narrow band storage
+	TNarrowBandArray3D<float> narrowBandGrid;
+
+	// The scalar field when using implicit storage
+	FImplicitTerrainField implicitField;
+
+	// The grid points modified since the mesh was last generated
+	FGridRegion dirtyRegion;
+
+	// Whether every triangle of the current mesh is grouped by the cell that generated it, which incremental remeshing relies upon
+	bool bMeshHasCellGroups = false;
+
+	// The isovalue the current mesh was generated with
+	float meshedIsovalue = 0;
+
+	// The triangles of the root mesh generated by each cell, by the linear index of the cell. Only kept while bMeshHasCellGroups is set
+	TMultiMap<int32, int32> cellTriangles;
+
+	// The render sections of the root mesh, when bPartialRenderUpdates is set
+	FTerrainRenderSections renderSections;
+
+	// The triangles changed by the last patch of the render sections. Kept between remeshes so it never reallocates
+	TArray<int32> changedRenderTriangles;
+
+	// Whether every chunk has been meshed since the terrain was initialised
+	bool bChunksGenerated = false;
+
+	// Brushes pushed from any thread, waiting to be moved into editQueue on the game thread
+	TBoundedMpscQueue<FTerrainBrush> incomingEdits;
+
+	// Edits waiting to be applied on the next tick
+	FTerrainEditQueue editQueue;
+
+	// Whether a remesh has been requested for the next tick
+	bool bRemeshRequested = false;
+
+	// The history of edit batches for undo and redo
+	FTerrainEditJournal editJournal;
+
+	// The bricks around recent edits waiting to be redistanced
+	FTerrainRedistancer redistancer;
+
+	// The grid points modified by the edit batch being recorded
+	FGridRegion journalBatchRegion;
+
+	// The time spent on each stage of terrain updates since the timings were last reset
+	FTerrainFrameTimings frameTimings;
+
+	// The recording being made
+	FTerrainEditRecording recording;
+
+	// The recording being replayed, kept apart so that loading a replay never touches a recording in progress
+	FTerrainEditRecording replayRecording;
+
+	bool bRecordingEdits = false;
+
+	// The frame the recording in progress started on
+	uint64 recordingStartFrame = 0;
+
+	bool bReplaying = false;
+
+	// The name of the recording being replayed
+	FString replayName;
+
+	// The next event of the recording to replay
+	int32 replayEventIndex = 0;
+
+	// The frame of the recording being replayed
+	uint32 replayFrame = 0;
+
+	// The timings of every frame replayed so far
+	TArray<FTerrainFrameTimings> replayTimings;
+
+	// The job generating the mesh of the root component, if one is running
+	TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe> meshJob;
+
+	// Whether a remesh was requested while meshJob was running, to be made once its result has been applied
+	bool bRemeshAfterMeshJob = false;
+
+	// The time spent in each stage of pipelined chunk remeshes since the timings were last logged
+	FTerrainPipelineTimings pipelineTimings;
+
+	// The chunks waiting for a remesh to be started
+	FTerrainChunkScheduler chunkScheduler;
+
+	// The jobs generating the meshes of chunks, by chunk coordinates
+	TMap<FIntVector, TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>> chunkMeshJobs;
+
+	// The chunks whose remesh was requested while their job was running, to be queued again once its result has been applied
+	TSet<FIntVector> chunksToRemeshAfterJob;
+
+	// The frame chunkResultsAppliedThisFrame is counting for
+	uint64 chunkResultsFrame = 0;
+
+	// The chunk results handed to their components so far in chunkResultsFrame
+	int32 chunkResultsAppliedThisFrame = 0;
+
+	// When each chunk was last remeshed, for telling which chunks are being edited
+	TMap<FIntVector, double> chunkRemeshTimes;
+
+	// The chunks whose latest mesh skipped the vertex cache optimization because they were being edited
+	TSet<FIntVector> unoptimizedChunks;
+
+	// The jobs queued for a worker thread, oldest first. A superseded job is cancelled where it is, and skipped when its turn comes
+	TArray<TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>> waitingMeshJobs;
+
+	// The jobs launched on worker threads that had not completed when last checked
+	TArray<TSharedPtr<FTerrainMeshJob, ESPMode::ThreadSafe>> runningMeshJobs;
+
+	// Retain the objects to ensure object lifetime is long enough for the async compute shaders, and so that their storage is reused by the next remesh
 	std::unique_ptr<ISurfaceGenerationAlgorithm> marchingCubesGenerator;
 	std::unique_ptr<ISurfaceGenerationAlgorithm> marchingTetrahedraGenerator;
+
+	// The generators lent to mesh jobs, one pool per algorithm. Shared with the jobs, as a cancelled job may give its generator back after the actor has gone
+	TSharedPtr<FTerrainGeneratorPool, ESPMode::ThreadSafe> marchingCubesGeneratorPool;
+	TSharedPtr<FTerrainGeneratorPool, ESPMode::ThreadSafe> marchingTetrahedraGeneratorPool;
+
+	// The back buffers of the root component and chunks. Each is a mesh that was swapped out of a component, waiting to be written over by the next mesh job
+	TArray<UE::Geometry::FDynamicMesh3> retiredMeshes;
 };
@@ -6,3 +6,131 @@
 ISurfaceGenerationAlgorithm::~ISurfaceGenerationAlgorithm()
 {
 }
+
+int32 ISurfaceGenerationAlgorithm::GetCellGroupID(int32 i, int32 j, int32 k) const
+{
+	int32 cellCountX = globalCellCount.X > 0 ? globalCellCount.X : dataGrid.GetSize(0) - 1;
+	int32 cellCountY = globalCellCount.Y > 0 ? globalCellCount.Y : dataGrid.GetSize(1) - 1;
+	return (gridIndexOffset.X + i) + cellCountX * ((gridIndexOffset.Y + j) + cellCountY * (gridIndexOffset.Z + k));
+}
+
+UE::Geometry::FDynamicMesh3& ISurfaceGenerationAlgorithm::GenerateOnCPU()
+{
+	BeginCPUGeneration();
+	ContinueCPUGeneration(TNumericLimits<double>::Max());
+	return generatedMesh;
+}
+
+void ISurfaceGenerationAlgorithm::BeginCPUGeneration()
+{
+	recycledTriangleIDs.Reset();
+	nextRecycledTriangle = 0;
+	nextRowIndex = 0;
+
+	// Only a soup with nothing but triangle groups can be overwritten, as moving a vertex that is shared between triangles would distort its neighbours
+	bool bCanOverwrite = GeneratesTriangleSoup() && generatedMesh.HasTriangleGroups() && !generatedMesh.HasAttributes()
+		&& generatedMesh.VertexCount() == 3 * generatedMesh.TriangleCount();
+	if (bCanOverwrite)
+	{
+		for (int32 tid : generatedMesh.TriangleIndicesItr())
+		{
+			// Every vertex of a soup is joined to exactly the two other corners of its triangle
+			UE::Geometry::FIndex3i triangle = generatedMesh.GetTriangle(tid);
+			if (generatedMesh.GetVtxEdgeCount(triangle.A) != 2 || generatedMesh.GetVtxEdgeCount(triangle.B) != 2 || generatedMesh.GetVtxEdgeCount(triangle.C) != 2)
+			{
+				bCanOverwrite = false;
+				break;
+			}
+			recycledTriangleIDs.Add(tid);
+		}
+	}
+
+	if (!bCanOverwrite)
+	{
+		recycledTriangleIDs.Reset();
+		generatedMesh.Clear();
+		generatedMesh.EnableTriangleGroups();
+	}
+}
+
+bool ISurfaceGenerationAlgorithm::ContinueCPUGeneration(double budgetSeconds)
+{
+	int32 cellCountY = dataGrid.GetSize(1) - 1;
+	int32 cellCountZ = dataGrid.GetSize(2) - 1;
+	int32 rowCount = (dataGrid.GetSize(0) > 1 && cellCountY > 0 && cellCountZ > 0) ? cellCountY * cellCountZ : 0;
+
+	double startTime = FPlatformTime::Seconds();
+	while (nextRowIndex < rowCount)
+	{
+		if (IsCancelled())
+		{
+			return true;
+		}
+
+		GenerateCellRow(nextRowIndex % cellCountY, nextRowIndex / cellCountY);
+		nextRowIndex++;
+
+		if (FPlatformTime::Seconds() - startTime >= budgetSeconds)
+		{
+			break;
+		}
+	}
+
+	if (nextRowIndex < rowCount)
+	{
+		return false;
+	}
+	RemoveUnusedRecycledTriangles();
+	return true;
+}
+
+bool ISurfaceGenerationAlgorithm::RecycleMesh(UE::Geometry::FDynamicMesh3& retiredMesh)
+{
+	if (generatedMesh.MaxVertexID() > 0 || generatedMesh.MaxTriangleID() > 0)
+	{
+		return false;
+	}
+
+	// Moved rather than swapped bitwise, so that any attribute set is reparented to the mesh that now holds it
+	UE::Geometry::FDynamicMesh3 emptyMesh = MoveTemp(generatedMesh);
+	generatedMesh = MoveTemp(retiredMesh);
+	retiredMesh = MoveTemp(emptyMesh);
+
+	// Normals decoded from a quantized mesh would go stale as new positions are written over the old ones
+	if (generatedMesh.HasVertexNormals())
+	{
+		generatedMesh.DiscardVertexNormals();
+	}
+	return true;
+}
+
+int32 ISurfaceGenerationAlgorithm::AppendSoupTriangle(const FVector3d& vertex1, const FVector3d& vertex2, const FVector3d& vertex3, int32 groupID)
+{
+	if (nextRecycledTriangle < recycledTriangleIDs.Num())
+	{
+		// The triangle keeps its vertices and edges, so only the positions and group need writing
+		int32 tid = recycledTriangleIDs[nextRecycledTriangle++];
+		UE::Geometry::FIndex3i triangle = generatedMesh.GetTriangle(tid);
+		generatedMesh.SetVertex(triangle.A, vertex1);
+		generatedMesh.SetVertex(triangle.B, vertex2);
+		generatedMesh.SetVertex(triangle.C, vertex3);
+		generatedMesh.SetTriangleGroup(tid, groupID);
+		return tid;
+	}
+
+	int32 vert1 = generatedMesh.AppendVertex(vertex1);
+	int32 vert2 = generatedMesh.AppendVertex(vertex2);
+	int32 vert3 = generatedMesh.AppendVertex(vertex3);
+	return generatedMesh.AppendTriangle(UE::Geometry::FIndex3i(vert1, vert2, vert3), groupID);
+}
+
+void ISurfaceGenerationAlgorithm::RemoveUnusedRecycledTriangles()
+{
+	// The new mesh was smaller than the one it was written over
+	for (int32 i = nextRecycledTriangle; i < recycledTriangleIDs.Num(); i++)
+	{
+		generatedMesh.RemoveTriangle(recycledTriangleIDs[i], true, false);
+	}
+	recycledTriangleIDs.Reset();
+	nextRecycledTriangle = 0;
+}
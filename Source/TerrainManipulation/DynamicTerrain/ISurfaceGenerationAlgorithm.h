@@ -6,6 +6,7 @@
 #include "TerrainManipulation/DataStructs/TArray3D.h"
 #include "DynamicMesh/DynamicMesh3.h"
 #include "Components/DynamicMeshComponent.h"
+#include <atomic>
 
 /**
  * 
@@ -24,7 +25,30 @@ public:
 	/// <summary>
 	/// Generate the mesh with linear computation on the CPU
 	/// </summary>
-	virtual UE::Geometry::FDynamicMesh3 GenerateOnCPU() = 0;
+	/// <returns>The generatedMesh, which the caller may read in place or move out of. It is overwritten by the next generation</returns>
+	virtual UE::Geometry::FDynamicMesh3& GenerateOnCPU();
+
+	/// <summary>
+	/// Start generating the mesh on the CPU one row of cells at a time, discarding any partially generated mesh.
+	/// If the generatedMesh is a triangle soup and this generator only appends triangle soups, its triangles are overwritten in place rather than freed
+	/// </summary>
+	void BeginCPUGeneration();
+
+	/// <summary>
+	/// Generate rows of cells until the time budget is used up, carrying on from wherever the previous call stopped.
+	/// At least one row is generated on every call, so the mesh always makes progress
+	/// </summary>
+	/// <param name="budgetSeconds">The time after which no further rows are started</param>
+	/// <returns>True once every row has been generated or the generation has been cancelled, after which generatedMesh holds the result</returns>
+	bool ContinueCPUGeneration(double budgetSeconds);
+
+	/// <summary>
+	/// Hand the generator a mesh that is no longer displayed, to be written over by the next generation instead of allocating a new mesh.
+	/// Only taken if the generator's own mesh has no storage, which is the case once a finished mesh has been moved out of it
+	/// </summary>
+	/// <param name="retiredMesh">The mesh to reuse, swapped with the empty generatedMesh if it is taken</param>
+	/// <returns>True if the mesh was taken</returns>
+	bool RecycleMesh(UE::Geometry::FDynamicMesh3& retiredMesh);
 
 	// The 3D array of data that informs the shape of the isosurface
 	TArray3D<float> dataGrid;
@@ -38,6 +62,72 @@ public:
 	// The position of the (0,0,0) vertex in relation to the UDynamicMeshComponent
 	FVector3f zeroCellOffset;
 
+	// The grid indices of the (0,0,0) vertex within the whole terrain, when only a window of the terrain is being meshed
+	FIntVector3 gridIndexOffset = FIntVector3(0, 0, 0);
+
+	// The number of cells along each axis of the whole terrain. Left as zero when the dataGrid is the whole terrain
+	FIntVector3 globalCellCount = FIntVector3(0, 0, 0);
+
+	/// <summary>
+	/// Get the triangle group ID given to every triangle generated by a cell, which uniquely identifies the cell within the whole terrain
+	/// </summary>
+	/// <param name="i">Cell index along X within the dataGrid</param>
+	/// <param name="j">Cell index along Y within the dataGrid</param>
+	/// <param name="k">Cell index along Z within the dataGrid</param>
+	/// <returns>The linear index of the cell within the whole terrain</returns>
+	int32 GetCellGroupID(int32 i, int32 j, int32 k) const;
+
+	// Set from another thread to abandon a CPU generation part way through. It is checked between rows of cells, and is owned by whoever runs the generator
+	const std::atomic<bool>* cancelFlag = nullptr;
+
+	/// <summary>
+	/// Check whether the generation in progress has been abandoned, in which case the partial mesh should be returned as soon as possible
+	/// </summary>
+	bool IsCancelled() const
+	{
+		return cancelFlag != nullptr && cancelFlag->load(std::memory_order_relaxed);
+	}
+
 	// The mesh that shall be returned after the algorithm is complete
 	UE::Geometry::FDynamicMesh3 generatedMesh = UE::Geometry::FDynamicMesh3::FDynamicMesh3();
+
+protected:
+	/// <summary>
+	/// Append the triangles of every cell in a row along X to the generatedMesh
+	/// </summary>
+	/// <param name="j">Cell index along Y within the dataGrid</param>
+	/// <param name="k">Cell index along Z within the dataGrid</param>
+	virtual void GenerateCellRow(int32 j, int32 k) = 0;
+
+	/// <summary>
+	/// Whether every triangle the generator appends has three vertices of its own, which lets a recycled mesh built the same way be overwritten in place
+	/// </summary>
+	virtual bool GeneratesTriangleSoup() const
+	{
+		return false;
+	}
+
+	/// <summary>
+	/// Add a triangle with three vertices of its own to the generatedMesh, overwriting a triangle of the recycled mesh while any are left
+	/// </summary>
+	/// <param name="vertex1">The position of the first corner</param>
+	/// <param name="vertex2">The position of the second corner</param>
+	/// <param name="vertex3">The position of the third corner</param>
+	/// <param name="groupID">The triangle group of the new triangle</param>
+	/// <returns>The ID of the triangle</returns>
+	int32 AppendSoupTriangle(const FVector3d& vertex1, const FVector3d& vertex2, const FVector3d& vertex3, int32 groupID);
+
+	/// <summary>
+	/// Remove the triangles of the recycled mesh that the latest generation did not overwrite
+	/// </summary>
+	void RemoveUnusedRecycledTriangles();
+
+	// The index of the next row of cells to generate, counting along Y and then Z
+	int32 nextRowIndex = 0;
+
+	// The triangles of the generatedMesh left from the previous generation, in the order they are overwritten. Kept between runs so it never reallocates
+	TArray<int32> recycledTriangleIDs;
+
+	// The index within recycledTriangleIDs of the next triangle to overwrite
+	int32 nextRecycledTriangle = 0;
 };
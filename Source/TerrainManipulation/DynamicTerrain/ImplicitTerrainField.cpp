@@ -0,0 +1,237 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ImplicitTerrainField.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/ScopeRWLock.h"
+
+void FImplicitTerrainField::Initialise(FIntVector3 gridPointCount, FVector3f gridCellDimensions, TFunction<float(int32, int32, int32)> baseFieldFunction, int32 maxCachedBrickCount)
+{
+	FWriteScopeLock editsWriteLock(editsLock);
+	FScopeLock lock(&cacheLock);
+	size = gridPointCount;
+	cellDimensions = gridCellDimensions;
+	baseField = MoveTemp(baseFieldFunction);
+	maxCachedBricks = FMath::Max(maxCachedBrickCount, 1);
+	edits.Reset();
+	buckets.Reset();
+	largeEdits.Reset();
+	brickCache.Reset();
+	useCounter = 0;
+}
+
+FGridRegion FImplicitTerrainField::AddEdit(const FTerrainBrush& localBrush)
+{
+	// Held until the overlapped bricks are discarded, so no brick evaluated without this edit can be cached after it
+	FWriteScopeLock editsWriteLock(editsLock);
+
+	FGridRegion bounds = localBrush.GetAffectedPoints(cellDimensions, FIntVector3(0, 0, 0), size - FIntVector3(1, 1, 1));
+	if (bounds.IsEmpty())
+	{
+		return FGridRegion();
+	}
+
+	int32 editIndex = edits.Add({ localBrush, bounds });
+
+	// Indices are appended in the order the edits are made, so every list stays sorted without any extra work
+	constexpr int32 bucketPointCount = BrickSize * BucketBrickCount;
+	FGridRegion bucketRegion(bounds.minIndex / bucketPointCount, bounds.maxIndex / bucketPointCount);
+	if (bucketRegion.Num() > MaxBucketsPerEdit)
+	{
+		largeEdits.Add(editIndex);
+	}
+	else
+	{
+		for (int32 z = bucketRegion.minIndex.Z; z <= bucketRegion.maxIndex.Z; z++)
+		{
+			for (int32 y = bucketRegion.minIndex.Y; y <= bucketRegion.maxIndex.Y; y++)
+			{
+				for (int32 x = bucketRegion.minIndex.X; x <= bucketRegion.maxIndex.X; x++)
+				{
+					buckets.FindOrAdd(FIntVector3(x, y, z)).Add(editIndex);
+				}
+			}
+		}
+	}
+
+	InvalidateBricks(bounds);
+	return bounds;
+}
+
+float FImplicitTerrainField::GetElement(int32 x, int32 y, int32 z) const
+{
+	float value = 0;
+	ReadBrick(FIntVector3(x, y, z) / BrickSize, [&](const TArray3D<float>& brick, const FGridRegion& brickRegion)
+		{
+			value = brick.GetElement(x - brickRegion.minIndex.X, y - brickRegion.minIndex.Y, z - brickRegion.minIndex.Z);
+		});
+	return value;
+}
+
+void FImplicitTerrainField::CopyRegionTo(TArray3D<float>& out, FIntVector3 regionMin) const
+{
+	FGridRegion region(regionMin, regionMin + FIntVector3(out.GetSize(0) - 1, out.GetSize(1) - 1, out.GetSize(2) - 1));
+	region = region.Clamped(FIntVector3(0, 0, 0), size - FIntVector3(1, 1, 1));
+	if (region.IsEmpty())
+	{
+		return;
+	}
+
+	FIntVector3 brickMin = region.minIndex / BrickSize;
+	FIntVector3 brickMax = region.maxIndex / BrickSize;
+	for (int32 k = brickMin.Z; k <= brickMax.Z; k++)
+	{
+		for (int32 j = brickMin.Y; j <= brickMax.Y; j++)
+		{
+			for (int32 i = brickMin.X; i <= brickMax.X; i++)
+			{
+				ReadBrick(FIntVector3(i, j, k), [&](const TArray3D<float>& brick, const FGridRegion& brickRegion)
+					{
+						// Copy the rows of the part of the brick inside the region
+						FGridRegion overlap = brickRegion.Clamped(region.minIndex, region.maxIndex);
+						int32 rowLength = overlap.GetSize().X;
+						for (int32 z = overlap.minIndex.Z; z <= overlap.maxIndex.Z; z++)
+						{
+							for (int32 y = overlap.minIndex.Y; y <= overlap.maxIndex.Y; y++)
+							{
+								const float* sourceRow = brick.GetRowData(y - brickRegion.minIndex.Y, z - brickRegion.minIndex.Z) + (overlap.minIndex.X - brickRegion.minIndex.X);
+								float* destinationRow = out.GetRowData(y - regionMin.Y, z - regionMin.Z) + (overlap.minIndex.X - regionMin.X);
+								FMemory::Memcpy(destinationRow, sourceRow, rowLength * sizeof(float));
+							}
+						}
+					});
+			}
+		}
+	}
+	out.MarkRegionModified(region.minIndex - regionMin, region.maxIndex - regionMin);
+}
+
+FGridRegion FImplicitTerrainField::GetBrickRegion(FIntVector3 brickCoords) const
+{
+	FIntVector3 brickMin = brickCoords * BrickSize;
+	return FGridRegion(brickMin, brickMin + FIntVector3(BrickSize - 1)).Clamped(FIntVector3(0, 0, 0), size - FIntVector3(1, 1, 1));
+}
+
+void FImplicitTerrainField::ReadBrick(FIntVector3 brickCoords, TFunctionRef<void(const TArray3D<float>&, const FGridRegion&)> readFunction) const
+{
+	{
+		FScopeLock lock(&cacheLock);
+		if (FCachedBrick* cachedBrick = brickCache.Find(brickCoords))
+		{
+			// The reference is only valid until the cache next changes, which cannot happen while the lock is held
+			cachedBrick->lastUsed = ++useCounter;
+			readFunction(cachedBrick->values, GetBrickRegion(brickCoords));
+			return;
+		}
+	}
+
+	// The brick is evaluated with the cache unlocked, so other threads keep reading cached bricks in the meantime.
+	// Holding the edits for reading lets other misses evaluate alongside this one, while keeping out edits until the brick is cached
+	FReadScopeLock editsReadLock(editsLock);
+	TArray3D<float> values;
+	EvaluateBrick(brickCoords, values);
+
+	FScopeLock lock(&cacheLock);
+	FCachedBrick* cachedBrick = brickCache.Find(brickCoords);
+	if (cachedBrick == nullptr)
+	{
+		if (brickCache.Num() >= maxCachedBricks)
+		{
+			EvictBricks();
+		}
+		cachedBrick = &brickCache.Add(brickCoords);
+		cachedBrick->values = MoveTemp(values);
+	}
+
+	// Another thread may have cached the same brick while this one was evaluating it, in which case the two are identical and the first is kept
+	cachedBrick->lastUsed = ++useCounter;
+	readFunction(cachedBrick->values, GetBrickRegion(brickCoords));
+}
+
+void FImplicitTerrainField::EvaluateBrick(FIntVector3 brickCoords, TArray3D<float>& outValues) const
+{
+	FGridRegion brickRegion = GetBrickRegion(brickCoords);
+	FIntVector3 brickSize = brickRegion.GetSize();
+	outValues = TArray3D<float>(brickSize.X, brickSize.Y, brickSize.Z);
+	for (int32 z = 0; z < brickSize.Z; z++)
+	{
+		for (int32 y = 0; y < brickSize.Y; y++)
+		{
+			float* row = outValues.GetRowData(y, z);
+			for (int32 x = 0; x < brickSize.X; x++)
+			{
+				row[x] = baseField(brickRegion.minIndex.X + x, brickRegion.minIndex.Y + y, brickRegion.minIndex.Z + z);
+			}
+		}
+	}
+
+	// Edits do not commute, so the bucket's edits and the large edits are merged back into the order they were made
+	static const TArray<int32> noEdits;
+	const TArray<int32>* bucketEdits = buckets.Find(brickCoords / BucketBrickCount);
+	const TArray<int32>& smallEdits = bucketEdits ? *bucketEdits : noEdits;
+	int32 smallCursor = 0, largeCursor = 0;
+	while (smallCursor < smallEdits.Num() || largeCursor < largeEdits.Num())
+	{
+		bool bTakeSmall = largeCursor >= largeEdits.Num() || (smallCursor < smallEdits.Num() && smallEdits[smallCursor] < largeEdits[largeCursor]);
+		const FImplicitEdit& edit = edits[bTakeSmall ? smallEdits[smallCursor++] : largeEdits[largeCursor++]];
+
+		// A bucket holds every edit touching any of its bricks, so each edit is still tested against this brick.
+		// The brick is far below the parallel threshold, so it is applied on the calling thread
+		if (edit.bounds.Intersects(brickRegion))
+		{
+			edit.brush.ApplyToGrid(outValues, brickRegion.minIndex, cellDimensions);
+		}
+	}
+}
+
+void FImplicitTerrainField::InvalidateBricks(const FGridRegion& pointRegion)
+{
+	FScopeLock lock(&cacheLock);
+
+	// Whichever of the bricks in the region or the bricks in the cache is the smaller set is walked, so a huge edit costs no more than the cache size
+	FGridRegion brickRegion(pointRegion.minIndex / BrickSize, pointRegion.maxIndex / BrickSize);
+	if (brickRegion.Num() <= brickCache.Num())
+	{
+		for (int32 z = brickRegion.minIndex.Z; z <= brickRegion.maxIndex.Z; z++)
+		{
+			for (int32 y = brickRegion.minIndex.Y; y <= brickRegion.maxIndex.Y; y++)
+			{
+				for (int32 x = brickRegion.minIndex.X; x <= brickRegion.maxIndex.X; x++)
+				{
+					brickCache.Remove(FIntVector3(x, y, z));
+				}
+			}
+		}
+	}
+	else
+	{
+		for (auto iterator = brickCache.CreateIterator(); iterator; ++iterator)
+		{
+			if (brickRegion.Contains(iterator.Key()))
+			{
+				iterator.RemoveCurrent();
+			}
+		}
+	}
+}
+
+void FImplicitTerrainField::EvictBricks() const
+{
+	// Evicting a quarter at a time spreads the cost of finding the oldest bricks across many insertions
+	TArray<uint64> lastUsedCounts;
+	lastUsedCounts.Reserve(brickCache.Num());
+	for (const TPair<FIntVector3, FCachedBrick>& cachedBrick : brickCache)
+	{
+		lastUsedCounts.Add(cachedBrick.Value.lastUsed);
+	}
+	lastUsedCounts.Sort();
+	uint64 evictBefore = lastUsedCounts[lastUsedCounts.Num() / 4];
+
+	for (auto iterator = brickCache.CreateIterator(); iterator; ++iterator)
+	{
+		if (iterator.Value().lastUsed <= evictBefore)
+		{
+			iterator.RemoveCurrent();
+		}
+	}
+}
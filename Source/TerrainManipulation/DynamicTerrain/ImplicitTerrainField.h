@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "TerrainManipulation/DataStructs/TArray3D.h"
+#include "TerrainManipulation/DataStructs/GridRegion.h"
+#include "Brushes/TerrainBrush.h"
+
+/**
+ * A scalar field described by a procedural base field and an ordered list of brush edits, rather than by stored values.
+ * Values are only evaluated for the bricks that are read, and each evaluated brick is cached until an edit overlaps it.
+ * Recording an edit costs the same however large it is, and memory is bounded by the cache rather than the size of the world.
+ * Reads may come from any thread. Edits are guarded by a read/write lock that evaluations share, and the cache by a lock of its own
+ * that is never held while a brick is evaluated, so one miss does not hold up reads of other bricks
+ */
+class TERRAINMANIPULATION_API FImplicitTerrainField
+{
+public:
+	// The number of grid points along each axis of a cached brick
+	static constexpr int32 BrickSize = 8;
+
+	// The number of bricks along each axis of a bucket of the edit index
+	static constexpr int32 BucketBrickCount = 4;
+
+	// Edits spanning more buckets than this are kept in a single list checked by every brick, so that large edits stay cheap to record
+	static constexpr int32 MaxBucketsPerEdit = 64;
+
+	/// <summary>
+	/// Discard every edit and cached brick and start again from a base field
+	/// </summary>
+	/// <param name="gridPointCount">The number of grid points along each axis</param>
+	/// <param name="gridCellDimensions">The size of a single grid cell in local coordinates</param>
+	/// <param name="baseField">Gives the value of the field at a grid point before any edits. It may be called from any thread</param>
+	/// <param name="maxCachedBricks">The number of evaluated bricks kept before the least recently used are discarded</param>
+	void Initialise(FIntVector3 gridPointCount, FVector3f gridCellDimensions, TFunction<float(int32, int32, int32)> baseField, int32 maxCachedBricks);
+
+	/// <summary>
+	/// Record an edit on top of every previous edit. Only the cached bricks it overlaps are discarded, and nothing is evaluated
+	/// </summary>
+	/// <param name="localBrush">The brush to apply, with its centre local to the terrain. The smooth and flatten modes are not supported</param>
+	/// <returns>The grid points that may have been modified</returns>
+	FGridRegion AddEdit(const FTerrainBrush& localBrush);
+
+	/// <summary>
+	/// Get the value of a grid point, evaluating its brick if it is not cached
+	/// </summary>
+	float GetElement(int32 x, int32 y, int32 z) const;
+
+	/// <summary>
+	/// Copy a box of the field into a dense array, evaluating any bricks that are not cached
+	/// </summary>
+	/// <param name="out">The array to fill, whose size determines the size of the box</param>
+	/// <param name="regionMin">The grid point that maps onto (0,0,0) of the dense array</param>
+	void CopyRegionTo(TArray3D<float>& out, FIntVector3 regionMin) const;
+
+	int32 GetEditCount() const
+	{
+		return edits.Num();
+	}
+
+private:
+	struct FImplicitEdit
+	{
+		FTerrainBrush brush;
+
+		// The grid points inside the bounding box of the brush
+		FGridRegion bounds;
+	};
+
+	struct FCachedBrick
+	{
+		TArray3D<float> values;
+
+		// The value of useCounter when the brick was last read
+		uint64 lastUsed = 0;
+	};
+
+	/// <summary>
+	/// Get the grid points covered by a brick, which is smaller than BrickSize along an axis at the far edge of the grid
+	/// </summary>
+	FGridRegion GetBrickRegion(FIntVector3 brickCoords) const;
+
+	/// <summary>
+	/// Call a function with the values of a brick while the cache is locked, evaluating the brick first if it is not cached.
+	/// The evaluation itself runs with only the edits locked for reading
+	/// </summary>
+	void ReadBrick(FIntVector3 brickCoords, TFunctionRef<void(const TArray3D<float>&, const FGridRegion&)> readFunction) const;
+
+	/// <summary>
+	/// Evaluate the base field across a brick and then apply every edit overlapping it in the order they were made
+	/// </summary>
+	void EvaluateBrick(FIntVector3 brickCoords, TArray3D<float>& outValues) const;
+
+	/// <summary>
+	/// Discard the cached bricks that overlap a region
+	/// </summary>
+	void InvalidateBricks(const FGridRegion& pointRegion);
+
+	/// <summary>
+	/// Discard the least recently used quarter of the cache. The cache must be locked
+	/// </summary>
+	void EvictBricks() const;
+
+	// The number of grid points along each axis
+	FIntVector3 size = FIntVector3(0);
+
+	// The size of a single grid cell in local coordinates
+	FVector3f cellDimensions = FVector3f(1, 1, 1);
+
+	TFunction<float(int32, int32, int32)> baseField;
+
+	// Every edit, in the order they were made
+	TArray<FImplicitEdit> edits;
+
+	// The indices of the edits overlapping each bucket, in ascending order. Buckets no edit has touched are absent
+	TMap<FIntVector3, TArray<int32>> buckets;
+
+	// The indices of the edits too large to be added to each bucket they overlap, in ascending order
+	TArray<int32> largeEdits;
+
+	int32 maxCachedBricks = 4096;
+
+	// Guards the edits and their index. Written by AddEdit and Initialise, and read for as long as a brick is being evaluated and cached,
+	// so an edit cannot slip in between a brick being evaluated and it being cached. Always taken before cacheLock
+	mutable FRWLock editsLock;
+
+	// Bricks are evaluated on demand by const reads, so the cache is mutable and guarded by a lock
+	mutable TMap<FIntVector3, FCachedBrick> brickCache;
+	mutable uint64 useCounter = 0;
+	mutable FCriticalSection cacheLock;
+};
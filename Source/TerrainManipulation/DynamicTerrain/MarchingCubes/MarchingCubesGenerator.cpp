@@ -31,55 +31,59 @@ void MarchingCubesGenerator::GenerateOnGPU(UDynamicMeshComponent* dynamicMesh)
 		});
 }
 
-UE::Geometry::FDynamicMesh3 MarchingCubesGenerator::GenerateOnCPU()
+void MarchingCubesGenerator::GenerateCellRow(int32 j, int32 k)
 {
-	generatedMesh.Clear();	
-
 	int cellCountX = dataGrid.GetSize(0) - 1;
-	int cellCountY = dataGrid.GetSize(1) - 1;
-	int cellCountZ = dataGrid.GetSize(2) - 1;
 
-	// Iterate over all cells and set their triangles into their slot in the triangles array
-	for (int k = 0; k < cellCountZ; k++)
+	// The sign mask can only stand in for the cell values if it was built against the same isovalue
+	bool bUseSignMask = dataGrid.HasSignMask() && dataGrid.GetSignMaskThreshold() == isovalue;
+
+	// Iterate over the cells of the row and append their triangles to the mesh
+	for (int i = 0; i < cellCountX; i++)
 	{
-		for (int j = 0; j < cellCountY; j++)
+		if (bUseSignMask)
 		{
-			for (int i = 0; i < cellCountX; i++)
+			if (!dataGrid.GetSignMask().CanBlockContainSurface(i >> 2, j >> 2, k >> 2))
 			{
-				// Generate the GridCell struct
-				double sizeX = gridCellDimensions.X;
-				double sizeY = gridCellDimensions.Y;
-				double sizeZ = gridCellDimensions.Z;
-				TArray<FVector3f> cellPositions;
-				cellPositions.Init(zeroCellOffset + FVector3f(i * sizeX, j * sizeY, k * sizeZ), 8);
-				cellPositions[1] += FVector3f(sizeX, 0, 0);
-				cellPositions[2] += FVector3f(sizeX, sizeY, 0);
-				cellPositions[3] += FVector3f(0, sizeY, 0);
-				cellPositions[4] += FVector3f(0, 0, sizeZ);
-				cellPositions[5] += FVector3f(sizeX, 0, sizeZ);
-				cellPositions[6] += FVector3f(sizeX, sizeY, sizeZ);
-				cellPositions[7] += FVector3f(0, sizeY, sizeZ);
-
-				TArray<float> cellValues;
-				cellValues.Init(0, 8);
-				cellValues[0] = dataGrid.GetElement(i, j, k);
-				cellValues[1] = dataGrid.GetElement(i + 1, j, k);
-				cellValues[2] = dataGrid.GetElement(i + 1, j + 1, k);
-				cellValues[3] = dataGrid.GetElement(i, j + 1, k);
-				cellValues[4] = dataGrid.GetElement(i, j, k + 1);
-				cellValues[5] = dataGrid.GetElement(i + 1, j, k + 1);
-				cellValues[6] = dataGrid.GetElement(i + 1, j + 1, k + 1);
-				cellValues[7] = dataGrid.GetElement(i, j + 1, k + 1);
-
-				GridCell gridCell = GridCell(cellPositions, cellValues);
-
-				// Calculate the triangles required for this cube
-				TriangulateCell(gridCell);
+				// No cell in this 4x4x4 block is active, so jump to the last cell of the block along this row
+				i |= 3;
+				continue;
 			}
+
+			uint8 cubeIndex = dataGrid.GetSignMask().GetCellIndex(i, j, k);
+			if (cubeIndex == 0 || cubeIndex == 255) continue;
 		}
-	}
 
-	return generatedMesh;
+		// Fill in the scratch GridCell, which already holds 8 corners
+		double sizeX = gridCellDimensions.X;
+		double sizeY = gridCellDimensions.Y;
+		double sizeZ = gridCellDimensions.Z;
+		TArray<FVector3f>& cellPositions = scratchCell.positions;
+		FVector3f cellOrigin = zeroCellOffset + FVector3f(i * sizeX, j * sizeY, k * sizeZ);
+		cellPositions[0] = cellOrigin;
+		cellPositions[1] = cellOrigin + FVector3f(sizeX, 0, 0);
+		cellPositions[2] = cellOrigin + FVector3f(sizeX, sizeY, 0);
+		cellPositions[3] = cellOrigin + FVector3f(0, sizeY, 0);
+		cellPositions[4] = cellOrigin + FVector3f(0, 0, sizeZ);
+		cellPositions[5] = cellOrigin + FVector3f(sizeX, 0, sizeZ);
+		cellPositions[6] = cellOrigin + FVector3f(sizeX, sizeY, sizeZ);
+		cellPositions[7] = cellOrigin + FVector3f(0, sizeY, sizeZ);
+
+		TArray<float>& cellValues = scratchCell.values;
+		cellValues[0] = dataGrid.GetElement(i, j, k);
+		cellValues[1] = dataGrid.GetElement(i + 1, j, k);
+		cellValues[2] = dataGrid.GetElement(i + 1, j + 1, k);
+		cellValues[3] = dataGrid.GetElement(i, j + 1, k);
+		cellValues[4] = dataGrid.GetElement(i, j, k + 1);
+		cellValues[5] = dataGrid.GetElement(i + 1, j, k + 1);
+		cellValues[6] = dataGrid.GetElement(i + 1, j + 1, k + 1);
+		cellValues[7] = dataGrid.GetElement(i, j + 1, k + 1);
+
+		currentCellGroupID = GetCellGroupID(i, j, k);
+
+		// Calculate the triangles required for this cube
+		TriangulateCell(scratchCell);
+	}
 }
 
 int MarchingCubesGenerator::CalculateCubeIndex(const GridCell& gridCell)
@@ -92,11 +96,13 @@ int MarchingCubesGenerator::CalculateCubeIndex(const GridCell& gridCell)
 	return cubeIndex;
 }
 
-TArray<FVector3f> MarchingCubesGenerator::InterpolateVerticesOnEdges(const GridCell& gridCell)
+void MarchingCubesGenerator::InterpolateVerticesOnEdges(const GridCell& gridCell, TArray<FVector3f>& interpolatedVertices)
 {
 	int cubeIndex = CalculateCubeIndex(gridCell);
-	TArray<FVector3f> interpolatedVertices;
-	interpolatedVertices.Init(FVector3f::ZeroVector, 12);
+	if (interpolatedVertices.Num() != 12)
+	{
+		interpolatedVertices.Init(FVector3f::ZeroVector, 12);
+	}
 	// Iterate over the 12 edges of the cube
 	// If the surface does cross this edge, find the interpolation point, otherwise write a zero vector
 	for (int i = 0; i < 12; i++)
@@ -113,7 +119,6 @@ TArray<FVector3f> MarchingCubesGenerator::InterpolateVerticesOnEdges(const GridC
 			interpolatedVertices[i] = FVector3f::ZeroVector;
 		}
 	}
-	return interpolatedVertices;
 }
 
 FVector3f MarchingCubesGenerator::InterpolateEdge(FVector3f vertex1, FVector3f vertex2, float value1, float value2)
@@ -134,10 +139,7 @@ void MarchingCubesGenerator::GenerateTriangles(int cubeIndex, const TArray<FVect
 	// Iterate over the triangles and add them to the total list of needed triangles
 	for (int i = 0; triTable[cubeIndex][i] != -1; i+=3)
 	{
-		auto vert1 = generatedMesh.AppendVertex((FVector3d)vertexList[triTable[cubeIndex][i]]);
-		auto vert2 = generatedMesh.AppendVertex((FVector3d)vertexList[triTable[cubeIndex][i+1]]);
-		auto vert3 = generatedMesh.AppendVertex((FVector3d)vertexList[triTable[cubeIndex][i+2]]);
-		generatedMesh.AppendTriangle(UE::Geometry::FIndex3i(vert1, vert2, vert3));
+		AppendSoupTriangle((FVector3d)vertexList[triTable[cubeIndex][i]], (FVector3d)vertexList[triTable[cubeIndex][i+1]], (FVector3d)vertexList[triTable[cubeIndex][i+2]], currentCellGroupID);
 	}
 	return;
 }
@@ -151,10 +153,10 @@ void MarchingCubesGenerator::TriangulateCell(const GridCell &gridCell)
 	if (edgeTable[cubeIndex] == 0) return;
 
 	// Calculate the position along the edges where the surface will intersect
-	auto interpolatedVertices = InterpolateVerticesOnEdges(gridCell);
+	InterpolateVerticesOnEdges(gridCell, scratchEdgeVertices);
 
 	// Generate the triangles required for this cube configuration with the interpolated points
-	GenerateTriangles(cubeIndex, interpolatedVertices);
+	GenerateTriangles(cubeIndex, scratchEdgeVertices);
 
 	return;
 }
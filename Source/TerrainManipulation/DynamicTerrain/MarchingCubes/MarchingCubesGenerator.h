@@ -21,10 +21,21 @@ public:
 	/// <param name="dynamicMesh">The DynamicMeshComponent that will receive the new mesh</param>
 	void GenerateOnGPU(UDynamicMeshComponent* dynamicMesh);
 
+protected:
 	/// <summary>
-	/// Generate the mesh with linear computation on the CPU
+	/// Append the triangles of every cell in a row along X to the generatedMesh
 	/// </summary>
-	UE::Geometry::FDynamicMesh3 GenerateOnCPU();
+	/// <param name="j">Cell index along Y within the dataGrid</param>
+	/// <param name="k">Cell index along Z within the dataGrid</param>
+	void GenerateCellRow(int32 j, int32 k);
+
+	/// <summary>
+	/// Every triangle is given three vertices of its own
+	/// </summary>
+	bool GeneratesTriangleSoup() const
+	{
+		return true;
+	}
 
 private:
 	/// <summary>
@@ -38,9 +49,8 @@ private:
 	/// Determine the positions along each edge where the isosurface crosses the cube
 	/// </summary>
 	/// <param name="gridCell">A GridCell struct containing the positions and values of the 8 vertices in a cube</param>
-	/// <param name="isovalue">The isovalue at which the surface will be drawn</param>
-	/// <returns>A vector of the vertices interpolated along each edge</returns>
-	TArray<FVector3f> InterpolateVerticesOnEdges(const GridCell& gridCell);
+	/// <param name="outVertices">Receives the vertex interpolated along each of the 12 edges</param>
+	void InterpolateVerticesOnEdges(const GridCell& gridCell, TArray<FVector3f>& outVertices);
 	/// <summary>
 	/// Linearly interpolate between two vertices and their values to find the point where the isosurface intersects
 	/// </summary>
@@ -72,10 +82,19 @@ private:
 	/// <param name="vertexTripletList">The list of vertices to be made into a mesh</param>
 	void CreateMeshFromVertexTriplets(const TArray<FVector3f>& vertexTripletList);
 
+	// The triangle group ID of the cell currently being triangulated
+	int32 currentCellGroupID = 0;
+
+	// The corners of the cell currently being triangulated, overwritten for every cell rather than reallocated
+	GridCell scratchCell;
+
+	// The vertices interpolated along the edges of the cell currently being triangulated, kept between cells and runs so that meshing never allocates them
+	TArray<FVector3f> scratchEdgeVertices;
+
 	/// <summary>
 	/// The ordering of the vertices, as defined by Paul Bourke
 	/// </summary>
-	const FIntVector3 vertexOrder[8] = {
+	static inline const FIntVector3 vertexOrder[8] = {
 		{0,0,0},
 		{1,0,0},
 		{1,1,0},
@@ -89,7 +108,7 @@ private:
 	/// <summary>
 	/// List of edges required for each cube index. Bit 2^i is used to represent whether edge i is required.
 	/// </summary>
-	const int edgeTable[256] =
+	static inline const int edgeTable[256] =
 	{
 		0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
 		0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
@@ -128,7 +147,7 @@ private:
 	/// <summary>
 	/// For each edge id, the vertex ids that connect this edge
 	/// </summary>
-	const std::pair<int, int> verticesOnEdge[12] =
+	static inline const std::pair<int, int> verticesOnEdge[12] =
 	{
 		{0, 1}, {1, 2}, {2, 3}, {0, 3},
 		{4, 5}, {5, 6}, {6, 7}, {4, 7},
@@ -138,7 +157,7 @@ private:
 	/// <summary>
 	/// For each cube index, the edges required to create the valid isosurface. All are tail-ended by -1 to mark where the necessary triangles finish
 	/// </summary>
-	const int triTable[256][16] =
+	static inline const int triTable[256][16] =
 	{
 		{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
 		{0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
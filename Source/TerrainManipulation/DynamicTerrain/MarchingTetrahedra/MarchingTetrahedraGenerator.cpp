@@ -89,35 +89,43 @@ void MarchingTetrahedraGenerator::GenerateOnGPU(UDynamicMeshComponent* dynamicMe
 		});
 }
 
-FDynamicMesh3 MarchingTetrahedraGenerator::GenerateOnCPU()
+void MarchingTetrahedraGenerator::GenerateCellRow(int32 j, int32 k)
 {
 	FGridCell gridCell;
-	FVector3i gridIndex = FVector3i(0, 0, 0);
+	FVector3i gridIndex = FVector3i(0, j, k);
 
-	// Iterate over first x, then y, then z
-	for (size_t k = 0; k < dataGrid.GetSize(2) - 1; k++)
+	// The sign mask can only stand in for the cell values if it was built against the same isovalue
+	bool bUseSignMask = dataGrid.HasSignMask() && dataGrid.GetSignMaskThreshold() == isovalue;
+
+	// Iterate along x within the row
+	for (size_t i = 0; i < dataGrid.GetSize(0) - 1; i++)
 	{
-		gridIndex.Z = k;
-		for (size_t j = 0; j < dataGrid.GetSize(1) - 1; j++)
+		if (bUseSignMask)
 		{
-			gridIndex.Y = j;
-			for (size_t i = 0; i < dataGrid.GetSize(0) - 1; i++)
+			if (!dataGrid.GetSignMask().CanBlockContainSurface(i >> 2, j >> 2, k >> 2))
 			{
-				gridIndex.X = i;
-				InitialiseGridCell(gridCell, gridIndex);
-				bool trianglesAdded = TriangulateGridCell(gridCell);
+				// No cell in this 4x4x4 block is active, so jump to the last cell of the block along this row
+				i |= 3;
+				continue;
 			}
+
+			// A uniform cube cannot contain a sign change along any of its tetrahedra either
+			uint8 cubeIndex = dataGrid.GetSignMask().GetCellIndex(i, j, k);
+			if (cubeIndex == 0 || cubeIndex == 255) continue;
 		}
-	}
 
-	return generatedMesh;
+		gridIndex.X = i;
+		currentCellGroupID = GetCellGroupID(i, j, k);
+		InitialiseGridCell(gridCell, gridIndex);
+		bool trianglesAdded = TriangulateGridCell(gridCell);
+	}
 }
 
 void MarchingTetrahedraGenerator::InitialiseGridCell(FGridCell& gridCell, const UE::Geometry::FVector3i& gridIndex)
 {
 	for (int i = 0; i < 8; i++) {
 		FVector3i cornerIndex = gridIndex + cubeVertexOrder[i];
-		gridCell.positions[i] = FVector3d(cornerIndex.X * gridCellDimensions.X, cornerIndex.Y * gridCellDimensions.Y, cornerIndex.Z * gridCellDimensions.Z);
+		gridCell.positions[i] = (FVector3d)zeroCellOffset + FVector3d(cornerIndex.X * gridCellDimensions.X, cornerIndex.Y * gridCellDimensions.Y, cornerIndex.Z * gridCellDimensions.Z);
 		gridCell.values[i] = dataGrid.GetElement(gridIndex.X + cubeVertexOrder[i].X, gridIndex.Y + cubeVertexOrder[i].Y, gridIndex.Z + cubeVertexOrder[i].Z);
 	}
 }
@@ -141,14 +149,14 @@ bool MarchingTetrahedraGenerator::TriangulateGridCell(const FGridCell& gridCell)
 
 	// Interpolate edges
 	// Edges are interpolated for the cube to remove duplicate interpolation calculations
-	TArray<FVector3d> interpolatedEdgesInCube = InterpolateVerticesOnEdges(gridCell, cubeIndex);
+	InterpolateVerticesOnEdges(gridCell, cubeIndex, scratchEdgeVertices);
 
 	// Iterate over each tetrahedron
 	FTetrahedron tetra{};
 	for (int i = 0; i < 6; i++)
 	{
 		InitialiseTetrahedron(tetra, gridCell, i);
-		bool trianglesAdded = TriangulateTetrahedron(tetra, interpolatedEdgesInCube);
+		bool trianglesAdded = TriangulateTetrahedron(tetra, scratchEdgeVertices);
 	}
 
 	return true;
@@ -187,10 +195,12 @@ int MarchingTetrahedraGenerator::CalculateTetrahedronIndex(const FTetrahedron& t
 	return tetraIndex;
 }
 
-TArray<FVector3d> MarchingTetrahedraGenerator::InterpolateVerticesOnEdges(const FGridCell& gridCell, const int cubeIndex)
+void MarchingTetrahedraGenerator::InterpolateVerticesOnEdges(const FGridCell& gridCell, const int cubeIndex, TArray<FVector3d>& interpolatedVertices)
 {
-	TArray<FVector3d> interpolatedVertices;
-	interpolatedVertices.Init(FVector3d::ZeroVector, 19);
+	if (interpolatedVertices.Num() != 19)
+	{
+		interpolatedVertices.Init(FVector3d::ZeroVector, 19);
+	}
 	// Iterate over the 19 edges of the cube (plus diagonals from the tetrahedra)
 	// If the surface does cross this edge, find the interpolation point, otherwise write a zero vector
 	for (int i = 0; i < 19; i++)
@@ -204,11 +214,10 @@ TArray<FVector3d> MarchingTetrahedraGenerator::InterpolateVerticesOnEdges(const
 		else
 		{
 			// This edge will not be used in calculations, so pad the list with zero vector
-			//interpolatedVertices[i] = FVector3d::ZeroVector;
-			// No need as the array is initialised with this anyway
+			// The array is reused between cells, so the previous cell's vertex must be overwritten
+			interpolatedVertices[i] = FVector3d::ZeroVector;
 		}
 	}
-	return interpolatedVertices;
 }
 
 FVector3d MarchingTetrahedraGenerator::InterpolateEdge(FVector3d vertex1, FVector3d vertex2, float value1, float value2)
@@ -226,11 +235,11 @@ FVector3d MarchingTetrahedraGenerator::InterpolateEdge(FVector3d vertex1, FVecto
 void MarchingTetrahedraGenerator::GenerateTrianglesFromTetrahedron(const FTetrahedron& tetra, int tetraIndex, const TArray<FVector3d>& interpolatedEdgesInCube)
 {
 	// Store the ids of the vertices within the Vertices array
-	TArray<int> interpolatedVertexIDs;
-	interpolatedVertexIDs.Init(-1, 4);
+	// Both arrays are fixed in size, so they live on the stack rather than being allocated for every tetrahedron
+	int interpolatedVertexIDs[4] = { -1, -1, -1, -1 };
 
 	// Translate all interpolated edge values from the cube into the tetrahedral space
-	TArray<FVector3d> interpolatedEdgesInTetrahedronSpace;
+	FVector3d interpolatedEdgesInTetrahedronSpace[6];
 	for (int i = 0; i < 6; i++)
 	{
 		std::pair<int, int> tetraVertices = tetrahedronVerticesOnEdge[i];
@@ -240,7 +249,7 @@ void MarchingTetrahedraGenerator::GenerateTrianglesFromTetrahedron(const FTetrah
 		int edgeID = cubeVertexPairToEdge[cubeVertices.first][cubeVertices.second];
 		if (edgeID != -1)
 		{
-			interpolatedEdgesInTetrahedronSpace.Add(interpolatedEdgesInCube[edgeID]);
+			interpolatedEdgesInTetrahedronSpace[i] = interpolatedEdgesInCube[edgeID];
 		}
 		else
 		{
@@ -259,7 +268,7 @@ void MarchingTetrahedraGenerator::GenerateTrianglesFromTetrahedron(const FTetrah
 			interpolatedVertexIDs[i] = generatedMesh.AppendVertex(interpolatedEdgesInTetrahedronSpace[tetrahedronTriTable[tetraIndex][i]]);
 			//interpolatedVertexIDs[i] = generatedMesh.AppendVertex(interpolatedVertexList[tetrahedronTriTable[tetraIndex][i]]);
 		}
-		generatedMesh.AppendTriangle(interpolatedVertexIDs[0], interpolatedVertexIDs[1], interpolatedVertexIDs[2]);
+		generatedMesh.AppendTriangle(FIndex3i(interpolatedVertexIDs[0], interpolatedVertexIDs[1], interpolatedVertexIDs[2]), currentCellGroupID);
 	}
 	else return;
 
@@ -269,7 +278,7 @@ void MarchingTetrahedraGenerator::GenerateTrianglesFromTetrahedron(const FTetrah
 		// Append the final required vertex from the triangle strip
 		interpolatedVertexIDs[3] = generatedMesh.AppendVertex(interpolatedEdgesInTetrahedronSpace[tetrahedronTriTable[tetraIndex][3]]);
 		// Reverse the direction of the vertices otherwise the triangle will point the wrong way
-		generatedMesh.AppendTriangle(interpolatedVertexIDs[3], interpolatedVertexIDs[2], interpolatedVertexIDs[1]);
+		generatedMesh.AppendTriangle(FIndex3i(interpolatedVertexIDs[3], interpolatedVertexIDs[2], interpolatedVertexIDs[1]), currentCellGroupID);
 	}
 }
 
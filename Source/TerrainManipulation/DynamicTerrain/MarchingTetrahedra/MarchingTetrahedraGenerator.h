@@ -27,12 +27,14 @@ public:
 	/// <param name="dynamicMesh">The DynamicMeshComponent that will receive the new mesh</param>
 	void GenerateOnGPU(UDynamicMeshComponent* dynamicMesh);
 
+protected:
 	/// <summary>
-	/// Generate the mesh with linear computation on the CPU
+	/// Append the triangles of every cell in a row along X to the generatedMesh
 	/// </summary>
-	UE::Geometry::FDynamicMesh3 GenerateOnCPU();
+	/// <param name="j">Cell index along Y within the dataGrid</param>
+	/// <param name="k">Cell index along Z within the dataGrid</param>
+	void GenerateCellRow(int32 j, int32 k);
 
-protected:
 	// Pass GridCells around rather than the whole grid to simplify code
 	struct FGridCell
 	{
@@ -96,8 +98,8 @@ protected:
 	/// </summary>
 	/// <param name="gridCell">An FGridCell struct containing the positions and values of the 8 vertices in a cube</param>
 	/// <param name="cubeIndex">The unique index to represent which corners of the cube are inside/outside the isosurface</param>
-	/// <returns></returns>
-	TArray<FVector3d> InterpolateVerticesOnEdges(const FGridCell& gridCell, const int cubeIndex);
+	/// <param name="outVertices">Receives the vertex interpolated along each of the 19 edges</param>
+	void InterpolateVerticesOnEdges(const FGridCell& gridCell, const int cubeIndex, TArray<FVector3d>& outVertices);
 
 	/// <summary>
 	/// Linearly interpolate between two vertices and their values to find the point where the isosurface intersects
@@ -124,10 +126,16 @@ protected:
 	/// <param name="vertexTripletList">The list of vertices to be made into a mesh</param>
 	void CreateMeshFromVertexTriplets(const TArray<FVector3f>& vertexTripletList);
 
+	// The triangle group ID of the cell currently being triangulated
+	int32 currentCellGroupID = 0;
+
+	// The vertices interpolated along the edges of the cell currently being triangulated, kept between cells and runs so that meshing never allocates them
+	TArray<FVector3d> scratchEdgeVertices;
+
 	/// <summary>
 	/// A list of the cube vertices that make up each of the six tetrahedra contained in the cube
 	/// </summary>
-	const int tetrahedronList[6][4] = 
+	static inline const int tetrahedronList[6][4] = 
 	{
 		{0, 1, 2, 4},
 		{1, 2, 4, 5},
@@ -140,7 +148,7 @@ protected:
 	/// <summary>
 	/// List of edges required for each tetrahedron index. Bit 2^i is used to represent whether edge i is required.
 	/// </summary>
-	const int tetrahedronEdgeTable[16] =
+	static inline const int tetrahedronEdgeTable[16] =
 	{
 		0,	13,	19,	30,	38,	43,	53,	56,
 		56,	53,	43,	38,	30,	19,	13,	0
@@ -149,7 +157,7 @@ protected:
 	/// <summary>
 	/// For each edge id, the vertex ids that connect this edge
 	/// </summary>
-	const std::pair<int, int> tetrahedronVerticesOnEdge[6] =
+	static inline const std::pair<int, int> tetrahedronVerticesOnEdge[6] =
 	{
 		{0, 1}, {1, 2}, {0, 2},
 		{0, 3}, {1, 3}, {2, 3}
@@ -158,7 +166,7 @@ protected:
 	/// <summary>
 	/// For each tetrahedron index, the edges required to create the valid isosurface. The tables are listed in triangle strips. All are tail-ended by -1 to mark where the necessary triangles finish
 	/// </summary>
-	const int tetrahedronTriTable[16][5] =
+	static inline const int tetrahedronTriTable[16][5] =
 	{
 		{-1, -1, -1, -1, -1},
 		{0, 3, 2, -1, -1},
@@ -182,7 +190,7 @@ protected:
 	/// <summary>
 	/// The ordering of the vertices, as defined by Paul Bourke
 	/// </summary>
-	const UE::Geometry::FVector3i cubeVertexOrder[8] =
+	static inline const UE::Geometry::FVector3i cubeVertexOrder[8] =
 	{
 		{0, 0, 0},
 		{1, 0, 0},
@@ -197,7 +205,7 @@ protected:
 	/// <summary>
 	/// For each edge id, the vertex ids that connect this edge, including all diagonals for marching tetrahedra
 	/// </summary>
-	const std::pair<int, int> cubeVerticesOnEdge[19] =
+	static inline const std::pair<int, int> cubeVerticesOnEdge[19] =
 	{
 		{0, 1}, {1, 2}, {2, 3}, {0, 3},
 		{4, 5}, {5, 6}, {6, 7}, {4, 7},
@@ -209,7 +217,7 @@ protected:
 	/// <summary>
 	/// A 2D array giving the edge ID that links each pair of vertices. -1 represents no edge present
 	/// </summary>
-	const int cubeVertexPairToEdge[8][8] = 
+	static inline const int cubeVertexPairToEdge[8][8] = 
 	{
 		{-1, 0, 16, 3, 8, -1, -1, -1},
 		{0, -1, 1, -1, 12, 9, -1, -1},
@@ -224,7 +232,7 @@ protected:
 	/// <summary>
 	/// List of edges required for each cube index. Bit 2^i is used to represent whether edge i is required.
 	/// </summary>
-	const int cubeEdgeTable[256] = 
+	static inline const int cubeEdgeTable[256] = 
 	{
 		0x000000, 0x010109, 0x001203, 0x01130A, 0x056406, 0x04650F, 0x057605, 0x04770C,
 		0x00880C, 0x018905, 0x009A0F, 0x019B06, 0x05EC0A, 0x04ED03, 0x05FE09, 0x04FF00,
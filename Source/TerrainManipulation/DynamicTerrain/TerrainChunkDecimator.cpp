@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainChunkDecimator.h"
+#include "MeshSimplification.h"
+#include "MeshConstraintsUtil.h"
+#include "ProjectionTargets.h"
+#include "DynamicMesh/DynamicMeshAABBTree3.h"
+#include "Operations/MergeCoincidentMeshEdges.h"
+
+using namespace UE::Geometry;
+
+bool FTerrainChunkDecimator::Decimate(FDynamicMesh3& mesh, double errorTolerance, int32 triangleBudget)
+{
+	bool bBounded = errorTolerance > 0;
+	if (mesh.TriangleCount() == 0 || (!bBounded && triangleBudget <= 0) || (triangleBudget > 0 && mesh.TriangleCount() <= triangleBudget))
+	{
+		return false;
+	}
+
+	// Neighbouring cells interpolate their shared edges separately, so the soup is welded with a tolerance far below the size of a cell
+	double weldTolerance = FMath::Max(mesh.GetBounds().MaxDim() * 1e-5, UE_DOUBLE_KINDA_SMALL_NUMBER);
+	FMergeCoincidentMeshEdges weld(&mesh);
+	weld.MergeVertexTolerance = weldTolerance;
+	weld.MergeSearchTolerance = weldTolerance * 2;
+	weld.Apply();
+
+	// Normals would no longer match the surface once edges collapse
+	if (mesh.HasVertexNormals())
+	{
+		mesh.DiscardVertexNormals();
+	}
+
+	// Every remaining open edge is fixed, which covers the faces of the chunk along with any pair the weld could not match.
+	// The triangle groups only record the cells the triangles came from, so collapses are free to cross them
+	FMeshConstraints constraints;
+	FMeshConstraintsUtil::ConstrainAllBoundariesAndSeams(constraints, mesh,
+		EEdgeRefineFlags::FullyConstrained, EEdgeRefineFlags::NoConstraint, EEdgeRefineFlags::NoConstraint,
+		false, false, false);
+
+	FQEMSimplification simplifier(&mesh);
+	simplifier.SetExternalConstraints(MoveTemp(constraints));
+	simplifier.CollapseMode = FQEMSimplification::ESimplificationCollapseModes::MinimalQuadricPositionError;
+
+	// The error is measured against an untouched copy of the welded mesh, so it bounds the true distance rather than the accumulated quadric error
+	FDynamicMesh3 originalMesh;
+	FDynamicMeshAABBTree3 originalSpatial;
+	FMeshProjectionTarget originalTarget;
+	if (bBounded)
+	{
+		originalMesh.Copy(mesh, false, false, false, false);
+		originalSpatial.SetMesh(&originalMesh, true);
+		originalTarget = FMeshProjectionTarget(&originalMesh, &originalSpatial);
+		simplifier.SetProjectionTarget(&originalTarget);
+		simplifier.GeometricErrorConstraint = FQEMSimplification::EGeometricErrorCriteria::PredictedPointToProjectionTarget;
+		simplifier.GeometricErrorTolerance = errorTolerance;
+	}
+
+	simplifier.SimplifyToTriangleCount(FMath::Max(triangleBudget, 1));
+
+	// Collapses leave gaps in the vertex and triangle IDs, which later passes would otherwise have to skip over
+	mesh.CompactInPlace();
+	return true;
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DynamicMesh/DynamicMesh3.h"
+
+/**
+ * Simplifies chunk meshes with quadric error edge collapses, which removes most of the triangles the generators spend on flat ground.
+ * The open edges of a welded chunk mesh lie on the faces of the chunk, and they are locked along with their vertices,
+ * so the border of a chunk matches its undecimated neighbours exactly and seams stay watertight
+ */
+class TERRAINMANIPULATION_API FTerrainChunkDecimator
+{
+public:
+	/// <summary>
+	/// Weld a chunk mesh and collapse edges until the triangle budget is reached, or no collapse is left that stays within the error tolerance.
+	/// The result shares vertices between triangles, so it is no longer a triangle soup
+	/// </summary>
+	/// <param name="mesh">The chunk mesh to simplify in place</param>
+	/// <param name="errorTolerance">The furthest, in local units, any vertex may end up from the original surface. Zero leaves the error unbounded</param>
+	/// <param name="triangleBudget">The triangle count to simplify down to. Zero simplifies as far as the error tolerance allows</param>
+	/// <returns>False if there was nothing to do, in which case the mesh is left unchanged</returns>
+	static bool Decimate(UE::Geometry::FDynamicMesh3& mesh, double errorTolerance, int32 triangleBudget);
+};
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainChunkScheduler.h"
+
+void FTerrainChunkScheduler::MarkDirty(const FGridRegion& chunkRegion)
+{
+	if (chunkRegion.IsEmpty())
+	{
+		return;
+	}
+
+	for (int32 z = chunkRegion.minIndex.Z; z <= chunkRegion.maxIndex.Z; z++)
+	{
+		for (int32 y = chunkRegion.minIndex.Y; y <= chunkRegion.maxIndex.Y; y++)
+		{
+			for (int32 x = chunkRegion.minIndex.X; x <= chunkRegion.maxIndex.X; x++)
+			{
+				pendingChunks.Add(FIntVector(x, y, z));
+			}
+		}
+	}
+}
+
+void FTerrainChunkScheduler::Reset()
+{
+	pendingChunks.Reset();
+}
+
+void FTerrainChunkScheduler::TakeMostUrgent(int32 maxCount, const FTerrainChunkView& view, TFunctionRef<FBox(const FIntVector&)> getChunkBounds, TArray<FIntVector>& outChunks)
+{
+	outChunks.Reset();
+	if (maxCount <= 0 || pendingChunks.Num() == 0)
+	{
+		return;
+	}
+
+	// Only the chunks that will be taken are kept and sorted, in a heap with the least urgent of them on top, so a long queue costs a walk rather than a full sort
+	auto lessUrgent = [](const TPair<float, FIntVector>& a, const TPair<float, FIntVector>& b)
+		{
+			return a.Key > b.Key;
+		};
+	urgentChunks.Reset();
+	for (const FIntVector& chunkCoords : pendingChunks)
+	{
+		float priority = GetPriority(chunkCoords, getChunkBounds(chunkCoords), view);
+		if (urgentChunks.Num() < maxCount)
+		{
+			urgentChunks.HeapPush(TPair<float, FIntVector>(priority, chunkCoords), lessUrgent);
+		}
+		else if (priority < urgentChunks.HeapTop().Key)
+		{
+			urgentChunks.HeapPopDiscard(lessUrgent, EAllowShrinking::No);
+			urgentChunks.HeapPush(TPair<float, FIntVector>(priority, chunkCoords), lessUrgent);
+		}
+	}
+	urgentChunks.Sort([](const TPair<float, FIntVector>& a, const TPair<float, FIntVector>& b)
+		{
+			return a.Key < b.Key;
+		});
+
+	outChunks.Reserve(urgentChunks.Num());
+	for (const TPair<float, FIntVector>& urgentChunk : urgentChunks)
+	{
+		outChunks.Add(urgentChunk.Value);
+		pendingChunks.Remove(urgentChunk.Value);
+	}
+}
+
+void FTerrainChunkScheduler::SortByUrgency(TArray<FIntVector>& chunks, const FTerrainChunkView& view, TFunctionRef<FBox(const FIntVector&)> getChunkBounds) const
+{
+	// Priorities are worked out once per chunk rather than on every comparison
+	TArray<TPair<float, FIntVector>> prioritisedChunks;
+	prioritisedChunks.Reserve(chunks.Num());
+	for (const FIntVector& chunkCoords : chunks)
+	{
+		prioritisedChunks.Add(TPair<float, FIntVector>(GetPriority(chunkCoords, getChunkBounds(chunkCoords), view), chunkCoords));
+	}
+	prioritisedChunks.Sort([](const TPair<float, FIntVector>& a, const TPair<float, FIntVector>& b)
+		{
+			return a.Key < b.Key;
+		});
+
+	for (int32 i = 0; i < chunks.Num(); i++)
+	{
+		chunks[i] = prioritisedChunks[i].Value;
+	}
+}
+
+float FTerrainChunkScheduler::GetPriority(const FIntVector& chunkCoords, const FBox& chunkBounds, const FTerrainChunkView& view) const
+{
+	if (view.occupiedChunks.Contains(chunkCoords))
+	{
+		return -1;
+	}
+	if (!view.bHasCamera)
+	{
+		return 0;
+	}
+
+	FVector toChunk = chunkBounds.GetCenter() - view.cameraLocation;
+	double distance = toChunk.Size();
+	double radius = chunkBounds.GetExtent().Size();
+	if (distance <= radius)
+	{
+		// The camera is inside the bounding sphere of the chunk
+		return 0;
+	}
+
+	// The chunk is in view if its bounding sphere overlaps the cone of the horizontal field of view, which is conservative vertically
+	double angleToChunk = FMath::Acos(FMath::Clamp(FVector::DotProduct(toChunk / distance, view.cameraForward), -1.0, 1.0));
+	double angularRadius = FMath::Asin(radius / distance);
+	bool bInView = angleToChunk <= view.halfFieldOfView + angularRadius;
+	return (float)(bInView ? distance : distance * offscreenDistanceScale);
+}
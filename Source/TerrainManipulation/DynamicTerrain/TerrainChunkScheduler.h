@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TerrainManipulation/DataStructs/GridRegion.h"
+
+/**
+ * Where the terrain is being looked at from, in the local space of the terrain
+ */
+struct TERRAINMANIPULATION_API FTerrainChunkView
+{
+	// Whether a camera was found. Without one, only occupied chunks are more urgent than any other
+	bool bHasCamera = false;
+
+	FVector cameraLocation = FVector::ZeroVector;
+
+	// The unit direction the camera is facing
+	FVector cameraForward = FVector::ForwardVector;
+
+	// Half of the horizontal field of view of the camera, in radians
+	float halfFieldOfView = UE_HALF_PI;
+
+	// The chunks a pawn is standing on, which are always remeshed first
+	TSet<FIntVector> occupiedChunks;
+};
+
+/**
+ * Holds the chunks waiting to be remeshed and hands them out most urgent first.
+ * Chunks a pawn is standing on come first, then chunks in view by distance, then chunks out of view by a scaled up distance
+ */
+class TERRAINMANIPULATION_API FTerrainChunkScheduler
+{
+public:
+	/// <summary>
+	/// Queue every chunk in a box to be remeshed. Chunks already queued are only queued once
+	/// </summary>
+	/// <param name="chunkRegion">An inclusive box of chunk coordinates</param>
+	void MarkDirty(const FGridRegion& chunkRegion);
+
+	/// <summary>
+	/// Discard every queued chunk
+	/// </summary>
+	void Reset();
+
+	bool HasPendingChunks() const
+	{
+		return pendingChunks.Num() > 0;
+	}
+
+	int32 GetPendingCount() const
+	{
+		return pendingChunks.Num();
+	}
+
+	/// <summary>
+	/// Remove the most urgent queued chunks
+	/// </summary>
+	/// <param name="maxCount">The largest number of chunks to remove</param>
+	/// <param name="view">Where the terrain is being looked at from</param>
+	/// <param name="getChunkBounds">Gives the local space bounds of a chunk</param>
+	/// <param name="outChunks">Receives the chunks, most urgent first</param>
+	void TakeMostUrgent(int32 maxCount, const FTerrainChunkView& view, TFunctionRef<FBox(const FIntVector&)> getChunkBounds, TArray<FIntVector>& outChunks);
+
+	/// <summary>
+	/// Sort any list of chunks so that the most urgent comes first
+	/// </summary>
+	void SortByUrgency(TArray<FIntVector>& chunks, const FTerrainChunkView& view, TFunctionRef<FBox(const FIntVector&)> getChunkBounds) const;
+
+	// The factor applied to the distance of chunks outside the view, so that a chunk behind the camera trails visible chunks this many times further away
+	float offscreenDistanceScale = 4;
+
+private:
+	/// <summary>
+	/// Get the value chunks are ordered by, where lower values are more urgent
+	/// </summary>
+	float GetPriority(const FIntVector& chunkCoords, const FBox& chunkBounds, const FTerrainChunkView& view) const;
+
+	// The chunks waiting to be remeshed
+	TSet<FIntVector> pendingChunks;
+
+	// The most urgent pending chunks found so far by TakeMostUrgent and their priorities, kept between calls so it never reallocates
+	TArray<TPair<float, FIntVector>> urgentChunks;
+};
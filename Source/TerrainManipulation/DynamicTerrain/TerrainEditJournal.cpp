@@ -0,0 +1,319 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainEditJournal.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/Guid.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+FTerrainEditJournal::~FTerrainEditJournal()
+{
+	Reset();
+}
+
+void FTerrainEditJournal::Configure(int64 memoryCapBytes, int32 maxBatchCount)
+{
+	// Spill files only outlive their journal if the run that wrote them exited without destroying it, which is checked once per process
+	static bool bRemovedOrphanedSpills = RemoveOrphanedSpillFiles();
+
+	memoryCap = FMath::Max<int64>(memoryCapBytes, 0);
+	maxBatches = FMath::Max(maxBatchCount, 1);
+	EnforceLimits();
+}
+
+void FTerrainEditJournal::Reset()
+{
+	for (FJournalBatch& batch : undoBatches)
+	{
+		DiscardBatch(batch);
+	}
+	for (FJournalBatch& batch : redoBatches)
+	{
+		DiscardBatch(batch);
+	}
+	undoBatches.Empty();
+	redoBatches.Empty();
+	capturedBricks.Empty();
+	bBatchOpen = false;
+	memoryUsed = 0;
+}
+
+void FTerrainEditJournal::BeginBatch()
+{
+	capturedBricks.Reset();
+	bBatchOpen = true;
+}
+
+bool FTerrainEditJournal::IsBrickCaptured(FIntVector3 brickCoords) const
+{
+	return capturedBricks.Contains(brickCoords);
+}
+
+void FTerrainEditJournal::CaptureBrick(FIntVector3 brickCoords, TArray3D<float>&& values)
+{
+	capturedBricks.Add(brickCoords, MoveTemp(values));
+}
+
+void FTerrainEditJournal::CommitBatch(TFunctionRef<void(FIntVector3, TArray3D<float>&)> readBrick, const FGridRegion& modifiedRegion)
+{
+	bBatchOpen = false;
+
+	TArray<FTerrainBrickDelta> deltas;
+	for (TPair<FIntVector3, TArray3D<float>>& captured : capturedBricks)
+	{
+		const TArray3D<float>& before = captured.Value;
+		TArray3D<float> after(before.GetSize(0), before.GetSize(1), before.GetSize(2));
+		readBrick(captured.Key, after);
+
+		// Unchanged values XOR to zero, which the compressor reduces to almost nothing
+		const TArray<float>& beforeValues = before.GetRawDataStruct();
+		const TArray<float>& afterValues = after.GetRawDataStruct();
+		FTerrainBrickDelta delta;
+		delta.brickCoords = captured.Key;
+		delta.xorBits.SetNumUninitialized(beforeValues.Num());
+		bool bChanged = false;
+		for (int32 i = 0; i < beforeValues.Num(); i++)
+		{
+			delta.xorBits[i] = *reinterpret_cast<const uint32*>(&beforeValues[i]) ^ *reinterpret_cast<const uint32*>(&afterValues[i]);
+			bChanged |= delta.xorBits[i] != 0;
+		}
+
+		if (bChanged)
+		{
+			deltas.Add(MoveTemp(delta));
+		}
+	}
+	capturedBricks.Reset();
+
+	if (deltas.Num() == 0)
+	{
+		return;
+	}
+
+	// A new edit invalidates everything that was undone before it
+	for (FJournalBatch& batch : redoBatches)
+	{
+		DiscardBatch(batch);
+	}
+	redoBatches.Empty();
+
+	FJournalBatch& batch = undoBatches.AddDefaulted_GetRef();
+	batch.region = modifiedRegion;
+	EncodeDeltas(deltas, batch);
+	memoryUsed += batch.compressedData.Num();
+
+	EnforceLimits();
+}
+
+bool FTerrainEditJournal::Undo(TArray<FTerrainBrickDelta>& outDeltas, FGridRegion& outRegion)
+{
+	return TransferBatch(undoBatches, redoBatches, outDeltas, outRegion);
+}
+
+bool FTerrainEditJournal::Redo(TArray<FTerrainBrickDelta>& outDeltas, FGridRegion& outRegion)
+{
+	return TransferBatch(redoBatches, undoBatches, outDeltas, outRegion);
+}
+
+FGridRegion FTerrainEditJournal::GetBrickRegion(FIntVector3 brickCoords, FIntVector3 gridPointCount)
+{
+	FIntVector3 brickMin = brickCoords * BrickSize;
+	return FGridRegion(brickMin, brickMin + FIntVector3(BrickSize - 1, BrickSize - 1, BrickSize - 1))
+		.Clamped(FIntVector3(0, 0, 0), gridPointCount - FIntVector3(1, 1, 1));
+}
+
+bool FTerrainEditJournal::TransferBatch(TArray<FJournalBatch>& from, TArray<FJournalBatch>& to, TArray<FTerrainBrickDelta>& outDeltas, FGridRegion& outRegion)
+{
+	if (from.Num() == 0)
+	{
+		return false;
+	}
+
+	FJournalBatch batch = from.Pop();
+
+	// Batches on disk are brought back into memory, as the batch just used is the most likely to be used next
+	if (!batch.spillPath.IsEmpty())
+	{
+		if (!FFileHelper::LoadFileToArray(batch.compressedData, *batch.spillPath))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to read terrain edit history from %s, discarding the whole history"), *batch.spillPath);
+			DiscardBatch(batch);
+			Reset();
+			return false;
+		}
+		IFileManager::Get().Delete(*batch.spillPath);
+		batch.spillPath.Empty();
+		memoryUsed += batch.compressedData.Num();
+	}
+
+	// Every other batch was recorded against the field with this one applied, so skipping it would leave them restoring the wrong values
+	if (!DecodeDeltas(batch, outDeltas))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to decompress terrain edit history, discarding the whole history"));
+		DiscardBatch(batch);
+		Reset();
+		return false;
+	}
+	outRegion = batch.region;
+
+	to.Add(MoveTemp(batch));
+	EnforceLimits();
+	return true;
+}
+
+void FTerrainEditJournal::EnforceLimits()
+{
+	while (undoBatches.Num() > maxBatches)
+	{
+		DiscardBatch(undoBatches[0]);
+		undoBatches.RemoveAt(0);
+	}
+
+	// Spill the batches least likely to be needed first: the oldest undo, then the furthest redo
+	for (TArray<FJournalBatch>* history : { &undoBatches, &redoBatches })
+	{
+		for (int32 i = 0; i < history->Num() && memoryUsed > memoryCap; i++)
+		{
+			FJournalBatch& batch = (*history)[i];
+			if (!batch.spillPath.IsEmpty())
+			{
+				continue;
+			}
+
+			FString spillPath = FPaths::Combine(GetSpillDirectory(), FGuid::NewGuid().ToString() + TEXT(".bin"));
+			if (!FFileHelper::SaveArrayToFile(batch.compressedData, *spillPath))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Failed to write terrain edit history to %s"), *spillPath);
+				return;
+			}
+
+			memoryUsed -= batch.compressedData.Num();
+			batch.compressedData.Empty();
+			batch.spillPath = spillPath;
+		}
+	}
+}
+
+FString FTerrainEditJournal::GetSpillRootDirectory()
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TerrainEditJournal"));
+}
+
+FString FTerrainEditJournal::GetSpillDirectory()
+{
+	// Editors, PIE sessions and games sharing the project each spill into a directory named after their process
+	return FPaths::Combine(GetSpillRootDirectory(), FString::Printf(TEXT("%u"), FPlatformProcess::GetCurrentProcessId()));
+}
+
+bool FTerrainEditJournal::RemoveOrphanedSpillFiles()
+{
+	FString spillRootDirectory = GetSpillRootDirectory();
+	if (!IFileManager::Get().DirectoryExists(*spillRootDirectory))
+	{
+		return false;
+	}
+
+	// Only the directories of processes that have exited are removed, as any other still holds the live history of a running instance.
+	// Directories not named after a process are left alone, as the journal did not create them
+	TArray<FString> orphanedDirectories;
+	uint32 currentProcessId = FPlatformProcess::GetCurrentProcessId();
+	IFileManager::Get().IterateDirectory(*spillRootDirectory, [&](const TCHAR* path, bool bIsDirectory)
+		{
+			FString directoryName = FPaths::GetCleanFilename(path);
+			uint32 processId = 0;
+			if (bIsDirectory && directoryName.IsNumeric() && LexTryParseString(processId, *directoryName)
+				&& processId != currentProcessId && !FPlatformProcess::IsApplicationRunning(processId))
+			{
+				orphanedDirectories.Add(path);
+			}
+			return true;
+		});
+
+	bool bRemovedAny = false;
+	for (const FString& directory : orphanedDirectories)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Removing terrain edit history left in %s by a run that has exited"), *directory);
+		bRemovedAny |= IFileManager::Get().DeleteDirectory(*directory, false, true);
+	}
+	return bRemovedAny;
+}
+
+void FTerrainEditJournal::DiscardBatch(FJournalBatch& batch)
+{
+	if (!batch.spillPath.IsEmpty())
+	{
+		IFileManager::Get().Delete(*batch.spillPath);
+		batch.spillPath.Empty();
+	}
+	else
+	{
+		memoryUsed -= batch.compressedData.Num();
+	}
+	batch.compressedData.Empty();
+}
+
+void FTerrainEditJournal::EncodeDeltas(const TArray<FTerrainBrickDelta>& deltas, FJournalBatch& outBatch)
+{
+	TArray<uint8> rawData;
+	FMemoryWriter writer(rawData);
+	int32 deltaCount = deltas.Num();
+	writer << deltaCount;
+	for (const FTerrainBrickDelta& delta : deltas)
+	{
+		FIntVector3 brickCoords = delta.brickCoords;
+		writer << brickCoords.X << brickCoords.Y << brickCoords.Z;
+		int32 valueCount = delta.xorBits.Num();
+		writer << valueCount;
+		writer.Serialize((void*)delta.xorBits.GetData(), valueCount * sizeof(uint32));
+	}
+
+	outBatch.uncompressedSize = rawData.Num();
+	int32 compressedSize = FCompression::CompressMemoryBound(NAME_Zlib, rawData.Num());
+	outBatch.compressedData.SetNumUninitialized(compressedSize);
+	outBatch.bCompressed = FCompression::CompressMemory(NAME_Zlib, outBatch.compressedData.GetData(), compressedSize, rawData.GetData(), rawData.Num());
+	if (outBatch.bCompressed)
+	{
+		outBatch.compressedData.SetNum(compressedSize);
+	}
+	else
+	{
+		// Keep the deltas uncompressed rather than lose the history
+		outBatch.compressedData = MoveTemp(rawData);
+	}
+}
+
+bool FTerrainEditJournal::DecodeDeltas(const FJournalBatch& batch, TArray<FTerrainBrickDelta>& outDeltas)
+{
+	TArray<uint8> rawData;
+	if (!batch.bCompressed)
+	{
+		rawData = batch.compressedData;
+	}
+	else
+	{
+		rawData.SetNumUninitialized(batch.uncompressedSize);
+		if (!FCompression::UncompressMemory(NAME_Zlib, rawData.GetData(), rawData.Num(), batch.compressedData.GetData(), batch.compressedData.Num()))
+		{
+			return false;
+		}
+	}
+
+	FMemoryReader reader(rawData);
+	int32 deltaCount = 0;
+	reader << deltaCount;
+	outDeltas.SetNum(deltaCount);
+	for (FTerrainBrickDelta& delta : outDeltas)
+	{
+		reader << delta.brickCoords.X << delta.brickCoords.Y << delta.brickCoords.Z;
+		int32 valueCount = 0;
+		reader << valueCount;
+		delta.xorBits.SetNumUninitialized(valueCount);
+		reader.Serialize(delta.xorBits.GetData(), valueCount * sizeof(uint32));
+	}
+	return !reader.IsError();
+}
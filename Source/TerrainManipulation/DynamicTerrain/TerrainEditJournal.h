@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TerrainManipulation/DataStructs/TArray3D.h"
+#include "TerrainManipulation/DataStructs/GridRegion.h"
+
+/**
+ * The change made to one brick of the scalar field by an edit batch, stored as the XOR of the bits of the values before and after.
+ * Applying the same delta to the values after the edit restores the values before it, and applying it again redoes the edit
+ */
+struct TERRAINMANIPULATION_API FTerrainBrickDelta
+{
+	// The coordinates of the brick, in bricks
+	FIntVector3 brickCoords;
+
+	// The XOR of the bits of each value before and after the edit, in the order of a TArray3D of the brick
+	TArray<uint32> xorBits;
+};
+
+/**
+ * A history of edit batches that can be undone and redone.
+ * Each batch keeps only the bricks it changed, XOR encoded and compressed, and the oldest batches are written to disk once the memory cap is reached
+ */
+class TERRAINMANIPULATION_API FTerrainEditJournal
+{
+public:
+	// The number of grid points along each axis of a brick
+	static constexpr int32 BrickSize = 8;
+
+	~FTerrainEditJournal();
+
+	/// <summary>
+	/// Set the limits of the journal, discarding or spilling batches that no longer fit
+	/// </summary>
+	/// <param name="memoryCapBytes">The compressed size of batches kept in memory before the oldest are written to disk</param>
+	/// <param name="maxBatchCount">The number of batches that can be undone before the oldest are discarded</param>
+	void Configure(int64 memoryCapBytes, int32 maxBatchCount);
+
+	/// <summary>
+	/// Discard the whole history, including any batches written to disk
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// Start recording a batch of edits. Bricks must be captured before they are first modified within the batch
+	/// </summary>
+	void BeginBatch();
+
+	bool IsBatchOpen() const
+	{
+		return bBatchOpen;
+	}
+
+	/// <summary>
+	/// Check whether the values of a brick before the current batch have already been captured
+	/// </summary>
+	bool IsBrickCaptured(FIntVector3 brickCoords) const;
+
+	/// <summary>
+	/// Record the values of a brick before the current batch modifies it
+	/// </summary>
+	/// <param name="brickCoords">The coordinates of the brick, in bricks</param>
+	/// <param name="values">The values of the brick</param>
+	void CaptureBrick(FIntVector3 brickCoords, TArray3D<float>&& values);
+
+	/// <summary>
+	/// Finish the current batch, keeping only the bricks whose values have changed
+	/// </summary>
+	/// <param name="readBrick">Fills the array with the current values of the brick at the given coordinates</param>
+	/// <param name="modifiedRegion">The grid points modified by the batch</param>
+	void CommitBatch(TFunctionRef<void(FIntVector3, TArray3D<float>&)> readBrick, const FGridRegion& modifiedRegion);
+
+	/// <summary>
+	/// Take the most recent batch off the undo history and onto the redo history
+	/// </summary>
+	/// <param name="outDeltas">The deltas to apply to the current values to undo the batch</param>
+	/// <param name="outRegion">The grid points modified by the batch</param>
+	/// <returns>False if there is nothing to undo, or the batch could not be read back and the history was discarded</returns>
+	bool Undo(TArray<FTerrainBrickDelta>& outDeltas, FGridRegion& outRegion);
+
+	/// <summary>
+	/// Take the most recently undone batch off the redo history and back onto the undo history
+	/// </summary>
+	/// <param name="outDeltas">The deltas to apply to the current values to redo the batch</param>
+	/// <param name="outRegion">The grid points modified by the batch</param>
+	/// <returns>False if there is nothing to redo, or the batch could not be read back and the history was discarded</returns>
+	bool Redo(TArray<FTerrainBrickDelta>& outDeltas, FGridRegion& outRegion);
+
+	int32 GetUndoCount() const
+	{
+		return undoBatches.Num();
+	}
+
+	int32 GetRedoCount() const
+	{
+		return redoBatches.Num();
+	}
+
+	/// <summary>
+	/// Get the compressed size of the batches currently held in memory
+	/// </summary>
+	int64 GetMemoryUsed() const
+	{
+		return memoryUsed;
+	}
+
+	/// <summary>
+	/// Get the grid points covered by a brick, clamped to the size of the grid
+	/// </summary>
+	static FGridRegion GetBrickRegion(FIntVector3 brickCoords, FIntVector3 gridPointCount);
+
+private:
+	// A committed batch, held either in memory or in a file on disk
+	struct FJournalBatch
+	{
+		// The compressed deltas, empty while the batch is on disk
+		TArray<uint8> compressedData;
+
+		// The size of the deltas before compression
+		int32 uncompressedSize = 0;
+
+		// Whether compressedData is actually compressed, which it may not be if compression failed
+		bool bCompressed = false;
+
+		// The grid points modified by the batch
+		FGridRegion region;
+
+		// The file holding the compressed deltas, if they have been written to disk
+		FString spillPath;
+	};
+
+	/// <summary>
+	/// Move a batch from one history to the other, decoding its deltas on the way.
+	/// If the batch cannot be read back, the whole history is discarded, as every other batch depends on it
+	/// </summary>
+	bool TransferBatch(TArray<FJournalBatch>& from, TArray<FJournalBatch>& to, TArray<FTerrainBrickDelta>& outDeltas, FGridRegion& outRegion);
+
+	/// <summary>
+	/// Write the oldest batches held in memory to disk until the memory cap is met, and discard the oldest batches beyond the batch limit
+	/// </summary>
+	void EnforceLimits();
+
+	/// <summary>
+	/// Release a batch, deleting its file if it has one
+	/// </summary>
+	void DiscardBatch(FJournalBatch& batch);
+
+	/// <summary>
+	/// Get the directory holding the spill directory of every process
+	/// </summary>
+	static FString GetSpillRootDirectory();
+
+	/// <summary>
+	/// Get the directory that batches are written to once the memory cap is reached, which belongs to this process alone
+	/// </summary>
+	static FString GetSpillDirectory();
+
+	/// <summary>
+	/// Delete the spill directories left on disk by processes that did not shut down cleanly and are no longer running
+	/// </summary>
+	/// <returns>True if any files were removed</returns>
+	static bool RemoveOrphanedSpillFiles();
+
+	static void EncodeDeltas(const TArray<FTerrainBrickDelta>& deltas, FJournalBatch& outBatch);
+	static bool DecodeDeltas(const FJournalBatch& batch, TArray<FTerrainBrickDelta>& outDeltas);
+
+	// Batches that can be undone, oldest first
+	TArray<FJournalBatch> undoBatches;
+
+	// Batches that can be redone, oldest undo first
+	TArray<FJournalBatch> redoBatches;
+
+	// The values of each brick before the batch being recorded
+	TMap<FIntVector3, TArray3D<float>> capturedBricks;
+
+	bool bBatchOpen = false;
+
+	// The compressed size of the batches currently held in memory
+	int64 memoryUsed = 0;
+
+	int64 memoryCap = 64 * 1024 * 1024;
+	int32 maxBatches = 100;
+};
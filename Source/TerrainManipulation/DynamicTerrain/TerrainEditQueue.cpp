@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainEditQueue.h"
+
+void FTerrainEditQueue::Enqueue(const FTerrainBrush& brush, float coalesceTolerance)
+{
+	// Only the most recent brush is a candidate, as merging into an earlier one would move the edit past
+	// the brushes queued in between, and most modes do not commute with each other
+	if (pendingBrushes.Num() > 0)
+	{
+		FTerrainBrush& pending = pendingBrushes.Last();
+		if (pending.HasSameShape(brush) && FVector::DistSquared(pending.centre, brush.centre) <= FMath::Square(coalesceTolerance))
+		{
+			// Additive brushes are linear, so repeated hits on one spot collapse into a single stronger edit,
+			// while repeating an idempotent brush with the same value has no further effect
+			if (pending.IsAdditive())
+			{
+				pending.value += brush.value;
+				coalescedCount++;
+				return;
+			}
+			if (pending.IsIdempotent() && pending.value == brush.value)
+			{
+				coalescedCount++;
+				return;
+			}
+		}
+	}
+
+	pendingBrushes.Add(brush);
+}
+
+void FTerrainEditQueue::Drain(TArray<FTerrainBrush>& outBrushes)
+{
+	outBrushes = MoveTemp(pendingBrushes);
+	pendingBrushes.Reset();
+	coalescedCount = 0;
+}
+
+int32 FTerrainEditQueue::Num() const
+{
+	return pendingBrushes.Num();
+}
+
+int32 FTerrainEditQueue::GetCoalescedCount() const
+{
+	return coalescedCount;
+}
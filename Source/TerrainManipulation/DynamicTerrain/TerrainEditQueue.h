@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Brushes/TerrainBrush.h"
+
+/**
+ * Collects edit commands so that they can be applied as a single batch once per tick.
+ * Game thread only: brushes from other threads arrive through the terrain's bounded incoming queue, which is drained into this one on the game thread
+ */
+class TERRAINMANIPULATION_API FTerrainEditQueue
+{
+public:
+	/// <summary>
+	/// Add a brush to the queue, merging it into the last pending brush if that has the same shape and the two can be combined exactly
+	/// </summary>
+	/// <param name="brush">The brush to be applied on the next tick, with its centre in world space</param>
+	/// <param name="coalesceTolerance">The distance between centres within which two brushes of the same shape are treated as identical.
+	/// Only zero is exact, as a merged brush keeps the centre of the brush it was merged into</param>
+	void Enqueue(const FTerrainBrush& brush, float coalesceTolerance);
+
+	/// <summary>
+	/// Move every pending brush into the given array, leaving the queue empty
+	/// </summary>
+	/// <param name="outBrushes">The array to receive the brushes, in the order they were first queued</param>
+	void Drain(TArray<FTerrainBrush>& outBrushes);
+
+	/// <summary>
+	/// Get the number of brushes waiting to be applied
+	/// </summary>
+	int32 Num() const;
+
+	/// <summary>
+	/// Get the number of brushes that have been merged into another since the queue was last drained
+	/// </summary>
+	int32 GetCoalescedCount() const;
+
+private:
+	// The brushes waiting to be applied
+	TArray<FTerrainBrush> pendingBrushes;
+
+	// The number of brushes merged into another since the queue was last drained
+	int32 coalescedCount = 0;
+};
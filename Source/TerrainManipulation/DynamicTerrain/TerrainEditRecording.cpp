@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainEditRecording.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+bool FTerrainEditRecording::SaveToFile(const FString& filePath)
+{
+	TArray<uint8> fileData;
+	FMemoryWriter writer(fileData);
+	Serialize(writer);
+	return FFileHelper::SaveArrayToFile(fileData, *filePath);
+}
+
+bool FTerrainEditRecording::LoadFromFile(const FString& filePath)
+{
+	TArray<uint8> fileData;
+	if (!FFileHelper::LoadFileToArray(fileData, *filePath))
+	{
+		return false;
+	}
+
+	// The file is read into a separate recording, so a corrupt file leaves this one as it was
+	FTerrainEditRecording loaded;
+	FMemoryReader reader(fileData);
+	loaded.Serialize(reader);
+	if (reader.IsError())
+	{
+		return false;
+	}
+
+	*this = MoveTemp(loaded);
+	return true;
+}
+
+FString FTerrainEditRecording::GetRecordingPath(const FString& recordingName)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TerrainRecordings"), recordingName + TEXT(".terrec"));
+}
+
+void FTerrainEditRecording::Serialize(FArchive& archive)
+{
+	// Older versions are still read, with any field they did not store left at its default
+	uint32 magic = FileMagic;
+	uint32 fileVersion = FileVersion;
+	archive << magic << fileVersion;
+	if (magic != FileMagic || fileVersion < 1 || fileVersion > FileVersion)
+	{
+		archive.SetError();
+		return;
+	}
+	version = fileVersion;
+
+	archive << header.randomSeed;
+	archive << header.gridPointCount.X << header.gridPointCount.Y << header.gridPointCount.Z;
+	archive << header.bottomLeftAnchor.X << header.bottomLeftAnchor.Y << header.bottomLeftAnchor.Z;
+	archive << header.topRightAnchor.X << header.topRightAnchor.Y << header.topRightAnchor.Z;
+	archive << header.isovalue << header.surfaceGenerationAlgorithm << header.storageMode;
+	if (fileVersion >= FirstBatchEventVersion)
+	{
+		archive << header.narrowBandWidth << header.narrowBandFarValue;
+		archive << header.bUseChunks << header.chunkCellCount << header.bPipelineChunkRemeshes;
+		archive << header.bAsyncMeshing << header.bTimeSlicedMeshing << header.meshingBudgetMs << header.bIncrementalRemesh;
+		archive << header.bMaintainMipChain << header.mipChainLevelCount << header.meshMipLevel;
+		archive << header.bRecordEditHistory << header.editHistoryMaxBatches;
+		archive << header.bRedistanceAfterEdits << header.redistanceMarginCells << header.redistanceValuePerCell;
+	}
+
+	int32 eventCount = events.Num();
+	archive << eventCount;
+	if (archive.IsLoading())
+	{
+		// A corrupt count must not be allowed to allocate more events than the rest of the file could possibly hold
+		int64 remainingBytes = archive.TotalSize() - archive.Tell();
+		if (eventCount < 0 || eventCount > remainingBytes / MinEventBytes)
+		{
+			archive.SetError();
+			return;
+		}
+		events.SetNum(eventCount);
+	}
+
+	// Frames are stored as the gap since the previous event, and brushes only store the fields their shape and mode use
+	uint32 previousFrame = 0;
+	for (FTerrainEditEvent& event : events)
+	{
+		uint32 frameGap = event.frame - previousFrame;
+		archive.SerializeIntPacked(frameGap);
+		event.frame = previousFrame + frameGap;
+		previousFrame = event.frame;
+
+		uint8 type = (uint8)event.type;
+		archive << type;
+		event.type = (ETerrainEditEventType)type;
+		if (event.type == ETerrainEditEventType::TEE_Redistance)
+		{
+			uint32 brickCount = (uint32)event.brickCount;
+			archive.SerializeIntPacked(brickCount);
+			event.brickCount = (int32)brickCount;
+		}
+		if (event.type != ETerrainEditEventType::TEE_Brush)
+		{
+			continue;
+		}
+
+		FTerrainBrush& brush = event.brush;
+		uint8 shape = (uint8)brush.shape;
+		uint8 mode = (uint8)brush.mode;
+		archive << shape << mode;
+		brush.shape = (ETerrainBrushShape)shape;
+		brush.mode = (ETerrainBrushMode)mode;
+
+		archive << brush.centre.X << brush.centre.Y << brush.centre.Z << brush.value;
+		if (brush.shape == ETerrainBrushShape::TBS_Box)
+		{
+			archive << brush.halfExtents.X << brush.halfExtents.Y << brush.halfExtents.Z;
+		}
+		else
+		{
+			archive << brush.radius;
+		}
+		if (brush.shape == ETerrainBrushShape::TBS_Capsule || brush.shape == ETerrainBrushShape::TBS_Cylinder)
+		{
+			archive << brush.halfHeight;
+		}
+		if (brush.mode == ETerrainBrushMode::TBM_Smooth)
+		{
+			archive << brush.smoothRadius;
+		}
+		if (brush.mode == ETerrainBrushMode::TBM_SmoothUnion && fileVersion >= 2)
+		{
+			archive << brush.blendWidth;
+		}
+	}
+}
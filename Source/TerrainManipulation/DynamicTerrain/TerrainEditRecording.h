@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Brushes/TerrainBrush.h"
+
+enum class ETerrainEditEventType : uint8 {
+	TEE_Brush,
+	TEE_Remesh,
+	TEE_Undo,
+	TEE_Redo,
+	// A tick opened an edit history batch for the brushes it drained
+	TEE_BeginBatch,
+	// A tick redistanced some of the queued bricks within its time budget
+	TEE_Redistance,
+	// A tick committed the open edit history batch once its redistancing had caught up
+	TEE_CommitBatch
+};
+
+/**
+ * A single call that changed the terrain or its mesh, in the frame it happened
+ */
+struct TERRAINMANIPULATION_API FTerrainEditEvent
+{
+	// The frame of the event, counted from the start of the recording
+	uint32 frame = 0;
+
+	ETerrainEditEventType type = ETerrainEditEventType::TEE_Brush;
+
+	// The brush applied by a TEE_Brush event, with its centre in world space
+	FTerrainBrush brush;
+
+	// The number of bricks redistanced by a TEE_Redistance event
+	int32 brickCount = 0;
+};
+
+/**
+ * The settings the terrain was initialised with, so that a replay starts from the same grid
+ */
+struct TERRAINMANIPULATION_API FTerrainRecordingHeader
+{
+	int32 randomSeed = 0;
+	FIntVector3 gridPointCount = FIntVector3(0, 0, 0);
+	FVector3f bottomLeftAnchor = FVector3f::ZeroVector;
+	FVector3f topRightAnchor = FVector3f::ZeroVector;
+	float isovalue = 0;
+	uint8 surfaceGenerationAlgorithm = 0;
+	uint8 storageMode = 0;
+
+	// The settings below change how edits are batched, redistanced and meshed. They are only stored from version 3 on
+	int32 narrowBandWidth = 3;
+	float narrowBandFarValue = 1;
+	bool bUseChunks = false;
+	int32 chunkCellCount = 32;
+	bool bPipelineChunkRemeshes = false;
+	bool bAsyncMeshing = false;
+	bool bTimeSlicedMeshing = false;
+	float meshingBudgetMs = 4;
+	bool bIncrementalRemesh = true;
+	bool bMaintainMipChain = false;
+	int32 mipChainLevelCount = 4;
+	int32 meshMipLevel = 0;
+	bool bRecordEditHistory = true;
+	int32 editHistoryMaxBatches = 100;
+	bool bRedistanceAfterEdits = false;
+	int32 redistanceMarginCells = 4;
+	float redistanceValuePerCell = 0.25f;
+};
+
+/**
+ * The time spent on each stage of terrain updates during one frame
+ */
+struct TERRAINMANIPULATION_API FTerrainFrameTimings
+{
+	uint32 frame = 0;
+	int32 editCount = 0;
+	int32 remeshCount = 0;
+
+	// Time spent modifying the scalar field
+	double editSeconds = 0;
+
+	// Time spent extracting triangles from the scalar field
+	double meshSeconds = 0;
+
+	// Time spent handing the new triangles to the mesh components
+	double uploadSeconds = 0;
+
+	// Time spent starting collision rebuilds, when collision is a separate stage from uploading
+	double collisionSeconds = 0;
+};
+
+/**
+ * A log of every edit made to a terrain, stored in a compact binary file for deterministic replay
+ */
+class TERRAINMANIPULATION_API FTerrainEditRecording
+{
+public:
+	// Incremented whenever the layout of the file changes.
+	// Version 2 added the blend width of smooth union brushes, which version 1 files are read with at its default.
+	// Version 3 added the batch and redistance events and the settings after storageMode in the header
+	static constexpr uint32 FileVersion = 3;
+
+	// The first version whose files hold batch and redistance events and the full header
+	static constexpr uint32 FirstBatchEventVersion = 3;
+
+	FTerrainRecordingHeader header;
+
+	// The events in the order they happened
+	TArray<FTerrainEditEvent> events;
+
+	// The version of the file the recording was read from, or the current version for a recording being made
+	uint32 version = FileVersion;
+
+	/// <summary>
+	/// Write the recording to a binary file
+	/// </summary>
+	/// <returns>False if the file could not be written</returns>
+	bool SaveToFile(const FString& filePath);
+
+	/// <summary>
+	/// Replace the recording with the contents of a binary file
+	/// </summary>
+	/// <returns>False if the file could not be read or is not a terrain recording, in which case the recording is left unchanged</returns>
+	bool LoadFromFile(const FString& filePath);
+
+	/// <summary>
+	/// Get the path of a recording in the Saved directory of the project
+	/// </summary>
+	static FString GetRecordingPath(const FString& recordingName);
+
+private:
+	/// <summary>
+	/// Read or write the recording, depending on the direction of the archive
+	/// </summary>
+	void Serialize(FArchive& archive);
+
+	// Identifies a terrain recording file
+	static constexpr uint32 FileMagic = 0x54455252;
+
+	// The smallest an event can be written as: a single byte of frame gap and its type
+	static constexpr int64 MinEventBytes = 2;
+};
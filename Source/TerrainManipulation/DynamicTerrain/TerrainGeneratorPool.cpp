@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainGeneratorPool.h"
+
+FTerrainGeneratorPool::FTerrainGeneratorPool(TFunction<std::unique_ptr<ISurfaceGenerationAlgorithm>()> generatorFactory, TFunction<int32()> maxRetained)
+	: createGenerator(MoveTemp(generatorFactory)), getMaxIdleGenerators(MoveTemp(maxRetained))
+{
+	idleGenerators.Reserve(FMath::Max(getMaxIdleGenerators(), 1));
+}
+
+std::unique_ptr<ISurfaceGenerationAlgorithm> FTerrainGeneratorPool::Acquire()
+{
+	{
+		FScopeLock lock(&poolLock);
+		if (idleGenerators.Num() > 0)
+		{
+			return idleGenerators.Pop(EAllowShrinking::No);
+		}
+	}
+
+	// Creation happens outside the lock as it is the slow path
+	return createGenerator();
+}
+
+void FTerrainGeneratorPool::Release(std::unique_ptr<ISurfaceGenerationAlgorithm> generator)
+{
+	if (!generator)
+	{
+		return;
+	}
+
+	// The flag belonged to whoever last ran the generator
+	generator->cancelFlag = nullptr;
+
+	int32 maxIdleGenerators = FMath::Max(getMaxIdleGenerators(), 1);
+
+	// Generators beyond the limit are destroyed after the lock is released
+	TArray<std::unique_ptr<ISurfaceGenerationAlgorithm>> discardedGenerators;
+	FScopeLock lock(&poolLock);
+	while (idleGenerators.Num() > maxIdleGenerators)
+	{
+		discardedGenerators.Add(idleGenerators.Pop(EAllowShrinking::No));
+	}
+	if (idleGenerators.Num() < maxIdleGenerators)
+	{
+		idleGenerators.Add(MoveTemp(generator));
+	}
+}
+
+void FTerrainGeneratorPool::Empty()
+{
+	// Generators are destroyed after the lock is released
+	TArray<std::unique_ptr<ISurfaceGenerationAlgorithm>> discardedGenerators;
+	{
+		FScopeLock lock(&poolLock);
+		discardedGenerators = MoveTemp(idleGenerators);
+		idleGenerators.Reserve(FMath::Max(getMaxIdleGenerators(), 1));
+	}
+}
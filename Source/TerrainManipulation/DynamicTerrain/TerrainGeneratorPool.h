@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "ISurfaceGenerationAlgorithm.h"
+#include <memory>
+
+/**
+ * Keeps generators of one algorithm alive between remeshes, so that each run reuses the grid snapshot, sign mask and scratch buffers left by the previous one.
+ * Generators are taken and given back from any thread, and at most one generator per thread that can mesh at once is kept
+ */
+class TERRAINMANIPULATION_API FTerrainGeneratorPool
+{
+public:
+	/// <summary>
+	/// Create an empty pool
+	/// </summary>
+	/// <param name="generatorFactory">Creates a new generator whenever the pool has none to hand out</param>
+	/// <param name="maxRetained">Gives the largest number of idle generators kept, beyond which returned generators are destroyed. It is read on every Release, so it may follow settings that change at runtime</param>
+	FTerrainGeneratorPool(TFunction<std::unique_ptr<ISurfaceGenerationAlgorithm>()> generatorFactory, TFunction<int32()> maxRetained);
+
+	/// <summary>
+	/// Take an idle generator, or create one if there are none. Its settings and dataGrid are whatever the previous user left
+	/// </summary>
+	std::unique_ptr<ISurfaceGenerationAlgorithm> Acquire();
+
+	/// <summary>
+	/// Give back a generator that is no longer running, keeping its storage for the next Acquire.
+	/// Idle generators beyond the current limit are destroyed, including any kept while the limit was higher
+	/// </summary>
+	void Release(std::unique_ptr<ISurfaceGenerationAlgorithm> generator);
+
+	/// <summary>
+	/// Destroy every idle generator, freeing the storage they held
+	/// </summary>
+	void Empty();
+
+private:
+	TFunction<std::unique_ptr<ISurfaceGenerationAlgorithm>()> createGenerator;
+
+	TFunction<int32()> getMaxIdleGenerators;
+
+	// Guards idleGenerators, which is reserved up to the limit so that returning a generator only allocates once the limit is raised
+	FCriticalSection poolLock;
+
+	TArray<std::unique_ptr<ISurfaceGenerationAlgorithm>> idleGenerators;
+};
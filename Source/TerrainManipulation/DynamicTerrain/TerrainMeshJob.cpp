@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainMeshJob.h"
+#include "TerrainChunkDecimator.h"
+#include "TerrainVertexCacheOptimizer.h"
+
+FTerrainMeshJob::FTerrainMeshJob(std::unique_ptr<ISurfaceGenerationAlgorithm> meshGenerator, TSharedPtr<FTerrainGeneratorPool, ESPMode::ThreadSafe> pool)
+	: generator(MoveTemp(meshGenerator)), generatorPool(MoveTemp(pool))
+{
+	generator->cancelFlag = &bCancelled;
+}
+
+FTerrainMeshJob::~FTerrainMeshJob()
+{
+	// A cancelled or abandoned job still has its generator, whose storage is as reusable as that of a finished one
+	if (generator && generatorPool)
+	{
+		generatorPool->Release(MoveTemp(generator));
+	}
+}
+
+void FTerrainMeshJob::Launch(UE::Tasks::ETaskPriority priority)
+{
+	bWaitingForWorker = false;
+	task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [job = AsShared()]()
+		{
+			if (job->IsCancelled())
+			{
+				return;
+			}
+
+			job->Generate(TNumericLimits<double>::Max());
+		}, priority);
+}
+
+bool FTerrainMeshJob::Step(double budgetSeconds)
+{
+	// A launched job belongs to its worker
+	if (task.IsValid())
+	{
+		return IsComplete();
+	}
+
+	if (!bSteppedToCompletion)
+	{
+		bSteppedToCompletion = Generate(budgetSeconds);
+	}
+	return bSteppedToCompletion;
+}
+
+void FTerrainMeshJob::Cancel()
+{
+	bCancelled.store(true, std::memory_order_relaxed);
+}
+
+bool FTerrainMeshJob::IsComplete() const
+{
+	return bSteppedToCompletion || (task.IsValid() && task.IsCompleted());
+}
+
+void FTerrainMeshJob::DecodeResult()
+{
+	if (bQuantizeResult)
+	{
+		quantizedMesh.Decode(mesh);
+		quantizedMesh.Reset();
+		bQuantizeResult = false;
+	}
+}
+
+bool FTerrainMeshJob::Generate(double budgetSeconds)
+{
+	double meshStartTime = FPlatformTime::Seconds();
+	if (!bGenerationStarted)
+	{
+		generator->BeginCPUGeneration();
+		bGenerationStarted = true;
+	}
+	bool bComplete = generator->ContinueCPUGeneration(budgetSeconds);
+
+	// The passes after extraction are counted as meshing time, as they run on the same thread before the mesh can be used.
+	// Decimation goes first, as its collapses would undo the reordering
+	if (bComplete && !IsCancelled())
+	{
+		if (bDecimate)
+		{
+			FTerrainChunkDecimator::Decimate(generator->generatedMesh, decimationErrorTolerance, decimationTriangleBudget);
+		}
+		if (bOptimizeVertexCache)
+		{
+			FTerrainVertexCacheOptimizer::OptimizeMesh(generator->generatedMesh);
+		}
+	}
+	meshSeconds += FPlatformTime::Seconds() - meshStartTime;
+
+	if (bComplete)
+	{
+		if (bQuantizeResult)
+		{
+			quantizedMesh.Encode(generator->generatedMesh, quantizeOrigin, quantizeExtent);
+		}
+		else
+		{
+			mesh = MoveTemp(generator->generatedMesh);
+		}
+
+		// The snapshot is the largest thing the job holds and nothing reads it again, so the next remesh can have it straight away
+		if (generatorPool)
+		{
+			generatorPool->Release(MoveTemp(generator));
+		}
+		generator.reset();
+	}
+	return bComplete;
+}
@@ -0,0 +1,197 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+#include "TerrainManipulation/DataStructs/GridRegion.h"
+#include "TerrainManipulation/DataStructs/QuantizedTerrainMesh.h"
+#include "ISurfaceGenerationAlgorithm.h"
+#include "TerrainGeneratorPool.h"
+#include <atomic>
+#include <memory>
+
+enum class ETerrainMeshJobTarget : uint8 {
+	// The result replaces the whole mesh of the root component
+	TMJ_FullMesh,
+	// The result replaces the triangles of the cells in cellRegion within the mesh of the root component
+	TMJ_CellRegion,
+	// The result replaces the mesh of the chunk at chunkCoords
+	TMJ_Chunk
+};
+
+/**
+ * The time spent in each stage of pipelined chunk remeshes, summed over every chunk that reached the collision stage
+ */
+struct TERRAINMANIPULATION_API FTerrainPipelineTimings
+{
+	int32 chunkCount = 0;
+
+	// Reading the window of the grid on the game thread
+	double snapshotSeconds = 0;
+
+	// Extracting the mesh on a worker thread
+	double meshSeconds = 0;
+
+	// Handing the mesh to the chunk component on the game thread
+	double uploadSeconds = 0;
+
+	// Starting the collision rebuild on the game thread. The cook itself runs asynchronously and is not included
+	double collisionSeconds = 0;
+
+	// From the remesh being started to the collision stage finishing, including any time spent waiting for a thread
+	double latencySeconds = 0;
+};
+
+/**
+ * A CPU extraction against a generator that owns its own copy of the grid, either run on a worker thread or stepped on the game thread a slice at a time.
+ * The job never refers back to the terrain, so the terrain can cancel or forget it at any time and a worker simply finishes with nobody waiting
+ */
+class TERRAINMANIPULATION_API FTerrainMeshJob : public TSharedFromThis<FTerrainMeshJob, ESPMode::ThreadSafe>
+{
+public:
+	/// <summary>
+	/// Take ownership of a generator that has already been handed the grid snapshot to mesh
+	/// </summary>
+	/// <param name="meshGenerator">The generator to run</param>
+	/// <param name="pool">The pool the generator is given back to once the job has finished with it. May be null, in which case the generator is destroyed</param>
+	FTerrainMeshJob(std::unique_ptr<ISurfaceGenerationAlgorithm> meshGenerator, TSharedPtr<FTerrainGeneratorPool, ESPMode::ThreadSafe> pool);
+
+	~FTerrainMeshJob();
+
+	/// <summary>
+	/// Start generating on a worker thread. The job keeps itself alive until the worker has finished
+	/// </summary>
+	/// <param name="priority">The priority of the worker task</param>
+	void Launch(UE::Tasks::ETaskPriority priority = UE::Tasks::ETaskPriority::Normal);
+
+	/// <summary>
+	/// Generate on the calling thread until the time budget is used up, carrying on from where the previous step stopped.
+	/// A job is either launched or stepped, never both
+	/// </summary>
+	/// <param name="budgetSeconds">The time after which no further rows of cells are started</param>
+	/// <returns>True once the mesh is complete</returns>
+	bool Step(double budgetSeconds);
+
+	const UE::Tasks::FTask& GetTask() const
+	{
+		return task;
+	}
+
+	/// <summary>
+	/// Ask the generator to stop at the next row of cells. The result of a cancelled job must not be applied
+	/// </summary>
+	void Cancel();
+
+	bool IsCancelled() const
+	{
+		return bCancelled.load(std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Check whether the mesh has finished generating, after which the result can be read from the game thread
+	/// </summary>
+	bool IsComplete() const;
+
+	/// <summary>
+	/// Check whether the job has been launched on a worker or stepped at least once, after which cancelling it would throw work away
+	/// </summary>
+	bool HasStarted() const
+	{
+		return task.IsValid() || bGenerationStarted;
+	}
+
+	/// <summary>
+	/// Decode a quantized result into the mesh, ready to be displayed. Does nothing if the result was not quantized
+	/// </summary>
+	void DecodeResult();
+
+	// Where the result belongs once it is applied
+	ETerrainMeshJobTarget target = ETerrainMeshJobTarget::TMJ_FullMesh;
+
+	// The cells regenerated by a TMJ_CellRegion job
+	FGridRegion cellRegion;
+
+	// The chunk regenerated by a TMJ_Chunk job
+	FIntVector chunkCoords = FIntVector(0, 0, 0);
+
+	// The grid points whose edits the job includes, which have to be remeshed again if the job is superseded
+	FGridRegion sourceRegion;
+
+	// Whether every triangle of the result is grouped by the cell that generated it
+	bool bHasCellGroups = true;
+
+	// The isovalue the result was generated with
+	float isovalue = 0;
+
+	// The generated mesh, only valid once the job is complete. Left empty when bQuantizeResult is set, until DecodeResult is called
+	UE::Geometry::FDynamicMesh3 mesh;
+
+	// Simplify the result with quadric error edge collapses once it is generated, keeping its open edges fixed
+	bool bDecimate = false;
+
+	// The furthest a decimated vertex may end up from the generated surface, in local units. Zero leaves the error unbounded
+	double decimationErrorTolerance = 0;
+
+	// The triangle count to decimate down to. Zero decimates as far as the error tolerance allows
+	int32 decimationTriangleBudget = 0;
+
+	// Reorder the triangles and vertices of the result for vertex cache locality once it is generated
+	bool bOptimizeVertexCache = false;
+
+	// Hand the result back as a quantizedMesh rather than a full FDynamicMesh3, so that results waiting to be applied take a fraction of the memory.
+	// The generator then keeps its mesh, and writes the next mesh over it in place
+	bool bQuantizeResult = false;
+
+	// The generated mesh when bQuantizeResult is set, only valid once the job is complete
+	FQuantizedTerrainMesh quantizedMesh;
+
+	// The minimum corner of the box the result is quantized within, in the space of the generated mesh
+	FVector3f quantizeOrigin = FVector3f::ZeroVector;
+
+	// The size of the box the result is quantized within, which must be the same for every job whose results meet
+	FVector3f quantizeExtent = FVector3f::ZeroVector;
+
+	// The time spent generating the mesh
+	double meshSeconds = 0;
+
+	// Whether the job is queued for a worker thread by the terrain, so it must be neither stepped nor treated as running
+	bool bWaitingForWorker = false;
+
+	// Whether the result is uploaded by a chain of game thread tasks following the job, rather than being collected by the terrain
+	bool bPipelined = false;
+
+	// Set by the upload stage of a pipelined job, so that the collision stage only runs for a result that was applied
+	bool bUploaded = false;
+
+	// Set by the upload stage of a pipelined job when the frame's chunk results are used up, leaving the terrain to collect it on a later tick
+	bool bUploadDeferred = false;
+
+	// When the remesh was started, for measuring the latency of the whole pipeline
+	double startTime = 0;
+
+	// The time spent reading the grid snapshot before the job was created
+	double snapshotSeconds = 0;
+
+private:
+	/// <summary>
+	/// Generate until the time budget is used up, moving the mesh out of the generator and giving the generator back to its pool once it is complete
+	/// </summary>
+	/// <returns>True once the mesh is complete</returns>
+	bool Generate(double budgetSeconds);
+
+	std::unique_ptr<ISurfaceGenerationAlgorithm> generator;
+
+	// Shared rather than owned by the terrain, as a cancelled job may finish after the terrain has gone
+	TSharedPtr<FTerrainGeneratorPool, ESPMode::ThreadSafe> generatorPool;
+
+	// Whether the generator has started, so that a later step carries on rather than starting again
+	bool bGenerationStarted = false;
+
+	// Whether a step on the calling thread has completed the mesh
+	bool bSteppedToCompletion = false;
+
+	std::atomic<bool> bCancelled = false;
+
+	UE::Tasks::FTask task;
+};
@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainMeshingBenchmark.h"
+#include "TerrainMeshingSettings.h"
+#include "MarchingCubes/MarchingCubesGenerator.h"
+#include "MarchingTetrahedra/MarchingTetrahedraGenerator.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include <atomic>
+
+static FAutoConsoleCommand TerrainMeshingScalingBenchmarkCommand(
+	TEXT("terrain.Meshing.RunScalingBenchmark"),
+	TEXT("Mesh a fixed dataset with 1 to N worker threads and report the speedup and efficiency of each.\n")
+	TEXT("Arguments: [maxWorkers=0, every worker] [repetitions=3] [tetrahedra=0]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args)
+		{
+			int32 maxWorkers = args.Num() > 0 ? FCString::Atoi(*args[0]) : 0;
+			int32 repetitions = args.Num() > 1 ? FCString::Atoi(*args[1]) : 3;
+			bool bTetrahedra = args.Num() > 2 && FCString::Atoi(*args[2]) != 0;
+
+			TArray<FTerrainMeshingScalingResult> results = FTerrainMeshingBenchmark::RunScalingBenchmark([bTetrahedra]() -> std::unique_ptr<ISurfaceGenerationAlgorithm>
+				{
+					if (bTetrahedra)
+					{
+						return std::make_unique<MarchingTetrahedraGenerator>();
+					}
+					return std::make_unique<MarchingCubesGenerator>();
+				}, maxWorkers, repetitions, UTerrainMeshingSettings::GetTaskPriority());
+			FTerrainMeshingBenchmark::ReportResults(results, bTetrahedra ? TEXT("MeshingScaling_MarchingTetrahedra") : TEXT("MeshingScaling_MarchingCubes"));
+		}));
+
+TArray<FTerrainMeshingScalingResult> FTerrainMeshingBenchmark::RunScalingBenchmark(TFunctionRef<std::unique_ptr<ISurfaceGenerationAlgorithm>()> generatorFactory, int32 maxWorkers, int32 repetitions, UE::Tasks::ETaskPriority priority)
+{
+	int32 availableWorkers = UTerrainMeshingSettings::GetWorkerThreadCount(priority);
+	maxWorkers = maxWorkers <= 0 ? availableWorkers : FMath::Min(maxWorkers, availableWorkers);
+	repetitions = FMath::Max(repetitions, 1);
+
+	TArray3D<float> dataset = CreateDataset();
+	TArray<std::unique_ptr<ISurfaceGenerationAlgorithm>> generators;
+	for (int32 i = 0; i < maxWorkers; i++)
+	{
+		generators.Add(generatorFactory());
+	}
+
+	// An untimed run with every worker, so that every generator has allocated its storage before the timed runs start
+	int32 triangleCount = 0;
+	MeshDataset(dataset, generators, maxWorkers, priority, triangleCount);
+
+	TArray<FTerrainMeshingScalingResult> results;
+	for (int32 workerCount = 1; workerCount <= maxWorkers; workerCount++)
+	{
+		FTerrainMeshingScalingResult& result = results.AddDefaulted_GetRef();
+		result.workerCount = workerCount;
+		result.seconds = TNumericLimits<double>::Max();
+		for (int32 repetition = 0; repetition < repetitions; repetition++)
+		{
+			result.seconds = FMath::Min(result.seconds, MeshDataset(dataset, generators, workerCount, priority, result.triangleCount));
+		}
+
+		result.speedup = results[0].seconds / FMath::Max(result.seconds, UE_SMALL_NUMBER);
+		result.efficiency = result.speedup / workerCount;
+	}
+	return results;
+}
+
+void FTerrainMeshingBenchmark::ReportResults(const TArray<FTerrainMeshingScalingResult>& results, const FString& benchmarkName)
+{
+	FString report = TEXT("Workers,Ms,Speedup,Efficiency,Triangles\n");
+	UE_LOG(LogTemp, Display, TEXT("%s: %d^3 points in %d cell chunks"), *benchmarkName, datasetPointCount, chunkCellCount);
+	UE_LOG(LogTemp, Display, TEXT("  Workers         Ms   Speedup  Efficiency  Triangles"));
+	for (const FTerrainMeshingScalingResult& result : results)
+	{
+		report += FString::Printf(TEXT("%d,%.3f,%.3f,%.3f,%d\n"), result.workerCount, result.seconds * 1000, result.speedup, result.efficiency, result.triangleCount);
+		UE_LOG(LogTemp, Display, TEXT("  %7d %10.3f %9.2f %10.0f%% %10d"), result.workerCount, result.seconds * 1000, result.speedup, result.efficiency * 100, result.triangleCount);
+	}
+
+	FString reportPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), benchmarkName + TEXT(".csv"));
+	FFileHelper::SaveStringToFile(report, *reportPath);
+	UE_LOG(LogTemp, Display, TEXT("  Results written to %s"), *reportPath);
+}
+
+TArray3D<float> FTerrainMeshingBenchmark::CreateDataset()
+{
+	TArray3D<float> dataset(datasetPointCount, datasetPointCount, datasetPointCount);
+	for (int32 z = 0; z < datasetPointCount; z++)
+	{
+		for (int32 y = 0; y < datasetPointCount; y++)
+		{
+			for (int32 x = 0; x < datasetPointCount; x++)
+			{
+				float value = (datasetPointCount * 0.5f - z) / datasetPointCount;
+				float frequency = 1.0f / 32;
+				float amplitude = 0.5f;
+				for (int32 octave = 0; octave < 4; octave++)
+				{
+					value += amplitude * FMath::PerlinNoise3D(FVector(x, y, z) * frequency);
+					frequency *= 2;
+					amplitude *= 0.5f;
+				}
+				dataset.SetElement(x, y, z, value);
+			}
+		}
+	}
+	return dataset;
+}
+
+double FTerrainMeshingBenchmark::MeshDataset(const TArray3D<float>& dataset, TArray<std::unique_ptr<ISurfaceGenerationAlgorithm>>& generators, int32 workerCount, UE::Tasks::ETaskPriority priority, int32& outTriangleCount)
+{
+	int32 chunksPerAxis = FMath::DivideAndRoundUp(datasetPointCount - 1, chunkCellCount);
+	int32 chunkCount = chunksPerAxis * chunksPerAxis * chunksPerAxis;
+	std::atomic<int32> nextChunk = 0;
+	std::atomic<int32> triangleCount = 0;
+
+	double startTime = FPlatformTime::Seconds();
+	TArray<UE::Tasks::FTask> workers;
+	for (int32 worker = 0; worker < workerCount; worker++)
+	{
+		ISurfaceGenerationAlgorithm* generator = generators[worker].get();
+		workers.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [&dataset, &nextChunk, &triangleCount, generator, chunkCount, chunksPerAxis]()
+			{
+				for (int32 chunk = nextChunk.fetch_add(1); chunk < chunkCount; chunk = nextChunk.fetch_add(1))
+				{
+					FIntVector3 chunkMin = FIntVector3(chunk % chunksPerAxis, (chunk / chunksPerAxis) % chunksPerAxis, chunk / (chunksPerAxis * chunksPerAxis)) * chunkCellCount;
+					FIntVector3 chunkPoints = FIntVector3(
+						FMath::Min(chunkCellCount, datasetPointCount - 1 - chunkMin.X) + 1,
+						FMath::Min(chunkCellCount, datasetPointCount - 1 - chunkMin.Y) + 1,
+						FMath::Min(chunkCellCount, datasetPointCount - 1 - chunkMin.Z) + 1);
+
+					// Copying the window is part of the work, as it is for a chunk remesh
+					generator->dataGrid.SetSizeUninitialized(chunkPoints.X, chunkPoints.Y, chunkPoints.Z);
+					dataset.CopyRegionTo(generator->dataGrid, chunkMin);
+					generator->isovalue = 0;
+					generator->gridCellDimensions = FVector3f(1, 1, 1);
+					generator->zeroCellOffset = FVector3f(chunkMin);
+					generator->gridIndexOffset = chunkMin;
+					generator->globalCellCount = FIntVector3(datasetPointCount - 1, datasetPointCount - 1, datasetPointCount - 1);
+					triangleCount.fetch_add(generator->GenerateOnCPU().TriangleCount(), std::memory_order_relaxed);
+				}
+			}, priority));
+	}
+
+	// Polled rather than waited on, as waiting could run a worker inline on this thread and measure one more worker than was asked for
+	for (const UE::Tasks::FTask& worker : workers)
+	{
+		while (!worker.IsCompleted())
+		{
+			FPlatformProcess::Yield();
+		}
+	}
+	double seconds = FPlatformTime::Seconds() - startTime;
+
+	outTriangleCount = triangleCount.load();
+	return seconds;
+}
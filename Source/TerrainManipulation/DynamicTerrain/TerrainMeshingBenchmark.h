@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+#include "ISurfaceGenerationAlgorithm.h"
+#include <memory>
+
+/**
+ * The time taken to mesh the benchmark dataset with one number of worker threads
+ */
+struct TERRAINMANIPULATION_API FTerrainMeshingScalingResult
+{
+	int32 workerCount = 0;
+
+	// The best wall clock time over every repetition
+	double seconds = 0;
+
+	// The single worker time divided by this time
+	double speedup = 0;
+
+	// The speedup divided by the number of workers, which is 1 for perfect scaling
+	double efficiency = 0;
+
+	// The number of triangles generated, which is the same for every worker count if the meshing is deterministic
+	int32 triangleCount = 0;
+};
+
+/**
+ * Measures how well chunk meshing scales with the number of worker threads, by meshing a fixed dataset split into chunks with 1 to N workers.
+ * The dataset depends on nothing but its size, so results can be compared between machines and between changes to the generators
+ */
+class TERRAINMANIPULATION_API FTerrainMeshingBenchmark
+{
+public:
+	/// <summary>
+	/// Mesh the benchmark dataset with every number of workers from 1 to maxWorkers. Blocks the calling thread until every run is done
+	/// </summary>
+	/// <param name="generatorFactory">Creates the generators to benchmark, one per worker</param>
+	/// <param name="maxWorkers">The most workers to try. Zero tries every worker thread of the priority</param>
+	/// <param name="repetitions">The number of timed runs per worker count, of which the fastest is kept</param>
+	/// <param name="priority">The priority the workers are launched with</param>
+	/// <returns>One result per worker count, starting with a single worker</returns>
+	static TArray<FTerrainMeshingScalingResult> RunScalingBenchmark(TFunctionRef<std::unique_ptr<ISurfaceGenerationAlgorithm>()> generatorFactory, int32 maxWorkers, int32 repetitions, UE::Tasks::ETaskPriority priority);
+
+	/// <summary>
+	/// Log a table of results and write them to Saved/Benchmarks as a CSV file
+	/// </summary>
+	/// <param name="results">The results of RunScalingBenchmark</param>
+	/// <param name="benchmarkName">The name of the file, without an extension</param>
+	static void ReportResults(const TArray<FTerrainMeshingScalingResult>& results, const FString& benchmarkName);
+
+	// The number of grid points along each axis of the dataset
+	static constexpr int32 datasetPointCount = 129;
+
+	// The number of cells along each axis of a chunk
+	static constexpr int32 chunkCellCount = 32;
+
+private:
+	/// <summary>
+	/// Build the dataset, a few octaves of Perlin noise over a sloping ground plane
+	/// </summary>
+	static TArray3D<float> CreateDataset();
+
+	/// <summary>
+	/// Mesh every chunk of the dataset with a number of workers, each with its own generator pulling chunks from a shared counter
+	/// </summary>
+	/// <param name="dataset">The grid to mesh</param>
+	/// <param name="generators">One generator per worker, which are reused between runs so that only the first run allocates</param>
+	/// <param name="workerCount">The number of workers to launch</param>
+	/// <param name="priority">The priority the workers are launched with</param>
+	/// <param name="outTriangleCount">The total number of triangles generated</param>
+	/// <returns>The wall clock time from launching the first worker to the last one finishing</returns>
+	static double MeshDataset(const TArray3D<float>& dataset, TArray<std::unique_ptr<ISurfaceGenerationAlgorithm>>& generators, int32 workerCount, UE::Tasks::ETaskPriority priority, int32& outTriangleCount);
+};
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainMeshingSettings.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarTerrainMeshingMaxWorkerThreads(
+	TEXT("terrain.Meshing.MaxWorkerThreads"),
+	-1,
+	TEXT("The most worker threads that terrain mesh jobs may occupy at once.\n")
+	TEXT(" -1: use the project settings (default)\n")
+	TEXT("  0: every worker thread of the meshing priority\n")
+	TEXT(" >0: at most this many"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTerrainMeshingTaskPriority(
+	TEXT("terrain.Meshing.TaskPriority"),
+	-1,
+	TEXT("The priority terrain mesh jobs are launched with.\n")
+	TEXT(" -1: use the project settings (default)\n")
+	TEXT("  0: High, 1: Normal, 2: BackgroundHigh, 3: BackgroundNormal, 4: BackgroundLow"),
+	ECVF_Default);
+
+int32 UTerrainMeshingSettings::GetMaxWorkerThreads()
+{
+	int32 maxWorkers = CVarTerrainMeshingMaxWorkerThreads.GetValueOnAnyThread();
+	if (maxWorkers < 0)
+	{
+		maxWorkers = GetDefault<UTerrainMeshingSettings>()->maxWorkerThreads;
+	}
+
+	int32 workerCount = GetWorkerThreadCount(GetTaskPriority());
+	return maxWorkers == 0 ? workerCount : FMath::Clamp(maxWorkers, 1, workerCount);
+}
+
+UE::Tasks::ETaskPriority UTerrainMeshingSettings::GetTaskPriority()
+{
+	int32 priorityIndex = CVarTerrainMeshingTaskPriority.GetValueOnAnyThread();
+	ETerrainMeshingPriority priority = priorityIndex >= 0 && priorityIndex <= (int32)ETerrainMeshingPriority::TMP_BackgroundLow
+		? (ETerrainMeshingPriority)priorityIndex
+		: GetDefault<UTerrainMeshingSettings>()->taskPriority;
+
+	switch (priority) {
+	case ETerrainMeshingPriority::TMP_High:
+		return UE::Tasks::ETaskPriority::High;
+	case ETerrainMeshingPriority::TMP_BackgroundHigh:
+		return UE::Tasks::ETaskPriority::BackgroundHigh;
+	case ETerrainMeshingPriority::TMP_BackgroundNormal:
+		return UE::Tasks::ETaskPriority::BackgroundNormal;
+	case ETerrainMeshingPriority::TMP_BackgroundLow:
+		return UE::Tasks::ETaskPriority::BackgroundLow;
+	case ETerrainMeshingPriority::TMP_Normal:
+	default:
+		return UE::Tasks::ETaskPriority::Normal;
+	}
+}
+
+int32 UTerrainMeshingSettings::GetWorkerThreadCount(UE::Tasks::ETaskPriority priority)
+{
+	bool bBackground = priority >= UE::Tasks::ETaskPriority::BackgroundHigh;
+	int32 workerCount = bBackground ? FTaskGraphInterface::Get().GetNumBackgroundThreads() : FTaskGraphInterface::Get().GetNumWorkerThreads();
+	return FMath::Max(workerCount, 1);
+}
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "Tasks/Task.h"
+#include "TerrainMeshingSettings.generated.h"
+
+UENUM()
+enum class ETerrainMeshingPriority : uint8 {
+	TMP_High,
+	TMP_Normal,
+	// Background priorities run on their own, smaller set of worker threads, leaving the foreground workers to animation and physics
+	TMP_BackgroundHigh,
+	TMP_BackgroundNormal,
+	TMP_BackgroundLow
+};
+
+/**
+ * Project settings for how much of the machine terrain meshing may use. Each can be overridden at runtime by a terrain.Meshing console variable
+ */
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Terrain Meshing"))
+class TERRAINMANIPULATION_API UTerrainMeshingSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	// The most worker threads that mesh jobs may occupy at once. Zero allows every worker thread of the chosen priority
+	UPROPERTY(Config, EditAnywhere, Category = "Threading", meta = (ClampMin = 0))
+	int32 maxWorkerThreads = 0;
+
+	// The priority mesh jobs are launched with
+	UPROPERTY(Config, EditAnywhere, Category = "Threading")
+	ETerrainMeshingPriority taskPriority = ETerrainMeshingPriority::TMP_Normal;
+
+	/// <summary>
+	/// Get the most mesh jobs that may run at once, from terrain.Meshing.MaxWorkerThreads if it is set and from the project settings otherwise.
+	/// It never exceeds the number of worker threads that run tasks of the chosen priority
+	/// </summary>
+	static int32 GetMaxWorkerThreads();
+
+	/// <summary>
+	/// Get the priority to launch mesh jobs with, from terrain.Meshing.TaskPriority if it is set and from the project settings otherwise
+	/// </summary>
+	static UE::Tasks::ETaskPriority GetTaskPriority();
+
+	/// <summary>
+	/// Get the number of worker threads that run tasks of a priority
+	/// </summary>
+	static int32 GetWorkerThreadCount(UE::Tasks::ETaskPriority priority);
+};
@@ -0,0 +1,288 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainRedistancer.h"
+
+namespace
+{
+	/// <summary>
+	/// Solve the upwind discretisation of |grad d| = 1 at a point from the smallest neighbouring distance along each axis.
+	/// Axes are added in order of increasing distance until the solution no longer lies beyond the next neighbour
+	/// </summary>
+	/// <param name="neighbourDistances">The smallest distance of the two neighbours along each axis</param>
+	/// <param name="spacing">The width of a cell along each axis</param>
+	/// <param name="inverseSpacingSquared">One over the square of the width of a cell along each axis</param>
+	float SolveEikonal(const float neighbourDistances[3], const float spacing[3], const float inverseSpacingSquared[3])
+	{
+		int32 order[3] = { 0, 1, 2 };
+		if (neighbourDistances[order[0]] > neighbourDistances[order[1]]) Swap(order[0], order[1]);
+		if (neighbourDistances[order[1]] > neighbourDistances[order[2]]) Swap(order[1], order[2]);
+		if (neighbourDistances[order[0]] > neighbourDistances[order[1]]) Swap(order[0], order[1]);
+
+		float solution = neighbourDistances[order[0]] + spacing[order[0]];
+
+		// Each extra axis adds a term (u - a)^2 / h^2 to the quadratic sum(...) = 1
+		float quadraticA = 0, quadraticB = 0, quadraticC = -1;
+		for (int32 axisCount = 1; axisCount <= 3; axisCount++)
+		{
+			int32 axis = order[axisCount - 1];
+			float neighbour = neighbourDistances[axis];
+			quadraticA += inverseSpacingSquared[axis];
+			quadraticB -= 2 * neighbour * inverseSpacingSquared[axis];
+			quadraticC += neighbour * neighbour * inverseSpacingSquared[axis];
+
+			if (axisCount > 1)
+			{
+				float discriminant = quadraticB * quadraticB - 4 * quadraticA * quadraticC;
+				if (discriminant < 0)
+				{
+					break;
+				}
+				solution = (-quadraticB + FMath::Sqrt(discriminant)) / (2 * quadraticA);
+			}
+
+			if (axisCount == 3 || solution <= neighbourDistances[order[axisCount]])
+			{
+				break;
+			}
+		}
+		return solution;
+	}
+}
+
+void FTerrainRedistancer::Configure(FIntVector3 gridPointCount, FVector3f gridCellDimensions)
+{
+	Reset();
+	size = gridPointCount;
+
+	// Distances are measured in widths of the narrowest cell, so the margin and value per cell mean the same on every axis of a cubic grid
+	float narrowest = FMath::Max(FMath::Min3(gridCellDimensions.X, gridCellDimensions.Y, gridCellDimensions.Z), KINDA_SMALL_NUMBER);
+	cellSpacing = FVector3f(gridCellDimensions.X / narrowest, gridCellDimensions.Y / narrowest, gridCellDimensions.Z / narrowest);
+}
+
+void FTerrainRedistancer::Enqueue(const FGridRegion& pointRegion)
+{
+	FGridRegion region = pointRegion.Clamped(FIntVector3(0, 0, 0), size - FIntVector3(1, 1, 1));
+	if (region.IsEmpty())
+	{
+		return;
+	}
+
+	FIntVector3 brickMin = region.minIndex / BrickSize;
+	FIntVector3 brickMax = region.maxIndex / BrickSize;
+	for (int32 z = brickMin.Z; z <= brickMax.Z; z++)
+	{
+		for (int32 y = brickMin.Y; y <= brickMax.Y; y++)
+		{
+			for (int32 x = brickMin.X; x <= brickMax.X; x++)
+			{
+				FIntVector3 brickCoords(x, y, z);
+				bool bAlreadyPending = false;
+				pendingBrickSet.Add(brickCoords, &bAlreadyPending);
+				if (!bAlreadyPending)
+				{
+					pendingBricks.Add(brickCoords);
+				}
+			}
+		}
+	}
+}
+
+void FTerrainRedistancer::Reset()
+{
+	pendingBricks.Reset();
+	pendingBrickSet.Reset();
+	nextPendingIndex = 0;
+}
+
+FGridRegion FTerrainRedistancer::Process(double budgetSeconds, int32 maxBricks, int32 marginCells, float isovalue, float valuePerCell,
+	TFunctionRef<void(FIntVector3, TArray3D<float>&)> readRegion, TFunctionRef<void(FIntVector3, const TArray3D<float>&)> writeRegion)
+{
+	double startTime = FPlatformTime::Seconds();
+	int32 margin = FMath::Max(marginCells, 1);
+	FGridRegion rewrittenRegion;
+	int32 processedCount = 0;
+	while (nextPendingIndex < pendingBricks.Num())
+	{
+		if (processedCount > 0 && (FPlatformTime::Seconds() - startTime >= budgetSeconds || processedCount == maxBricks))
+		{
+			break;
+		}
+		processedCount++;
+
+		FIntVector3 brickCoords = pendingBricks[nextPendingIndex++];
+		pendingBrickSet.Remove(brickCoords);
+
+		// Any point of the brick closer to the surface than the margin has its nearest surface point inside the window
+		FGridRegion brickRegion = GetBrickRegion(brickCoords);
+		FGridRegion windowRegion = brickRegion.Expanded(margin).Clamped(FIntVector3(0, 0, 0), size - FIntVector3(1, 1, 1));
+		FIntVector3 windowSize = windowRegion.GetSize();
+		TArray3D<float> window(windowSize.X, windowSize.Y, windowSize.Z);
+		readRegion(windowRegion.minIndex, window);
+		if (!RedistanceGrid(window, isovalue, cellSpacing, (float)margin, valuePerCell))
+		{
+			continue;
+		}
+
+		// Only the brick itself is written back, as distances near the edge of the window cannot see the surface beyond it
+		FIntVector3 brickSize = brickRegion.GetSize();
+		TArray3D<float> brick(brickSize.X, brickSize.Y, brickSize.Z);
+		window.CopyRegionTo(brick, brickRegion.minIndex - windowRegion.minIndex);
+		writeRegion(brickRegion.minIndex, brick);
+		rewrittenRegion.Include(brickRegion);
+	}
+
+	if (nextPendingIndex >= pendingBricks.Num())
+	{
+		Reset();
+	}
+	return rewrittenRegion;
+}
+
+bool FTerrainRedistancer::RedistanceGrid(TArray3D<float>& grid, float isovalue, FVector3f spacingVector, float maxDistance, float valuePerCell)
+{
+	const int32 sizeX = grid.GetSize(0), sizeY = grid.GetSize(1), sizeZ = grid.GetSize(2);
+	const int32 strides[3] = { 1, sizeX, sizeX * sizeY };
+	const int32 sizes[3] = { sizeX, sizeY, sizeZ };
+	const float spacing[3] = { spacingVector.X, spacingVector.Y, spacingVector.Z };
+	const float inverseSpacingSquared[3] = { 1 / (spacing[0] * spacing[0]), 1 / (spacing[1] * spacing[1]), 1 / (spacing[2] * spacing[2]) };
+	const TArray<float>& values = grid.GetRawDataStruct();
+	const int32 pointCount = values.Num();
+
+	TArray<float> distances;
+	distances.Init(TNumericLimits<float>::Max(), pointCount);
+	TArray<bool> bSeeded;
+	bSeeded.Init(false, pointCount);
+
+	// Seed the points with a neighbour on the other side of the surface from where the surface crosses each axis
+	bool bHasSurface = false;
+	for (int32 z = 0; z < sizeZ; z++)
+	{
+		for (int32 y = 0; y < sizeY; y++)
+		{
+			for (int32 x = 0; x < sizeX; x++)
+			{
+				const int32 coords[3] = { x, y, z };
+				int32 index = x + sizeX * (y + sizeY * z);
+				float value = values[index];
+				bool bInside = value > isovalue;
+				double inverseSquareSum = 0;
+				bool bOnSurface = false;
+				bool bCrossed = false;
+				for (int32 axis = 0; axis < 3; axis++)
+				{
+					float axisDistance = TNumericLimits<float>::Max();
+					for (int32 direction = -1; direction <= 1; direction += 2)
+					{
+						int32 neighbourCoord = coords[axis] + direction;
+						if (neighbourCoord < 0 || neighbourCoord >= sizes[axis]) continue;
+						float neighbourValue = values[index + direction * strides[axis]];
+						if ((neighbourValue > isovalue) == bInside) continue;
+
+						float crossing = (value - isovalue) / (value - neighbourValue);
+						axisDistance = FMath::Min(axisDistance, crossing * spacing[axis]);
+					}
+					if (axisDistance == TNumericLimits<float>::Max()) continue;
+
+					bCrossed = true;
+					if (axisDistance <= 0)
+					{
+						bOnSurface = true;
+					}
+					else
+					{
+						inverseSquareSum += 1.0 / FMath::Square((double)axisDistance);
+					}
+				}
+
+				if (bCrossed)
+				{
+					// A plane crossing the axes at these distances lies 1 / sqrt(sum 1 / d^2) from the point
+					distances[index] = bOnSurface ? 0 : (float)(1.0 / FMath::Sqrt(inverseSquareSum));
+					bSeeded[index] = true;
+					bHasSurface = true;
+				}
+			}
+		}
+	}
+
+	// Sweep in each of the eight diagonal orderings, so that distance flows outwards from the seeds in every direction
+	if (bHasSurface)
+	{
+		for (int32 pass = 0; pass < SweepPassCount; pass++)
+		{
+			for (int32 ordering = 0; ordering < 8; ordering++)
+			{
+				const int32 stepX = (ordering & 1) ? -1 : 1;
+				const int32 stepY = (ordering & 2) ? -1 : 1;
+				const int32 stepZ = (ordering & 4) ? -1 : 1;
+				for (int32 z = stepZ > 0 ? 0 : sizeZ - 1; z >= 0 && z < sizeZ; z += stepZ)
+				{
+					for (int32 y = stepY > 0 ? 0 : sizeY - 1; y >= 0 && y < sizeY; y += stepY)
+					{
+						for (int32 x = stepX > 0 ? 0 : sizeX - 1; x >= 0 && x < sizeX; x += stepX)
+						{
+							const int32 coords[3] = { x, y, z };
+							int32 index = x + sizeX * (y + sizeY * z);
+							if (bSeeded[index]) continue;
+
+							float neighbourDistances[3];
+							for (int32 axis = 0; axis < 3; axis++)
+							{
+								float lower = coords[axis] > 0 ? distances[index - strides[axis]] : TNumericLimits<float>::Max();
+								float upper = coords[axis] < sizes[axis] - 1 ? distances[index + strides[axis]] : TNumericLimits<float>::Max();
+								neighbourDistances[axis] = FMath::Min(lower, upper);
+							}
+
+							// Points that far from the surface keep their values in the end, so they are never solved
+							if (FMath::Min3(neighbourDistances[0], neighbourDistances[1], neighbourDistances[2]) >= maxDistance) continue;
+
+							distances[index] = FMath::Min(distances[index], SolveEikonal(neighbourDistances, spacing, inverseSpacingSquared));
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (!bHasSurface)
+	{
+		return false;
+	}
+
+	// Points at least the maximum distance away keep their values rather than being clamped, as a neighbouring brick that is not
+	// redistanced would otherwise meet a brick of clamped values with a step along their shared face
+	for (int32 z = 0; z < sizeZ; z++)
+	{
+		for (int32 y = 0; y < sizeY; y++)
+		{
+			float* row = grid.GetRowData(y, z);
+			const float* distanceRow = &distances[sizeX * (y + sizeY * z)];
+			for (int32 x = 0; x < sizeX; x++)
+			{
+				float distance = distanceRow[x];
+				if (distance >= maxDistance)
+				{
+					continue;
+				}
+
+				bool bInside = row[x] > isovalue;
+				float redistanced = isovalue + (bInside ? distance : -distance) * valuePerCell;
+
+				// A point just inside the surface must not round onto the isovalue and change sides
+				if (!bInside || redistanced > isovalue)
+				{
+					row[x] = redistanced;
+				}
+			}
+		}
+	}
+	grid.MarkRegionModified(FIntVector3(0, 0, 0), FIntVector3(sizeX - 1, sizeY - 1, sizeZ - 1));
+	return true;
+}
+
+FGridRegion FTerrainRedistancer::GetBrickRegion(FIntVector3 brickCoords) const
+{
+	FIntVector3 brickMin = brickCoords * BrickSize;
+	return FGridRegion(brickMin, brickMin + FIntVector3(BrickSize - 1)).Clamped(FIntVector3(0, 0, 0), size - FIntVector3(1, 1, 1));
+}
@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TerrainManipulation/DataStructs/TArray3D.h"
+#include "TerrainManipulation/DataStructs/GridRegion.h"
+
+/**
+ * Restores the scalar field around edits to a signed distance from the isosurface, which repeated additive edits flatten into plateaus and cliffs.
+ * Edited bricks are queued and redistanced a few at a time within a time budget, each solved by fast sweeping over the brick and a margin around it
+ */
+class TERRAINMANIPULATION_API FTerrainRedistancer
+{
+public:
+	// The number of grid points along each axis of a brick
+	static constexpr int32 BrickSize = 16;
+
+	// The number of times the eight sweep orderings are repeated, which is enough for the distances to settle in all but the most folded surfaces
+	static constexpr int32 SweepPassCount = 2;
+
+	/// <summary>
+	/// Discard any queued bricks and set the grid that future bricks belong to
+	/// </summary>
+	/// <param name="gridPointCount">The number of grid points along each axis</param>
+	/// <param name="gridCellDimensions">The size of a single grid cell in local coordinates</param>
+	void Configure(FIntVector3 gridPointCount, FVector3f gridCellDimensions);
+
+	/// <summary>
+	/// Queue every brick overlapping a region to be redistanced
+	/// </summary>
+	void Enqueue(const FGridRegion& pointRegion);
+
+	/// <summary>
+	/// Discard any queued bricks
+	/// </summary>
+	void Reset();
+
+	bool HasPendingBricks() const
+	{
+		return pendingBricks.Num() > 0;
+	}
+
+	int32 GetPendingBrickCount() const
+	{
+		return pendingBricks.Num() - nextPendingIndex;
+	}
+
+	/// <summary>
+	/// Redistance queued bricks, oldest first, until the time budget or brick limit is used up. At least one brick is processed on every call
+	/// </summary>
+	/// <param name="budgetSeconds">The time after which no further bricks are started</param>
+	/// <param name="maxBricks">The most bricks to process, or zero for no limit beyond the time budget</param>
+	/// <param name="marginCells">The number of cells read around each brick, which is also the largest distance that is represented</param>
+	/// <param name="isovalue">The value of the field on the surface</param>
+	/// <param name="valuePerCell">The change in value of the redistanced field over the width of a cell</param>
+	/// <param name="readRegion">Fills the array with the current values of the grid starting from the given point</param>
+	/// <param name="writeRegion">Overwrites the grid with the values of the array starting from the given point</param>
+	/// <returns>The grid points that were rewritten. Bricks the surface does not pass near are left as they are</returns>
+	FGridRegion Process(double budgetSeconds, int32 maxBricks, int32 marginCells, float isovalue, float valuePerCell,
+		TFunctionRef<void(FIntVector3, TArray3D<float>&)> readRegion, TFunctionRef<void(FIntVector3, const TArray3D<float>&)> writeRegion);
+
+	/// <summary>
+	/// Replace every value of a grid closer than the maximum distance to the isosurface with its signed distance, keeping every value on the same side of the isovalue.
+	/// Points next to the surface are seeded from the linear crossing along each axis, and fast sweeping carries the distance to the rest
+	/// </summary>
+	/// <param name="grid">The values to redistance</param>
+	/// <param name="isovalue">The value of the field on the surface</param>
+	/// <param name="cellSpacing">The width of a cell along each axis, in units of the narrowest axis</param>
+	/// <param name="maxDistance">The distance in cells at and beyond which points keep their current values</param>
+	/// <param name="valuePerCell">The change in value of the redistanced field over the width of a cell</param>
+	/// <returns>False if the surface does not pass through the grid, in which case the grid is left unchanged</returns>
+	static bool RedistanceGrid(TArray3D<float>& grid, float isovalue, FVector3f cellSpacing, float maxDistance, float valuePerCell);
+
+private:
+	/// <summary>
+	/// Get the grid points covered by a brick, clamped to the size of the grid
+	/// </summary>
+	FGridRegion GetBrickRegion(FIntVector3 brickCoords) const;
+
+	// The number of grid points along each axis
+	FIntVector3 size = FIntVector3(0);
+
+	// The width of a cell along each axis, in units of the narrowest axis
+	FVector3f cellSpacing = FVector3f(1, 1, 1);
+
+	// Bricks waiting to be redistanced, oldest first
+	TArray<FIntVector3> pendingBricks;
+
+	// The same bricks as pendingBricks, for checking whether a brick is already queued
+	TSet<FIntVector3> pendingBrickSet;
+
+	// The index of the oldest brick in pendingBricks that has not yet been processed
+	int32 nextPendingIndex = 0;
+};
@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainRenderSections.h"
+
+using namespace UE::Geometry;
+
+void FTerrainRenderSections::Configure(FIntVector3 terrainCellCount, FVector3f gridCellDimensions, int32 cellsPerSection, float spareFraction)
+{
+	cellCount = terrainCellCount;
+	cellDimensions = gridCellDimensions;
+	sectionCellCount = FMath::Max(cellsPerSection, 1);
+	spareTriangleFraction = FMath::Max(spareFraction, 0.0f);
+	sectionCount = FIntVector3(
+		FMath::DivideAndRoundUp(FMath::Max(cellCount.X, 1), sectionCellCount),
+		FMath::DivideAndRoundUp(FMath::Max(cellCount.Y, 1), sectionCellCount),
+		FMath::DivideAndRoundUp(FMath::Max(cellCount.Z, 1), sectionCellCount));
+}
+
+void FTerrainRenderSections::Reset()
+{
+	bBuilt = false;
+	sectionTriangles.Reset();
+	spareTriangles.Reset();
+}
+
+TUniquePtr<FMeshRenderDecomposition> FTerrainRenderSections::Build(FDynamicMesh3& mesh)
+{
+	Reset();
+
+	// The spares of the previous layout are sized for sections that have since changed, so they are replaced rather than topped up
+	TArray<int32> oldSpares;
+	for (int32 tid : mesh.TriangleIndicesItr())
+	{
+		if (mesh.GetTriangleGroup(tid) == spareGroupID)
+		{
+			oldSpares.Add(tid);
+		}
+	}
+	for (int32 tid : oldSpares)
+	{
+		mesh.RemoveTriangle(tid, true, false);
+	}
+
+	int32 totalSections = sectionCount.X * sectionCount.Y * sectionCount.Z;
+	sectionTriangles.SetNum(totalSections);
+	spareTriangles.SetNum(totalSections);
+	for (int32 tid : mesh.TriangleIndicesItr())
+	{
+		sectionTriangles[GetSectionIndex(GetCell(mesh.GetTriangleGroup(tid)))].Add(tid);
+	}
+
+	TUniquePtr<FMeshRenderDecomposition> decomposition = MakeUnique<FMeshRenderDecomposition>();
+	for (int32 sectionIndex = 0; sectionIndex < totalSections; sectionIndex++)
+	{
+		TArray<int32>& triangles = sectionTriangles[sectionIndex];
+		int32 spareCount = FMath::Max(minimumSpareTriangles, FMath::CeilToInt32(triangles.Num() * spareTriangleFraction));
+		for (int32 i = 0; i < spareCount; i++)
+		{
+			int32 vert1 = mesh.AppendVertex(FVector3d::ZeroVector);
+			int32 vert2 = mesh.AppendVertex(FVector3d::ZeroVector);
+			int32 vert3 = mesh.AppendVertex(FVector3d::ZeroVector);
+			int32 tid = mesh.AppendTriangle(FIndex3i(vert1, vert2, vert3), spareGroupID);
+			CollapseTriangle(mesh, tid, sectionIndex);
+			triangles.Add(tid);
+			spareTriangles[sectionIndex].Add(tid);
+		}
+
+		FMeshRenderDecomposition::FGroup& group = decomposition->GetGroup(decomposition->AppendGroup());
+		group.Triangles = triangles;
+		group.MaterialIndex = 0;
+	}
+	decomposition->BuildAssociations(&mesh);
+
+	bBuilt = true;
+	return decomposition;
+}
+
+bool FTerrainRenderSections::TryReplaceCellTriangles(FDynamicMesh3& mesh, const FDynamicMesh3& regionMesh, const FGridRegion& cellRegion, TArray<int32>& outChangedTriangles)
+{
+	outChangedTriangles.Reset();
+	if (!bBuilt || cellRegion.IsEmpty())
+	{
+		return false;
+	}
+
+	// Only the sections overlapping the cells are searched, and nothing is changed until every section is known to have room
+	FGridRegion sectionRegion(cellRegion.minIndex / sectionCellCount, cellRegion.maxIndex / sectionCellCount);
+	sectionRegion = sectionRegion.Clamped(FIntVector3(0, 0, 0), sectionCount - FIntVector3(1, 1, 1));
+	FIntVector3 touchedSize = sectionRegion.maxIndex - sectionRegion.minIndex + FIntVector3(1, 1, 1);
+	int32 touchedCount = touchedSize.X * touchedSize.Y * touchedSize.Z;
+	auto getTouchedIndex = [&](FIntVector3 cell)
+		{
+			FIntVector3 local = cell / sectionCellCount - sectionRegion.minIndex;
+			return local.X + touchedSize.X * (local.Y + touchedSize.Y * local.Z);
+		};
+
+	if (replacedTriangles.Num() < touchedCount)
+	{
+		replacedTriangles.SetNum(touchedCount);
+	}
+	requiredTriangles.SetNumZeroed(touchedCount, EAllowShrinking::No);
+
+	for (int32 z = sectionRegion.minIndex.Z; z <= sectionRegion.maxIndex.Z; z++)
+	{
+		for (int32 y = sectionRegion.minIndex.Y; y <= sectionRegion.maxIndex.Y; y++)
+		{
+			for (int32 x = sectionRegion.minIndex.X; x <= sectionRegion.maxIndex.X; x++)
+			{
+				FIntVector3 sectionCell = FIntVector3(x, y, z) * sectionCellCount;
+				TArray<int32>& replaced = replacedTriangles[getTouchedIndex(sectionCell)];
+				replaced.Reset();
+				for (int32 tid : sectionTriangles[GetSectionIndex(sectionCell)])
+				{
+					int32 groupID = mesh.GetTriangleGroup(tid);
+					if (groupID == spareGroupID || !cellRegion.Contains(GetCell(groupID)))
+					{
+						continue;
+					}
+					if (!HasOwnVertices(mesh, tid))
+					{
+						return false;
+					}
+					replaced.Add(tid);
+				}
+			}
+		}
+	}
+
+	for (int32 tid : regionMesh.TriangleIndicesItr())
+	{
+		FIntVector3 cell = GetCell(regionMesh.GetTriangleGroup(tid));
+		if (!cellRegion.Contains(cell))
+		{
+			return false;
+		}
+		requiredTriangles[getTouchedIndex(cell)]++;
+	}
+
+	for (int32 z = sectionRegion.minIndex.Z; z <= sectionRegion.maxIndex.Z; z++)
+	{
+		for (int32 y = sectionRegion.minIndex.Y; y <= sectionRegion.maxIndex.Y; y++)
+		{
+			for (int32 x = sectionRegion.minIndex.X; x <= sectionRegion.maxIndex.X; x++)
+			{
+				FIntVector3 sectionCell = FIntVector3(x, y, z) * sectionCellCount;
+				int32 touchedIndex = getTouchedIndex(sectionCell);
+				if (requiredTriangles[touchedIndex] > replacedTriangles[touchedIndex].Num() + spareTriangles[GetSectionIndex(sectionCell)].Num())
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	// The new triangles take the place of the old ones in their section first, and then its spares. The winding of each triangle is carried by the order its vertices are written in
+	for (int32 tid : regionMesh.TriangleIndicesItr())
+	{
+		int32 groupID = regionMesh.GetTriangleGroup(tid);
+		FIntVector3 cell = GetCell(groupID);
+		TArray<int32>& replaced = replacedTriangles[getTouchedIndex(cell)];
+		int32 targetTriangle = replaced.Num() > 0 ? replaced.Pop(EAllowShrinking::No) : spareTriangles[GetSectionIndex(cell)].Pop(EAllowShrinking::No);
+
+		FIndex3i source = regionMesh.GetTriangle(tid);
+		FIndex3i target = mesh.GetTriangle(targetTriangle);
+		mesh.SetVertex(target.A, regionMesh.GetVertex(source.A));
+		mesh.SetVertex(target.B, regionMesh.GetVertex(source.B));
+		mesh.SetVertex(target.C, regionMesh.GetVertex(source.C));
+		mesh.SetTriangleGroup(targetTriangle, groupID);
+		outChangedTriangles.Add(targetTriangle);
+	}
+
+	// Whatever was not written over becomes a spare of its section
+	for (int32 z = sectionRegion.minIndex.Z; z <= sectionRegion.maxIndex.Z; z++)
+	{
+		for (int32 y = sectionRegion.minIndex.Y; y <= sectionRegion.maxIndex.Y; y++)
+		{
+			for (int32 x = sectionRegion.minIndex.X; x <= sectionRegion.maxIndex.X; x++)
+			{
+				FIntVector3 sectionCell = FIntVector3(x, y, z) * sectionCellCount;
+				int32 sectionIndex = GetSectionIndex(sectionCell);
+				for (int32 tid : replacedTriangles[getTouchedIndex(sectionCell)])
+				{
+					CollapseTriangle(mesh, tid, sectionIndex);
+					mesh.SetTriangleGroup(tid, spareGroupID);
+					spareTriangles[sectionIndex].Add(tid);
+					outChangedTriangles.Add(tid);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+FIntVector3 FTerrainRenderSections::GetCell(int32 groupID) const
+{
+	return FIntVector3(groupID % cellCount.X, (groupID / cellCount.X) % cellCount.Y, groupID / (cellCount.X * cellCount.Y));
+}
+
+int32 FTerrainRenderSections::GetSectionIndex(FIntVector3 cell) const
+{
+	FIntVector3 section = FIntVector3(
+		FMath::Clamp(cell.X / sectionCellCount, 0, sectionCount.X - 1),
+		FMath::Clamp(cell.Y / sectionCellCount, 0, sectionCount.Y - 1),
+		FMath::Clamp(cell.Z / sectionCellCount, 0, sectionCount.Z - 1));
+	return section.X + sectionCount.X * (section.Y + sectionCount.Y * section.Z);
+}
+
+bool FTerrainRenderSections::HasOwnVertices(const FDynamicMesh3& mesh, int32 tid)
+{
+	// A vertex used by a single isolated triangle has exactly the two edges of that triangle
+	FIndex3i triangle = mesh.GetTriangle(tid);
+	return mesh.GetVtxEdgeCount(triangle.A) == 2 && mesh.GetVtxEdgeCount(triangle.B) == 2 && mesh.GetVtxEdgeCount(triangle.C) == 2;
+}
+
+void FTerrainRenderSections::CollapseTriangle(FDynamicMesh3& mesh, int32 tid, int32 sectionIndex) const
+{
+	// The corner of the section is inside the bounds of the terrain, so spares never grow the bounds of the component
+	FIntVector3 section = FIntVector3(sectionIndex % sectionCount.X, (sectionIndex / sectionCount.X) % sectionCount.Y, sectionIndex / (sectionCount.X * sectionCount.Y));
+	FVector3d corner = FVector3d(FVector3f(section * sectionCellCount) * cellDimensions);
+
+	FIndex3i triangle = mesh.GetTriangle(tid);
+	mesh.SetVertex(triangle.A, corner);
+	mesh.SetVertex(triangle.B, corner);
+	mesh.SetVertex(triangle.C, corner);
+}
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "Components/MeshRenderDecomposition.h"
+#include "TerrainManipulation/DataStructs/GridRegion.h"
+
+/**
+ * Splits the render buffers of a mesh whose triangles are grouped by cell into sections of cells, so that an incremental remesh only re-uploads the sections it touches.
+ * Render buffers can only be patched while every triangle keeps its ID, so replaced cells are written over the triangles they had before,
+ * and each section carries spare collapsed triangles to take up any growth. Only once a section runs out of spares is the whole mesh rebuilt
+ */
+class TERRAINMANIPULATION_API FTerrainRenderSections
+{
+public:
+	/// <summary>
+	/// Set the layout of the sections. Takes effect from the next Build
+	/// </summary>
+	/// <param name="terrainCellCount">The number of cells along each axis of the whole terrain</param>
+	/// <param name="gridCellDimensions">The size of a single cell in local coordinates</param>
+	/// <param name="cellsPerSection">The number of cells along each axis of a section</param>
+	/// <param name="spareFraction">The number of spare triangles given to each section, as a fraction of the triangles it holds</param>
+	void Configure(FIntVector3 terrainCellCount, FVector3f gridCellDimensions, int32 cellsPerSection, float spareFraction);
+
+	/// <summary>
+	/// Forget the sections, for when the displayed mesh is replaced by one that was not built here
+	/// </summary>
+	void Reset();
+
+	bool IsBuilt() const
+	{
+		return bBuilt;
+	}
+
+	/// <summary>
+	/// Give every section of a mesh about to be displayed its spare triangles, and describe the sections to the render proxy.
+	/// Spares left from a previous Build are removed first
+	/// </summary>
+	/// <param name="mesh">A mesh whose triangles are all grouped by the cell that generated them</param>
+	/// <returns>The decomposition to hand to the component alongside the mesh</returns>
+	TUniquePtr<FMeshRenderDecomposition> Build(UE::Geometry::FDynamicMesh3& mesh);
+
+	/// <summary>
+	/// Replace the triangles of a box of cells by writing over the triangles they had before and the spares of their sections, keeping every triangle ID.
+	/// The mesh is left untouched if any section would run out of spares or a replaced triangle shares its vertices, in which case the caller has to fall back to a full rebuild
+	/// </summary>
+	/// <param name="mesh">The mesh last passed to Build, or patched since</param>
+	/// <param name="regionMesh">The triangles of the cells, grouped by cell</param>
+	/// <param name="cellRegion">The cells the regionMesh replaces</param>
+	/// <param name="outChangedTriangles">Receives every triangle that was written over or collapsed</param>
+	/// <returns>True if the mesh was patched</returns>
+	bool TryReplaceCellTriangles(UE::Geometry::FDynamicMesh3& mesh, const UE::Geometry::FDynamicMesh3& regionMesh, const FGridRegion& cellRegion, TArray<int32>& outChangedTriangles);
+
+	// The triangle group of spare triangles, which belong to no cell
+	static constexpr int32 spareGroupID = -1;
+
+	// The fewest spare triangles a section is given, so that the surface can grow into a section that was empty
+	static constexpr int32 minimumSpareTriangles = 16;
+
+private:
+	FIntVector3 GetCell(int32 groupID) const;
+
+	int32 GetSectionIndex(FIntVector3 cell) const;
+
+	/// <summary>
+	/// Check whether a triangle owns all three of its vertices, so that they can be moved without changing any other triangle
+	/// </summary>
+	static bool HasOwnVertices(const UE::Geometry::FDynamicMesh3& mesh, int32 tid);
+
+	/// <summary>
+	/// Move every vertex of a triangle to a single point inside its section, so that it covers no pixels
+	/// </summary>
+	void CollapseTriangle(UE::Geometry::FDynamicMesh3& mesh, int32 tid, int32 sectionIndex) const;
+
+	FIntVector3 cellCount = FIntVector3(0, 0, 0);
+
+	FVector3f cellDimensions = FVector3f::OneVector;
+
+	int32 sectionCellCount = 16;
+
+	FIntVector3 sectionCount = FIntVector3(0, 0, 0);
+
+	float spareTriangleFraction = 0.25f;
+
+	// Whether the sections describe the mesh on display
+	bool bBuilt = false;
+
+	// Every triangle of each section, spares included, by linear section index. Triangles never move between sections once built
+	TArray<TArray<int32>> sectionTriangles;
+
+	// The collapsed triangles of each section that are free to be written over, by linear section index
+	TArray<TArray<int32>> spareTriangles;
+
+	// The triangles being replaced in each section touched by a patch, by index within the box of touched sections. Kept between patches so it never reallocates
+	TArray<TArray<int32>> replacedTriangles;
+
+	// The number of new triangles in each section touched by a patch, by index within the box of touched sections
+	TArray<int32> requiredTriangles;
+};
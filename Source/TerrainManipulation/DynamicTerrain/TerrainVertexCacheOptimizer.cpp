@@ -0,0 +1,333 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainVertexCacheOptimizer.h"
+
+using namespace UE::Geometry;
+
+void FTerrainVertexCacheOptimizer::ComputeTriangleOrder(const TArray<int32>& indices, int32 vertexCount, int32 cacheSize, TArray<int32>& outTriangleOrder)
+{
+	int32 triangleCount = indices.Num() / 3;
+	outTriangleOrder.Reset(triangleCount);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// The triangles using each vertex, packed one vertex after another
+	TArray<int32> liveTriangles;
+	liveTriangles.SetNumZeroed(vertexCount);
+	for (int32 index : indices)
+	{
+		liveTriangles[index]++;
+	}
+	TArray<int32> adjacencyOffsets;
+	adjacencyOffsets.SetNumUninitialized(vertexCount + 1);
+	adjacencyOffsets[0] = 0;
+	for (int32 v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+	}
+	TArray<int32> adjacency;
+	adjacency.SetNumUninitialized(indices.Num());
+	TArray<int32> fillCounts;
+	fillCounts.SetNumZeroed(vertexCount);
+	for (int32 t = 0; t < triangleCount; t++)
+	{
+		for (int32 corner = 0; corner < 3; corner++)
+		{
+			int32 v = indices[t * 3 + corner];
+			adjacency[adjacencyOffsets[v] + fillCounts[v]++] = t;
+		}
+	}
+
+	TArray<int32> cacheTimes;
+	cacheTimes.SetNumZeroed(vertexCount);
+	TArray<bool> emitted;
+	emitted.SetNumZeroed(triangleCount);
+	TArray<int32> deadEndStack;
+	TArray<int32> candidates;
+	int32 timestamp = cacheSize + 1;
+	int32 cursor = 0;
+
+	int32 fanVertex = indices[0];
+	while (fanVertex >= 0)
+	{
+		candidates.Reset();
+		for (int32 i = adjacencyOffsets[fanVertex]; i < adjacencyOffsets[fanVertex + 1]; i++)
+		{
+			int32 t = adjacency[i];
+			if (emitted[t])
+			{
+				continue;
+			}
+
+			outTriangleOrder.Add(t);
+			emitted[t] = true;
+			for (int32 corner = 0; corner < 3; corner++)
+			{
+				int32 v = indices[t * 3 + corner];
+				deadEndStack.Push(v);
+				candidates.Add(v);
+				liveTriangles[v]--;
+
+				// A vertex that has already been evicted is transformed again and re-enters the cache
+				if (timestamp - cacheTimes[v] > cacheSize)
+				{
+					cacheTimes[v] = timestamp++;
+				}
+			}
+		}
+
+		fanVertex = GetNextVertex(candidates, liveTriangles, cacheTimes, timestamp, cacheSize, deadEndStack, cursor);
+	}
+}
+
+int32 FTerrainVertexCacheOptimizer::GetNextVertex(const TArray<int32>& candidates, const TArray<int32>& liveTriangles, const TArray<int32>& cacheTimes, int32 timestamp, int32 cacheSize,
+	TArray<int32>& deadEndStack, int32& cursor)
+{
+	int32 bestVertex = -1;
+	int32 bestPriority = -1;
+	for (int32 v : candidates)
+	{
+		if (liveTriangles[v] <= 0)
+		{
+			continue;
+		}
+
+		// A vertex whose remaining fan would push it out of the cache before it is finished is no better than one that has already left
+		int32 priority = 0;
+		if (timestamp - cacheTimes[v] + 2 * liveTriangles[v] <= cacheSize)
+		{
+			priority = timestamp - cacheTimes[v];
+		}
+		if (priority > bestPriority)
+		{
+			bestPriority = priority;
+			bestVertex = v;
+		}
+	}
+	if (bestVertex >= 0)
+	{
+		return bestVertex;
+	}
+
+	// Nothing nearby has triangles left, so go back to the most recently used vertex that does, and failing that the next one in input order
+	while (deadEndStack.Num() > 0)
+	{
+		int32 v = deadEndStack.Pop(EAllowShrinking::No);
+		if (liveTriangles[v] > 0)
+		{
+			return v;
+		}
+	}
+	while (cursor < liveTriangles.Num())
+	{
+		if (liveTriangles[cursor] > 0)
+		{
+			return cursor;
+		}
+		cursor++;
+	}
+	return -1;
+}
+
+bool FTerrainVertexCacheOptimizer::OptimizeMesh(FDynamicMesh3& mesh, int32 cacheSize)
+{
+	if (mesh.HasAttributes())
+	{
+		return false;
+	}
+	if (mesh.TriangleCount() < 2)
+	{
+		return true;
+	}
+
+	// Soups share no vertices, so neighbours are found by welding positions. Vertices interpolated onto the same edge by different cells can differ in their last bits,
+	// so positions are snapped to a grid far finer than a cell before comparing them. The weld only guides the order, so a near miss costs a little locality and nothing else
+	double weldStep = FMath::Max(mesh.GetBounds().MaxDim() * 1e-6, UE_DOUBLE_SMALL_NUMBER);
+	TMap<FIntVector, int32> weldedVertices;
+	weldedVertices.Reserve(mesh.VertexCount());
+	TArray<int32> weldedIDs;
+	weldedIDs.Init(IndexConstants::InvalidID, mesh.MaxVertexID());
+	for (int32 vid : mesh.VertexIndicesItr())
+	{
+		FVector3d position = mesh.GetVertex(vid) / weldStep;
+		FIntVector key((int32)FMath::RoundToDouble(position.X), (int32)FMath::RoundToDouble(position.Y), (int32)FMath::RoundToDouble(position.Z));
+		weldedIDs[vid] = weldedVertices.FindOrAdd(key, weldedVertices.Num());
+	}
+
+	TArray<int32> triangleIDs;
+	triangleIDs.Reserve(mesh.TriangleCount());
+	TArray<int32> indices;
+	indices.Reserve(mesh.TriangleCount() * 3);
+	for (int32 tid : mesh.TriangleIndicesItr())
+	{
+		FIndex3i triangle = mesh.GetTriangle(tid);
+		triangleIDs.Add(tid);
+		indices.Add(weldedIDs[triangle.A]);
+		indices.Add(weldedIDs[triangle.B]);
+		indices.Add(weldedIDs[triangle.C]);
+	}
+
+	TArray<int32> triangleOrder;
+	ComputeTriangleOrder(indices, weldedVertices.Num(), cacheSize, triangleOrder);
+
+	if (IsTriangleSoup(mesh))
+	{
+		ReorderSoup(mesh, triangleIDs, triangleOrder);
+	}
+	else
+	{
+		ReorderSharedVertices(mesh, triangleIDs, triangleOrder);
+	}
+	return true;
+}
+
+void FTerrainVertexCacheOptimizer::ReorderSoup(FDynamicMesh3& mesh, const TArray<int32>& triangleIDs, const TArray<int32>& triangleOrder)
+{
+	bool bHasNormals = mesh.HasVertexNormals();
+	bool bHasGroups = mesh.HasTriangleGroups();
+	TArray<FVector3d> positions;
+	positions.SetNumUninitialized(triangleOrder.Num() * 3);
+	TArray<FVector3f> normals;
+	normals.SetNumUninitialized(bHasNormals ? triangleOrder.Num() * 3 : 0);
+	TArray<int32> groups;
+	groups.SetNumUninitialized(bHasGroups ? triangleOrder.Num() : 0);
+	for (int32 i = 0; i < triangleOrder.Num(); i++)
+	{
+		int32 tid = triangleIDs[triangleOrder[i]];
+		FIndex3i triangle = mesh.GetTriangle(tid);
+		for (int32 corner = 0; corner < 3; corner++)
+		{
+			positions[i * 3 + corner] = mesh.GetVertex(triangle[corner]);
+			if (bHasNormals)
+			{
+				normals[i * 3 + corner] = mesh.GetVertexNormal(triangle[corner]);
+			}
+		}
+		if (bHasGroups)
+		{
+			groups[i] = mesh.GetTriangleGroup(tid);
+		}
+	}
+
+	// Each triangle keeps the vertices it was generated with, which generators allocate in the order they append the triangles, so they are already in first use order
+	for (int32 i = 0; i < triangleIDs.Num(); i++)
+	{
+		int32 tid = triangleIDs[i];
+		FIndex3i triangle = mesh.GetTriangle(tid);
+		for (int32 corner = 0; corner < 3; corner++)
+		{
+			mesh.SetVertex(triangle[corner], positions[i * 3 + corner]);
+			if (bHasNormals)
+			{
+				mesh.SetVertexNormal(triangle[corner], normals[i * 3 + corner]);
+			}
+		}
+		if (bHasGroups)
+		{
+			mesh.SetTriangleGroup(tid, groups[i]);
+		}
+	}
+}
+
+void FTerrainVertexCacheOptimizer::ReorderSharedVertices(FDynamicMesh3& mesh, const TArray<int32>& triangleIDs, const TArray<int32>& triangleOrder)
+{
+	// The existing vertex IDs are handed out again in the order the new triangle order first uses them
+	TArray<int32> vertexIDs;
+	vertexIDs.Reserve(mesh.VertexCount());
+	for (int32 vid : mesh.VertexIndicesItr())
+	{
+		vertexIDs.Add(vid);
+	}
+	TArray<int32> vertexRemap;
+	vertexRemap.Init(IndexConstants::InvalidID, mesh.MaxVertexID());
+	int32 nextVertex = 0;
+
+	bool bHasGroups = mesh.HasTriangleGroups();
+	TArray<FIndex3i> triangles;
+	triangles.Reserve(triangleOrder.Num());
+	TArray<int32> groups;
+	groups.Reserve(triangleOrder.Num());
+	for (int32 t : triangleOrder)
+	{
+		int32 tid = triangleIDs[t];
+		FIndex3i triangle = mesh.GetTriangle(tid);
+		for (int32 corner = 0; corner < 3; corner++)
+		{
+			int32& newVertex = vertexRemap[triangle[corner]];
+			if (newVertex == IndexConstants::InvalidID)
+			{
+				newVertex = vertexIDs[nextVertex++];
+			}
+			triangle[corner] = newVertex;
+		}
+		triangles.Add(triangle);
+		groups.Add(bHasGroups ? mesh.GetTriangleGroup(tid) : 0);
+	}
+
+	// Vertices that no triangle uses take whatever IDs are left
+	for (int32 vid : vertexIDs)
+	{
+		if (vertexRemap[vid] == IndexConstants::InvalidID)
+		{
+			vertexRemap[vid] = vertexIDs[nextVertex++];
+		}
+	}
+
+	bool bHasNormals = mesh.HasVertexNormals();
+	TArray<FVector3d> positions;
+	positions.SetNumUninitialized(mesh.MaxVertexID());
+	TArray<FVector3f> normals;
+	normals.SetNumUninitialized(bHasNormals ? mesh.MaxVertexID() : 0);
+	for (int32 vid : vertexIDs)
+	{
+		positions[vertexRemap[vid]] = mesh.GetVertex(vid);
+		if (bHasNormals)
+		{
+			normals[vertexRemap[vid]] = mesh.GetVertexNormal(vid);
+		}
+	}
+	for (int32 vid : vertexIDs)
+	{
+		mesh.SetVertex(vid, positions[vid]);
+		if (bHasNormals)
+		{
+			mesh.SetVertexNormal(vid, normals[vid]);
+		}
+	}
+
+	// Freed triangle and edge IDs are handed out again most recently freed first, so removing the triangles from the highest ID down
+	// has the appended triangles take the same IDs in ascending order, without the mesh giving up any of its storage
+	for (int32 tid = mesh.MaxTriangleID() - 1; tid >= 0; tid--)
+	{
+		if (mesh.IsTriangle(tid))
+		{
+			mesh.RemoveTriangle(tid, false, false);
+		}
+	}
+	for (int32 i = 0; i < triangles.Num(); i++)
+	{
+		mesh.AppendTriangle(triangles[i], groups[i]);
+	}
+}
+
+bool FTerrainVertexCacheOptimizer::IsTriangleSoup(const FDynamicMesh3& mesh)
+{
+	if (mesh.VertexCount() != 3 * mesh.TriangleCount())
+	{
+		return false;
+	}
+
+	// A vertex used by one triangle alone has only the two edges of that triangle
+	for (int32 tid : mesh.TriangleIndicesItr())
+	{
+		FIndex3i triangle = mesh.GetTriangle(tid);
+		if (mesh.GetVtxEdgeCount(triangle.A) != 2 || mesh.GetVtxEdgeCount(triangle.B) != 2 || mesh.GetVtxEdgeCount(triangle.C) != 2)
+		{
+			return false;
+		}
+	}
+	return true;
+}
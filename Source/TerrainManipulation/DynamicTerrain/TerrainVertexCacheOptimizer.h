@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DynamicMesh/DynamicMesh3.h"
+
+/**
+ * Reorders the triangles of a mesh for post-transform vertex cache locality using Tipsify (Sander, Nehab and Barczak, 2007), and its vertices into the order they are first used.
+ * Tipsify fans around one vertex at a time and moves on to whichever vertex of the last fans is still in the cache, which also keeps consecutive triangles close together on the surface.
+ * It runs in time linear in the number of triangles, so it is cheap enough to run after every extraction
+ */
+class TERRAINMANIPULATION_API FTerrainVertexCacheOptimizer
+{
+public:
+	/// <summary>
+	/// Work out the order to draw the triangles of an indexed triangle list in
+	/// </summary>
+	/// <param name="indices">Three vertex indices per triangle</param>
+	/// <param name="vertexCount">One more than the highest vertex index</param>
+	/// <param name="cacheSize">The number of vertices the modelled cache holds</param>
+	/// <param name="outTriangleOrder">Receives every triangle index once, in the order to draw them</param>
+	static void ComputeTriangleOrder(const TArray<int32>& indices, int32 vertexCount, int32 cacheSize, TArray<int32>& outTriangleOrder);
+
+	/// <summary>
+	/// Reorder a mesh in place so its triangles are in cache friendly order and its vertices in the order they are first used.
+	/// Triangle soups are welded by position to find which triangles neighbour each other, but every triangle keeps vertices of its own in the result.
+	/// The mesh keeps its storage, so a generator that recycles its mesh between chunks never reallocates it here
+	/// </summary>
+	/// <param name="mesh">The mesh to reorder, with triangle groups and optionally vertex normals</param>
+	/// <param name="cacheSize">The number of vertices the modelled cache holds</param>
+	/// <returns>False if the mesh has an attribute set, which is not carried across, in which case it is left unchanged</returns>
+	static bool OptimizeMesh(UE::Geometry::FDynamicMesh3& mesh, int32 cacheSize = defaultCacheSize);
+
+	// A cache size that suits the post-transform caches of current GPUs
+	static constexpr int32 defaultCacheSize = 16;
+
+private:
+	/// <summary>
+	/// Move the corners of a mesh whose triangles each have three vertices of their own between its triangles, leaving its topology untouched
+	/// </summary>
+	/// <param name="triangleIDs">The ID of each triangle, in ascending order</param>
+	/// <param name="triangleOrder">The index within triangleIDs of each triangle, in the order to draw them</param>
+	static void ReorderSoup(UE::Geometry::FDynamicMesh3& mesh, const TArray<int32>& triangleIDs, const TArray<int32>& triangleOrder);
+
+	/// <summary>
+	/// Move the vertices of a mesh into the order they are first used, then remove its triangles and append them again in the order to draw them
+	/// </summary>
+	/// <param name="triangleIDs">The ID of each triangle, in ascending order</param>
+	/// <param name="triangleOrder">The index within triangleIDs of each triangle, in the order to draw them</param>
+	static void ReorderSharedVertices(UE::Geometry::FDynamicMesh3& mesh, const TArray<int32>& triangleIDs, const TArray<int32>& triangleOrder);
+
+	/// <summary>
+	/// Check whether every triangle of a mesh has three vertices that no other triangle uses
+	/// </summary>
+	static bool IsTriangleSoup(const UE::Geometry::FDynamicMesh3& mesh);
+
+	/// <summary>
+	/// Choose the next vertex to fan around: the candidate still in the cache that has been there longest without being evicted by its own remaining triangles
+	/// </summary>
+	static int32 GetNextVertex(const TArray<int32>& candidates, const TArray<int32>& liveTriangles, const TArray<int32>& cacheTimes, int32 timestamp, int32 cacheSize,
+		TArray<int32>& deadEndStack, int32& cursor);
+};
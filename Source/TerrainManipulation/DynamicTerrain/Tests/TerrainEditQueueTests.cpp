@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "TerrainManipulation/DynamicTerrain/TerrainEditQueue.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TerrainEditQueueTests
+{
+	const FVector3f cellDimensions = FVector3f(100, 100, 100);
+
+	FTerrainBrush MakeBrush(ETerrainBrushMode mode, float value)
+	{
+		FTerrainBrush brush;
+		brush.mode = mode;
+		brush.centre = FVector(400, 400, 400);
+		brush.radius = 300;
+		brush.value = value;
+		return brush;
+	}
+
+	/// <summary>
+	/// Make a grid with a step in the field along X through the middle, which every smoothing pass softens further
+	/// </summary>
+	TArray3D<float> MakeStepGrid()
+	{
+		TArray3D<float> grid(9, 9, 9);
+		for (int32 z = 0; z < 9; z++)
+		{
+			for (int32 y = 0; y < 9; y++)
+			{
+				for (int32 x = 0; x < 9; x++)
+				{
+					grid.SetElement(x, y, z, x < 4 ? -1.0f : 1.0f);
+				}
+			}
+		}
+		return grid;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTerrainEditQueueSmoothTwiceTest, "TerrainManipulation.EditQueue.RepeatedSmoothBrushesSmoothTwice",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTerrainEditQueueSmoothTwiceTest::RunTest(const FString& Parameters)
+{
+	using namespace TerrainEditQueueTests;
+
+	FTerrainEditQueue queue;
+	FTerrainBrush brush = MakeBrush(ETerrainBrushMode::TBM_Smooth, 1);
+	queue.Enqueue(brush, 0);
+	queue.Enqueue(brush, 0);
+	TestEqual(TEXT("Neither smooth brush is merged away"), queue.GetCoalescedCount(), 0);
+
+	TArray<FTerrainBrush> brushes;
+	queue.Drain(brushes);
+	TestEqual(TEXT("Both smooth brushes are drained"), brushes.Num(), 2);
+
+	TArray3D<float> smoothedOnce = MakeStepGrid();
+	brush.ApplyToGrid(smoothedOnce, FIntVector3(0, 0, 0), cellDimensions);
+
+	TArray3D<float> smoothedQueued = MakeStepGrid();
+	for (const FTerrainBrush& queuedBrush : brushes)
+	{
+		queuedBrush.ApplyToGrid(smoothedQueued, FIntVector3(0, 0, 0), cellDimensions);
+	}
+
+	bool bDiffers = false;
+	for (int32 i = 0; i < smoothedOnce.GetRawDataStruct().Num(); i++)
+	{
+		bDiffers |= !FMath::IsNearlyEqual(smoothedOnce.GetElement(i), smoothedQueued.GetElement(i), 1e-4f);
+	}
+	TestTrue(TEXT("Applying the queued brushes smooths the field twice"), bDiffers);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTerrainEditQueueOrderTest, "TerrainManipulation.EditQueue.CoalescingKeepsEditOrder",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTerrainEditQueueOrderTest::RunTest(const FString& Parameters)
+{
+	using namespace TerrainEditQueueTests;
+
+	// An add either side of a set must not be folded together, or the second add would be overwritten by the set
+	FTerrainEditQueue queue;
+	queue.Enqueue(MakeBrush(ETerrainBrushMode::TBM_Add, 1), 0);
+	queue.Enqueue(MakeBrush(ETerrainBrushMode::TBM_Set, 0), 0);
+	queue.Enqueue(MakeBrush(ETerrainBrushMode::TBM_Add, 1), 0);
+	TestEqual(TEXT("Brushes separated by a set are kept apart"), queue.Num(), 3);
+
+	// Back to back repeats are merged: adds by summing, and sets by dropping the repeat
+	queue.Enqueue(MakeBrush(ETerrainBrushMode::TBM_Add, 2), 0);
+	queue.Enqueue(MakeBrush(ETerrainBrushMode::TBM_Set, 0), 0);
+	queue.Enqueue(MakeBrush(ETerrainBrushMode::TBM_Set, 0), 0);
+	TestEqual(TEXT("Repeats of the last brush are merged"), queue.GetCoalescedCount(), 2);
+
+	TArray<FTerrainBrush> brushes;
+	queue.Drain(brushes);
+	if (TestEqual(TEXT("Only the repeats were merged"), brushes.Num(), 4))
+	{
+		TestEqual(TEXT("The first add is unchanged"), brushes[0].value, 1.0f);
+		TestTrue(TEXT("The set stays between the adds"), brushes[1].mode == ETerrainBrushMode::TBM_Set);
+		TestEqual(TEXT("The last adds are summed"), brushes[2].value, 3.0f);
+		TestTrue(TEXT("The repeated set is kept once"), brushes[3].mode == ETerrainBrushMode::TBM_Set);
+	}
+	return true;
+}
+
+#endif